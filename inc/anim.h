@@ -0,0 +1,129 @@
+#ifndef ANIM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "sprite.h"
+#include "fixed.h"
+#include "scheduler.h"
+
+/* How often the animation event runs while anything is playing. */
+#ifndef ANIM_PERIOD_MS
+#define ANIM_PERIOD_MS 5
+#endif
+
+#define ANIM_TICKS_PER_MS ( SYSTICK_HZ / 1000 )
+
+/* Sequence modes. */
+#define ANIM_ONCE     0        /* stops on the last frame                */
+#define ANIM_LOOP     1        /* wraps back to the first frame          */
+#define ANIM_PINGPONG 2        /* runs back and forth                    */
+
+/* One frame of a sequence, normally in flash. */
+struct anim_frame
+{
+	const sprite_obj_t *sprite;
+	uint16_t duration;      /* milliseconds                             */
+	uint8_t flags;          /* sprite_blit flags                        */
+};
+
+typedef struct anim_frame anim_frame_t;
+
+typedef struct anim_obj anim_obj_t;
+
+/* A playing sequence and its position. The event advances the timing
+*  fields, anim_update copies the result into the shown fields. */
+struct anim_obj
+{
+	const anim_frame_t *frames;
+	int count;
+	int mode;
+
+	/* Advanced by the event. */
+	volatile int index;
+	int dir;                /* 1 or -1 through the frames, ping-pong    */
+	uint32_t elapsed;       /* ticks spent in the current frame         */
+	volatile q16_t x;       /* position of the top left corner          */
+	volatile q16_t y;
+	q16_t vx;               /* tween step per tick                      */
+	q16_t vy;
+	q16_t to_x;             /* tween target                             */
+	q16_t to_y;
+	uint32_t tween_left;    /* ticks of tweening left                   */
+	volatile int running;
+
+	/* As last drawn. */
+	int16_t shown_x;
+	int16_t shown_y;
+	int shown_index;
+	frame_rect_t drawn;
+
+	anim_obj_t *next;
+};
+
+/******** anim_init *********
+*  Adds the animation event to the scheduler. It only runs while an
+*  animation is playing or moving, idle screens cost nothing.
+*   Inputs: none
+*  Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int anim_init(void);
+
+/******** anim_objInit *********
+*  Initializes an animation over a sequence of frames.
+*   Inputs: pointer to an anim_obj_t, frames, number of frames, ANIM_ONCE,
+*   ANIM_LOOP or ANIM_PINGPONG
+*  Outputs: none
+*/
+void anim_objInit( anim_obj_t *a, const anim_frame_t *frames, int count,
+	int mode );
+
+/******** anim_play *********
+*  Shows an animation at x, y and starts it from its first frame.
+*   Inputs: pointer to an anim_obj_t, x, y
+*  Outputs: none
+*/
+void anim_play( anim_obj_t *a, int x, int y );
+
+/******** anim_stop *********
+*  Stops and hides an animation, marking where it was drawn as dirty.
+*   Inputs: pointer to a frame_buffer_t, pointer to an anim_obj_t
+*  Outputs: none
+*/
+void anim_stop( frame_buffer_t *f, anim_obj_t *a );
+
+/******** anim_moveTo *********
+*  Tweens an animation's position linearly to x, y.
+*   Inputs: pointer to an anim_obj_t, x, y, duration in milliseconds, 0
+*   jumps straight there
+*  Outputs: none
+*/
+void anim_moveTo( anim_obj_t *a, int x, int y, int ms );
+
+/******** anim_update *********
+*  Takes the animations' progress since the last call. Each one that moved
+*  or changed frame has its old and new bounding boxes marked dirty, the
+*  application restores the background there before anim_draw.
+*   Inputs: pointer to a frame_buffer_t
+*  Outputs: number of animations that changed
+*/
+int anim_update( frame_buffer_t *f );
+
+/******** anim_draw *********
+*  Draws every shown animation as of the last anim_update.
+*   Inputs: pointer to a frame_buffer_t
+*  Outputs: none
+*/
+void anim_draw( frame_buffer_t *f );
+
+/******** anim_event *********
+*  Scheduler event, advances the playing animations by the time since it
+*  last ran.
+*   Inputs: unused queue, pointer to the count of playing animations
+*  Outputs: none
+*/
+void anim_event( Queue_t *queue, int *flagPt );
+
+#define ANIM_H_ 1
+#endif
@@ -0,0 +1,74 @@
+#ifndef CONSOLE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ssd1322_oled.h"
+
+/* Text cell and band geometry. One band of display RAM holds one line. */
+#define CONSOLE_CELL_W 6
+#define CONSOLE_LINE_H 8
+#define CONSOLE_COLS ( OLED_WIDTH / CONSOLE_CELL_W )
+#define CONSOLE_ROWS ( OLED_HEIGHT / CONSOLE_LINE_H )
+#define CONSOLE_BANDS ( OLED_RAM_ROWS / CONSOLE_LINE_H )
+
+/* Lines of scrollback text kept in RAM. */
+#ifndef CONSOLE_HISTORY
+#define CONSOLE_HISTORY 24
+#endif
+
+/* Grey level of the text. */
+#define CONSOLE_FG 0xF
+
+/******** Console_init *********
+*  Starts an empty console. The console owns OLED_START_LINE while in use,
+*  so display RAM page flipping must be off.
+*   Inputs: none
+*  Outputs: none
+*/
+void Console_init(void);
+
+/******** Console_print *********
+*  Appends text to the console. A line is shown once it ends with '\n' or
+*  fills the width of the panel.
+*   Inputs: pointer to characters, number of characters
+*  Outputs: none
+*/
+void Console_print( const char *text, int length );
+
+/******** Console_scroll *********
+*  Moves the view back through the scrollback. Lines still held in the
+*  off-screen display RAM come back with a start line change only.
+*   Inputs: lines back from the newest, 0 follows new output
+*  Outputs: none
+*/
+void Console_scroll( int lines );
+
+/******** Console_update *********
+*  Sends pending console work to the display: renders at most one missing
+*  line into its row band, or moves the start line once all bands of the
+*  view are in place. Call from the main loop.
+*   Inputs: none
+*  Outputs: none
+*/
+void Console_update(void);
+
+/******** Console_glyph *********
+*  Returns the 5x7 glyph for a character, one byte per column with bit 0 at
+*  the top. Characters outside ASCII 0x20-0x7E map to '?'.
+*   Inputs: character
+*  Outputs: pointer to 5 column bytes in flash
+*/
+const uint8_t *Console_glyph( char c );
+
+/******** Console_drawChar *********
+*  Draws a character's 5x7 glyph, as Console_glyph gives it, into a 4bpp
+*  frame with its top left corner at x, y. Set pixels take a grey level,
+*  the rest are left alone. Clipped to the frame, no damage tracking.
+*   Inputs: pointer to a frame_buffer_t, x, y, character, grey level
+*  Outputs: none
+*/
+void Console_drawChar( frame_buffer_t *f, int x, int y, char c, int value );
+
+#define CONSOLE_H_ 1
+#endif
@@ -0,0 +1,21 @@
+#ifndef CRC_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef STM32F0
+#include <libopencm3/stm32/crc.h>
+#endif
+
+/********* Crc_words *******
+*  CRC-32 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection)
+*  over a block of 32-bit words, as the STM32 CRC unit computes it. Uses
+*  the CRC unit, whose clock is enabled in rcc_init, or a nibble table on
+*  other builds. Not reentrant on the target, call from one context only.
+*   Inputs: pointer to word aligned data, number of words
+*  Outputs: CRC of the block
+*/
+uint32_t Crc_words( const volatile uint32_t *data, int n );
+
+#define CRC_H_ 1
+#endif
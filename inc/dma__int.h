@@ -68,6 +68,13 @@ extern void Sched_runEventManager(void);
 */
 extern void Uart_send( volatile void* data, int length );
 
+/********* Spi_dmaTxComplete *******
+*  Runs the completion callback of a streamed SPI transfer.
+*   Inputs: none
+*  Outputs: none
+*/
+extern void Spi_dmaTxComplete(void);
+
 
 #define DMA__INT_H_ 1
 #endif
\ No newline at end of file
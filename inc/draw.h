@@ -0,0 +1,72 @@
+#ifndef DRAW_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+
+/* Polygon vertex in pixels. Coordinates are kept within +-16383 so edge
+*  slopes fit 16.16 fixed point. */
+struct draw_point
+{
+	int16_t x;
+	int16_t y;
+};
+
+typedef struct draw_point draw_point_t;
+
+/******** draw_line *********
+*  Draws a line between two points, both included, stepped by Bresenham
+*  along its longer axis. Only the steps inside the buffer are taken, from
+*  an error term started where the line enters it, so a clipped line plots
+*  exactly the visible pixels of the whole line. Horizontal and vertical
+*  lines go to the span kernels.
+*   Inputs: pointer to a frame_buffer_t, x0, y0, x1, y1, grey level
+*  Outputs: none
+*/
+void draw_line( frame_buffer_t *f, int x0, int y0, int x1, int y1,
+	int value );
+
+/******** draw_rect *********
+*  Draws the outline of a rectangle.
+*   Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+*  Outputs: none
+*/
+void draw_rect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value );
+
+/******** draw_rectFill *********
+*  Fills a rectangle, see frame_fillRect.
+*   Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+*  Outputs: none
+*/
+void draw_rectFill( frame_buffer_t *f, int x, int y, int width, int height,
+	int value );
+
+/******** draw_circle *********
+*  Draws the outline of a circle by the midpoint algorithm.
+*   Inputs: pointer to a frame_buffer_t, centre x, y, radius, grey level
+*  Outputs: none
+*/
+void draw_circle( frame_buffer_t *f, int cx, int cy, int r, int value );
+
+/******** draw_circleFill *********
+*  Fills a circle with horizontal spans from the midpoint algorithm.
+*   Inputs: pointer to a frame_buffer_t, centre x, y, radius, grey level
+*  Outputs: none
+*/
+void draw_circleFill( frame_buffer_t *f, int cx, int cy, int r, int value );
+
+/******** draw_polygonFill *********
+*  Fills a convex polygon, vertices in either winding. Both edge chains
+*  are walked down from the top vertex in 16.16 fixed point and each row
+*  between them filled as one span, edges included.
+*   Inputs: pointer to a frame_buffer_t, vertices, number of vertices,
+*   grey level
+*  Outputs: none
+*/
+void draw_polygonFill( frame_buffer_t *f, const draw_point_t *pts, int n,
+	int value );
+
+#define DRAW_H_ 1
+#endif
@@ -0,0 +1,163 @@
+#ifndef FIXED_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Q15: 1 sign bit, 15 fraction bits, -1.0 to just under 1.0.
+*  Q16.16: 16 integer bits, 16 fraction bits. */
+typedef int16_t q15_t;
+typedef int32_t q16_t;
+
+/* Angles in binary units, 0x10000 per turn, so wrapping is free. */
+typedef uint16_t fixed_angle_t;
+
+#define Q15_ONE 0x7FFF
+#define Q16_ONE 0x10000
+#define Q16_HALF 0x8000
+
+#define FIXED_ANGLE_90  0x4000
+#define FIXED_ANGLE_180 0x8000
+
+/* Conversions, constant arguments fold at compile time. */
+#define Q16_INT(n) ( (q16_t) ( (n) * Q16_ONE ) )
+#define Q16_CONST(r) ( (q16_t) ( (r) * 65536.0 + ( ( (r) < 0 ) ? -0.5 : 0.5 ) ) )
+#define Q15_CONST(r) ( (q15_t) ( (r) * 32768.0 + ( ( (r) < 0 ) ? -0.5 : 0.5 ) ) )
+#define Q16_TO_INT(q) ( (int) ( ( (q) + Q16_HALF ) >> 16 ) )
+#define Q15_TO_Q16(q) ( (q16_t) (q) << 1 )
+
+/* 2D affine transform, ( x', y' ) = ( a x + b y + tx, c x + d y + ty ). */
+struct fixed_affine
+{
+	q16_t a;
+	q16_t b;
+	q16_t c;
+	q16_t d;
+	q16_t tx;
+	q16_t ty;
+};
+
+typedef struct fixed_affine fixed_affine_t;
+
+/******** fixed_mulQ15 *********
+*  Multiplies two Q15 numbers, rounding. -1.0 * -1.0 saturates.
+*   Inputs: Q15 a, Q15 b
+*  Outputs: Q15 product
+*/
+static inline q15_t fixed_mulQ15( q15_t a, q15_t b )
+{
+	int32_t p = ( (int32_t) a * b + 0x4000 ) >> 15;
+
+	return ( p > Q15_ONE ) ? Q15_ONE : (q15_t) p;
+}
+
+/******** fixed_mul *********
+*  Multiplies two Q16.16 numbers from four 16x16 products, the Cortex-M0
+*  only multiplies 32x32 to 32 bits. Truncates toward minus infinity.
+*   Inputs: Q16.16 a, Q16.16 b
+*  Outputs: Q16.16 product
+*/
+static inline q16_t fixed_mul( q16_t a, q16_t b )
+{
+	int32_t ah = a >> 16, bh = b >> 16;
+	uint32_t al = a & 0xFFFF, bl = b & 0xFFFF;
+
+	return (q16_t) ( ( (uint32_t) ( ah * bh ) << 16 ) + (uint32_t) ( ah * (int32_t) bl ) +
+		(uint32_t) ( (int32_t) al * bh ) + ( ( al * bl ) >> 16 ) );
+}
+
+/******** fixed_mulQ15Q16 *********
+*  Scales a Q16.16 number by a Q15 factor.
+*   Inputs: Q16.16 a, Q15 b
+*  Outputs: Q16.16 product
+*/
+static inline q16_t fixed_mulQ15Q16( q16_t a, q15_t b )
+{
+	int32_t ah = a >> 16;
+	uint32_t al = a & 0xFFFF;
+
+	return (q16_t) ( ( ah * b * 2 ) + ( ( (int32_t) ( al >> 1 ) * b ) >> 14 ) );
+}
+
+/******** fixed_lerp *********
+*  Interpolates between two Q16.16 values.
+*   Inputs: Q16.16 a, Q16.16 b, Q15 weight of b
+*  Outputs: Q16.16 result
+*/
+static inline q16_t fixed_lerp( q16_t a, q16_t b, q15_t t )
+{
+	return a + fixed_mulQ15Q16( b - a, t );
+}
+
+/******** fixed_sin *********
+*  Sine from a quarter wave table in flash, linearly interpolated.
+*   Inputs: angle, 0x10000 per turn
+*  Outputs: Q15 sine
+*/
+q15_t fixed_sin( fixed_angle_t angle );
+
+/******** fixed_cos *********
+*  Cosine, see fixed_sin.
+*   Inputs: angle, 0x10000 per turn
+*  Outputs: Q15 cosine
+*/
+q15_t fixed_cos( fixed_angle_t angle );
+
+/******** fixed_recip *********
+*  Reciprocal from a table in flash, linearly interpolated after scaling
+*  the input into 1 to 2 by shifts. Relative error under 2^-14. Saturates
+*  for 0 and results past the Q16.16 range.
+*   Inputs: Q16.16 x
+*  Outputs: Q16.16 1 / x
+*/
+q16_t fixed_recip( q16_t x );
+
+/******** fixed_div *********
+*  Divides by multiplying with fixed_recip, with its precision, avoiding
+*  the library's software divide.
+*   Inputs: Q16.16 a, Q16.16 b
+*  Outputs: Q16.16 a / b
+*/
+q16_t fixed_div( q16_t a, q16_t b );
+
+/******** fixed_affineIdentity *********
+*  Sets a transform to the identity.
+*   Inputs: pointer to a fixed_affine_t
+*  Outputs: none
+*/
+void fixed_affineIdentity( fixed_affine_t *m );
+
+/******** fixed_affineRotScale *********
+*  Sets a transform rotating by angle and scaling by scale about the
+*  origin, then translating by tx, ty.
+*   Inputs: pointer to a fixed_affine_t, angle, Q16.16 scale, Q16.16 tx, ty
+*  Outputs: none
+*/
+void fixed_affineRotScale( fixed_affine_t *m, fixed_angle_t angle,
+	q16_t scale, q16_t tx, q16_t ty );
+
+/******** fixed_affineMul *********
+*  Composes two transforms, applying second then first. out may be either.
+*   Inputs: pointer to the result, first, second
+*  Outputs: none
+*/
+void fixed_affineMul( fixed_affine_t *out, const fixed_affine_t *first,
+	const fixed_affine_t *second );
+
+/******** fixed_affineInvert *********
+*  Inverts a transform.
+*   Inputs: pointer to the result, pointer to the transform
+*  Outputs: 1 if inverted, 0 if the transform is singular
+*/
+int fixed_affineInvert( fixed_affine_t *out, const fixed_affine_t *m );
+
+/******** fixed_affineApply *********
+*  Maps a point through a transform.
+*   Inputs: pointer to a fixed_affine_t, Q16.16 x, y, pointers to the
+*   Q16.16 results
+*  Outputs: none
+*/
+void fixed_affineApply( const fixed_affine_t *m, q16_t x, q16_t y,
+	q16_t *ox, q16_t *oy );
+
+#define FIXED_H_ 1
+#endif
@@ -0,0 +1,66 @@
+#ifndef FONT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "sprite.h"
+
+/* Glyph entry, indexed by character code minus the font's first code. */
+struct font_glyph
+{
+	uint16_t offset;     /* first byte of the bitmap in the atlas           */
+	uint8_t width;       /* bitmap size in pixels, 0 for blank glyphs       */
+	uint8_t height;
+	uint8_t advance;     /* pen movement to the next glyph                  */
+	int8_t x_off;        /* bitmap position relative to the pen and the     */
+	int8_t y_off;        /* top of the line                                 */
+};
+
+typedef struct font_glyph font_glyph_t;
+
+/* Font in flash. The atlas holds each glyph as packed 4bpp rows of
+*  SPRITE_STRIDE(width) bytes, even x in the low nibble. Grey level 0 is
+*  transparent. tools/bdf2font generates these as src/font_<name>.c from
+*  fonts/<name>.bdf; code using one declares it with
+*  extern const font_t font_<name>; */
+struct font
+{
+	uint8_t first;       /* first and last character codes in the index     */
+	uint8_t last;
+	uint8_t height;      /* line height in pixels                           */
+	uint8_t baseline;    /* rows from the top of the line to the baseline   */
+	const font_glyph_t *glyphs;
+	const uint8_t *atlas;
+};
+
+typedef struct font font_t;
+
+/******** font_glyph *********
+*  Looks up the glyph for a character, '?' standing in for codes outside
+*  the font.
+*   Inputs: pointer to a font_t, character
+*  Outputs: pointer to the glyph, NULL if the font has neither
+*/
+const font_glyph_t *font_glyph( const font_t *font, char c );
+
+/******** font_stringWidth *********
+*  Returns the advance of a string in pixels.
+*   Inputs: pointer to a font_t, NUL terminated text
+*  Outputs: width in pixels
+*/
+int font_stringWidth( const font_t *font, const char *text );
+
+/******** font_drawString *********
+*  Draws a string into a frame buffer, glyphs clipped to the buffer and
+*  blitted whole rows at a time through sprite_blit. Frames other than
+*  4bpp are left untouched.
+*   Inputs: pointer to a frame_buffer_t, pointer to a font_t, x of the pen,
+*   y of the top of the line, NUL terminated text
+*  Outputs: x of the pen after the last glyph
+*/
+int font_drawString( frame_buffer_t *f, const font_t *font, int x, int y,
+	const char *text );
+
+#define FONT_H_ 1
+#endif
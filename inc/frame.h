@@ -1,54 +1,252 @@
 #ifndef FRAME_H_
 
 #include <stdio.h>
+#include <stdint.h>
 
 #define bit_mask(bit_offset, bit_count) 					\
-(((1 << bit_count) - 1) << bit_offset)
+(((1 << (bit_count)) - 1) << (bit_offset))
 
 #define get_bits(target, bit_offset, bit_count)  			\
-((target & bit_mask(bit_offset, bit_count)) >> bit_offset)
+(((target) & bit_mask(bit_offset, bit_count)) >> (bit_offset))
 
 #define write_bits(target, bit_offset, bit_count, value)  	\
-{target = (target & ~bit_mask(bit_offset, bit_count)) | (value << bit_offset);}
+{target = ((target) & ~bit_mask(bit_offset, bit_count)) | ((value) << (bit_offset));}
+
+/******** frame_opaque *********
+* Widens each non-zero nibble of a word to 0xF, zero nibbles stay 0. XOR
+* with a colour key repeated in every nibble first to mask out the key.
+*/
+static inline uint32_t frame_opaque( uint32_t s )
+{
+	uint32_t t = ( s | ( s >> 1 ) | ( s >> 2 ) | ( s >> 3 ) ) & 0x11111111u;
+
+	return ( t << 4 ) - t;
+}
+
+/* Upper bound of tracked damage regions, overflow merges into the nearest. */
+#define FRAME_DIRTY_MAX 4
+
+/* Rectangle in pixels, x1 and y1 exclusive. */
+struct frame_rect
+{
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+};
+
+typedef struct frame_rect frame_rect_t;
+
+/* Pixel formats. 1 and 2bpp pixels are palette indices, packed from the
+*  least significant bit like 4bpp, and expanded to grey levels while being
+*  flushed. Sprites, fonts, images, tile maps, frame_maskCopy and
+*  frame_lutRect work on 4bpp buffers only and return without drawing into
+*  others. frame_rowSet takes a 4bpp row and leaves the check to callers. */
+#define FRAME_BPP_1 1
+#define FRAME_BPP_2 2
+#define FRAME_BPP_4 4
 
 struct frame_buffer
 {
 	volatile uint8_t *data;
 	int width;
-	int h_width;
+	int h_width;        /* bytes per row, half the width at 4bpp */
 	int height;
 	int length;
+	int bpp;
 	volatile int32_t *readyFlag;
+	/* Regions changed since the last flush, disjoint, 4 pixel aligned in x. */
+	frame_rect_t dirty[FRAME_DIRTY_MAX];
+	int dirtyCount;
+	/* Grey levels of the pixels in each source nibble, first pixel in the
+	*  low nibble. One byte for 2bpp, two for 1bpp, unused at 4bpp. */
+	uint16_t expand[16];
 };
 
 typedef struct frame_buffer frame_buffer_t;
 
+/******** frame_pixelPut *********
+* Sets a pixel known to be inside the buffer, any format, no damage
+* tracking.
+*/
+static inline void frame_pixelPut( frame_buffer_t *f, int x, int y, int value )
+{
+	int bit = x * f->bpp;
+
+	write_bits( f->data[y * f->h_width + ( bit >> 3 )], bit & 7, f->bpp,
+		( value & ( ( 1 << f->bpp ) - 1 ) ) );
+}
+
 /******** frame_bufferInit *********
-* Initializes a frame_buffer_t object.
+* Initializes a frame_buffer_t object. The ready flag starts signalled,
+* a flush takes it and signals it again once the data has been sent.
 *  Inputs: pointer to a frame_buffer_t, width in pixels, height in pixels, 
-*  pointer to an allocated data array, length of array in bytes.
+*  pointer to an allocated data array, length of array in bytes, pointer to
+*  the ready flag.
 * Outputs: none
 */
 void frame_bufferInit( frame_buffer_t *f, int width, int height, 
 	volatile uint8_t *data, int length, volatile int32_t *flag );
 
+/******** frame_bufferInitBpp *********
+* frame_bufferInit for a 1, 2 or 4bpp buffer. A 256x64 screen takes 2 KB
+* at 1bpp and 4 KB at 2bpp. The palette starts as evenly spaced grey levels
+* from black to white.
+*  Inputs: pointer to a frame_buffer_t, width in pixels, height in pixels,
+*  bits per pixel, pointer to an allocated data array, length of array in
+*  bytes, pointer to the ready flag.
+* Outputs: none
+*/
+void frame_bufferInitBpp( frame_buffer_t *f, int width, int height, int bpp,
+	volatile uint8_t *data, int length, volatile int32_t *flag );
+
+/******** frame_paletteSet *********
+* Sets the grey levels 1 and 2bpp pixel values are shown as, taking effect
+* from the next flush. The whole buffer is marked dirty.
+*  Inputs: pointer to a frame_buffer_t, grey level of each pixel value (2
+*  or 4 entries)
+* Outputs: none
+*/
+void frame_paletteSet( frame_buffer_t *f, const uint8_t *levels );
+
+/******** frame_view *********
+* Sets up a frame_buffer_t that draws into a rectangle of another, so every
+* kernel clips to the rectangle. The left edge is rounded down and the
+* right edge up to whole bytes of the parent (2 pixels at 4bpp). Damage is
+* tracked in the view's own coordinates, not the parent's.
+*  Inputs: pointer to the view, pointer to the parent, x, y, width, height
+* Outputs: x of the view's left edge in the parent
+*/
+int frame_view( frame_buffer_t *view, frame_buffer_t *f, int x, int y,
+	int width, int height );
+
+/******** frame_dirtyAdd *********
+* Marks a region as changed. The region is clipped to the buffer and widened
+* to the display's 4 pixel column granularity, then merged with any tracked
+* region it overlaps or touches. When the list is full it is merged into
+* the region that grows the least.
+*  Inputs: pointer to a frame_buffer_t, x0, y0, x1, y1 (x1, y1 exclusive)
+* Outputs: none
+*/
+void frame_dirtyAdd( frame_buffer_t *f, int x0, int y0, int x1, int y1 );
+
+/******** frame_dirtyAll *********
+* Marks the whole buffer as changed.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void frame_dirtyAll( frame_buffer_t *f );
+
+/******** frame_dirtyClear *********
+* Forgets all tracked regions, normally once they have been flushed.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void frame_dirtyClear( frame_buffer_t *f );
+
 /******** frame_pixelSet *********
 * Sets an arbitary pixel to greyLvl reflecting the x,y coordinates provided.
 *  Inputs: pointer to a frame_buffer_t, x coordinate, y coordinate, grey level
-*  from 0 (black) to F (white).
+*  from 0 (black) to F (white), or palette index for 1 and 2bpp.
 * Outputs: none
 *
 * frame_buffer_t:
-*	member h_width is expected to be ceiling half the width
+*	member h_width is expected to be ceiling bytes per row
 */
 void frame_pixelSet( frame_buffer_t *f, int x, int y, int value );
 
 /******** frame_pixelGet *********
 * Returns a pixel's greyLvl located by the x,y coordinates provided.
 *  Inputs: pointer to a frame_buffer_t, x coordinate, y coordinate.
-* Outputs: grey level from 0 (black) to F (white).
+* Outputs: grey level from 0 (black) to F (white), or palette index.
 */
 uint8_t frame_pixelGet( frame_buffer_t *f, int x, int y );
 
+/* Span and area kernels. Rectangles are clipped to the buffer and marked
+*  dirty. Runs of whole bytes go a 32-bit word at a time, partial bytes at
+*  either end are masked. Values are palette indices at 1 and 2bpp. */
+
+/******** frame_rowSet *********
+* Sets pixels x0 to x1 (exclusive) of a 4bpp frame row to a grey level.
+* No clipping, damage tracking or format check, for decoders that do their
+* own; frame_rowFill takes any format.
+*  Inputs: frame row, x0, x1, grey level
+* Outputs: none
+*/
+void frame_rowSet( volatile uint8_t *row, int x0, int x1, int value );
+
+/******** frame_rowFill *********
+* Sets pixels x0 to x1 (exclusive) of row y, any format. No clipping or
+* damage tracking.
+*  Inputs: pointer to a frame_buffer_t, y, x0, x1, grey level or index
+* Outputs: none
+*/
+void frame_rowFill( frame_buffer_t *f, int y, int x0, int x1, int value );
+
+/******** frame_spanH *********
+* Fills a horizontal run of pixels with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, grey level 0 to F
+* Outputs: none
+*/
+void frame_spanH( frame_buffer_t *f, int x, int y, int width, int value );
+
+/******** frame_spanV *********
+* Fills a vertical run of pixels with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, height, grey level 0 to F
+* Outputs: none
+*/
+void frame_spanV( frame_buffer_t *f, int x, int y, int height, int value );
+
+/******** frame_fillRect *********
+* Fills a rectangle with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void frame_fillRect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value );
+
+/******** frame_clear *********
+* Fills the whole buffer with a grey level.
+*  Inputs: pointer to a frame_buffer_t, grey level
+* Outputs: none
+*/
+void frame_clear( frame_buffer_t *f, int value );
+
+/******** frame_xorRect *********
+* XORs a grey level into every pixel of a rectangle, 0xF inverts, as does
+* 1 at 1bpp and 3 at 2bpp.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void frame_xorRect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value );
+
+/******** frame_maskCopy *********
+* Copies a rectangle of pixels from one buffer into another, skipping
+* source pixels of grey level 0 so they leave the destination showing.
+* Both buffers must be 4bpp.
+*  Inputs: destination frame_buffer_t, destination x, y, source
+*  frame_buffer_t, source x, y, width, height
+* Outputs: none
+*/
+void frame_maskCopy( frame_buffer_t *dst, int x, int y, frame_buffer_t *src,
+	int sx, int sy, int width, int height );
+
+/******** frame_brightnessLut *********
+* Builds a grey level table scaling brightness by level / 16.
+*  Inputs: 16 entry table to fill, level 0 (black) to 16 (unchanged)
+* Outputs: none
+*/
+void frame_brightnessLut( uint8_t *lut, int level );
+
+/******** frame_lutRect *********
+* Maps every pixel of a rectangle through a 16 entry grey level table,
+* 4bpp buffers only.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, table
+* Outputs: none
+*/
+void frame_lutRect( frame_buffer_t *f, int x, int y, int width, int height,
+	const uint8_t *lut );
+
 #define FRAME_H_ 1
 #endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef GAME_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "scheduler.h"
+#include "pipeline.h"
+#include "input.h"
+#include "fixed.h"
+
+/* Length of one update step. */
+#ifndef GAME_STEP_MS
+#define GAME_STEP_MS 10
+#endif
+
+#define GAME_STEP_TICKS ( GAME_STEP_MS * ( SYSTICK_HZ / 1000 ) )
+
+/* Update steps run before a frame at most. Time beyond is dropped, the
+*  game slows down instead of falling further behind. */
+#ifndef GAME_STEPS_MAX
+#define GAME_STEPS_MAX 4
+#endif
+
+/* Advances the game by one GAME_STEP_MS step. */
+typedef void (*game_update_t)( const input_state_t *in );
+
+/* Draws the game into a frame. alpha is how far time has run into the
+*  next step, for drawing motion between steps. */
+typedef void (*game_render_t)( frame_buffer_t *f, q15_t alpha );
+
+/* Stage timings in SysTick ticks (10 us), last frame and worst. Input
+*  sampling runs in the scheduler, a few register accesses per event, and
+*  is counted rather than timed. */
+struct game_stats
+{
+	uint32_t steps;        /* update steps run                           */
+	uint32_t steps_dropped;/* steps skipped to catch up                  */
+	uint32_t inputs;       /* input events run, as of the last step      */
+	uint32_t update;       /* update steps before the last frame         */
+	uint32_t update_max;
+	uint32_t render;       /* last frame's render call                   */
+	uint32_t render_max;
+	uint32_t idle;         /* waiting with nothing to do, running total  */
+	uint32_t elapsed;      /* since Game_run started, running total      */
+	pipe_stats_t pipe;     /* frames, dropped slots and flush times      */
+};
+
+typedef struct game_stats game_stats_t;
+
+/******** Game_init *********
+*  Sets up the game loop and starts the frame pipeline with page flipping.
+*  Input_init must have been called.
+*   Inputs: update function, render function, function to run while
+*           waiting or NULL to sleep, first frame buffer, second frame
+*           buffer or NULL, frames per second or 0 for PIPE_FPS_DEFAULT
+*  Outputs: 1 if the pipeline started, 0 if the scheduler table is full,
+*           when Game_run must not be called
+*/
+int Game_init( game_update_t update, game_render_t render,
+	void (*idle)(void), frame_buffer_t *a, frame_buffer_t *b, int fps );
+
+/******** Game_run *********
+*  Runs the game loop, does not return. Update steps run at a fixed rate
+*  from an accumulator of elapsed time, each with a fresh input snapshot.
+*  After new steps a frame is rendered into whichever buffer the pipeline
+*  has free while the previous frame is flushed by DMA. With nothing to
+*  do, the idle function runs or the CPU sleeps until the next interrupt.
+*   Inputs: none
+*  Outputs: none
+*/
+void Game_run(void);
+
+/******** Game_stats *********
+*  Copies out the stage counters and timings. Called from the game's own
+*  functions, the loop owns the counters.
+*   Inputs: pointer to a game_stats_t to fill
+*  Outputs: none
+*/
+void Game_stats( game_stats_t *stats );
+
+#define GAME_H_ 1
+#endif
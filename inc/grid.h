@@ -0,0 +1,139 @@
+#ifndef GRID_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sprite.h"
+
+/* Cells of GRID_CELL x GRID_CELL pixels over the world from 0, 0. Objects
+*  beyond the last cell are kept in the edge cells, still found, only
+*  slower to find. */
+#ifndef GRID_SHIFT
+#define GRID_SHIFT 5
+#endif
+#define GRID_CELL ( 1 << GRID_SHIFT )
+
+#ifndef GRID_COLS
+#define GRID_COLS 16
+#endif
+#ifndef GRID_ROWS
+#define GRID_ROWS 8
+#endif
+
+/* Cell memberships shared by all objects, an object spans one to four
+*  cells while it is no larger than a cell. */
+#ifndef GRID_ENTRIES
+#define GRID_ENTRIES 128
+#endif
+
+#define GRID_NONE 0xFFFF
+
+/* Cell column of objects not in a grid, and of objects left out of one
+*  for want of entries. */
+#define GRID_OUT 0xFF
+#define GRID_DROPPED 0xFE
+
+/* Words of mask memory for a width x height sprite. */
+#define GRID_MASK_WORDS(width, height) ( ( ( (width) + 31 ) >> 5 ) * (height) )
+
+struct scene_obj_list;
+
+struct grid_entry
+{
+	struct scene_obj_list *obj;
+	uint16_t next;          /* next entry of the cell, or GRID_NONE     */
+};
+
+/* A uniform grid of scene objects by bounding box, all memory inside. */
+struct grid
+{
+	uint16_t cell[GRID_ROWS][GRID_COLS];    /* first entry, or GRID_NONE */
+	struct grid_entry entry[GRID_ENTRIES];
+	uint16_t free;          /* first unused entry, or GRID_NONE         */
+	uint16_t freeCount;
+	uint16_t dropped;       /* objects left out, queries miss them      */
+};
+
+typedef struct grid grid_t;
+
+/* Opaque pixels of a sprite, one bit each, least significant bit first. */
+struct grid_mask
+{
+	uint16_t width;
+	uint16_t height;
+	uint16_t stride;        /* words per row                            */
+	const uint32_t *bits;
+};
+
+typedef struct grid_mask grid_mask_t;
+
+/******** grid_init *********
+*  Empties a grid.
+*   Inputs: pointer to a grid_t
+*  Outputs: none
+*/
+void grid_init( grid_t *g );
+
+/******** grid_insert *********
+*  Adds an object to the cells its bounding box covers. An object that
+*  does not fit is counted in dropped until it is removed or fits.
+*   Inputs: pointer to a grid_t, pointer to a scene object not in a grid
+*  Outputs: 1, or 0 if the grid is out of entries and it was not added
+*/
+int grid_insert( grid_t *g, struct scene_obj_list *o );
+
+/******** grid_remove *********
+*  Takes an object out of the grid, nothing if it is not in it.
+*   Inputs: pointer to a grid_t, pointer to a scene object
+*  Outputs: none
+*/
+void grid_remove( grid_t *g, struct scene_obj_list *o );
+
+/******** grid_move *********
+*  Updates an object's cells after it moved or changed sprite. Costs one
+*  comparison while it stays within the same cells. A dropped object is
+*  tried again.
+*   Inputs: pointer to a grid_t, pointer to a scene object in the grid
+*  Outputs: 1, or 0 if the grid ran out of entries and it was dropped
+*/
+int grid_move( grid_t *g, struct scene_obj_list *o );
+
+/******** grid_query *********
+*  Finds the objects whose bounding boxes overlap a rectangle, each once,
+*  in no particular order. Only the cells under the rectangle are visited.
+*   Inputs: pointer to a grid_t, world x0, y0, x1, y1 (exclusive), array
+*   to receive the objects, its size
+*  Outputs: number of objects found, at most the array size
+*/
+int grid_query( grid_t *g, int x0, int y0, int x1, int y1,
+	struct scene_obj_list **out, int max );
+
+/******** grid_collide *********
+*  Finds the other objects whose bounding boxes overlap an object's.
+*   Inputs: pointer to a grid_t, pointer to a scene object, array to
+*   receive the objects, its size
+*  Outputs: number of objects found, at most the array size
+*/
+int grid_collide( grid_t *g, struct scene_obj_list *o,
+	struct scene_obj_list **out, int max );
+
+/******** grid_maskInit *********
+*  Derives a collision mask from a sprite's pixels other than its key.
+*   Inputs: pointer to a grid_mask_t, pointer to a sprite_obj_t, mask
+*   memory of GRID_MASK_WORDS words, its length in words
+*  Outputs: 1, or 0 if the memory is too small
+*/
+int grid_maskInit( grid_mask_t *m, const sprite_obj_t *s, uint32_t *bits,
+	int length );
+
+/******** grid_maskOverlap *********
+*  Tests two masks at world positions for a shared opaque pixel, 32
+*  pixels of a row at a time. Masks are unflipped.
+*   Inputs: first mask, its x, y, second mask, its x, y
+*  Outputs: 1 if they touch, 0 if not
+*/
+int grid_maskOverlap( const grid_mask_t *a, int ax, int ay,
+	const grid_mask_t *b, int bx, int by );
+
+#define GRID_H_ 1
+#endif
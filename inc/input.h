@@ -0,0 +1,76 @@
+#ifndef INPUT_H_
+
+#include <stdint.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/adc.h>
+#include <libopencm3/cm3/cortex.h>
+
+#include "lowlevel.h"
+#include "scheduler.h"
+
+/* How often the input event runs. Each run reads one joystick axis, so an
+*  axis is sampled every INPUT_AXES runs. */
+#ifndef INPUT_PERIOD_MS
+#define INPUT_PERIOD_MS 1
+#endif
+
+#define INPUT_TICKS_PER_MS ( SYSTICK_HZ / 1000 )
+
+/* Buttons pull their pin to ground, pulled up when released. */
+#ifndef INPUT_BTN_ACTIVE_LOW
+#define INPUT_BTN_ACTIVE_LOW 1
+#endif
+
+/* Joystick axes, index into input_state.joy. */
+#define INPUT_LEFT_X  0
+#define INPUT_LEFT_Y  1
+#define INPUT_RIGHT_X 2
+#define INPUT_RIGHT_Y 3
+#define INPUT_AXES    4
+
+/* Button bits. */
+#define INPUT_BTN_LEFT  0x01
+#define INPUT_BTN_RIGHT 0x02
+
+/* Joystick reading at rest, 12 bit conversions. */
+#define INPUT_JOY_CENTRE 0x800
+
+/* Offsets from centre smaller than this are noise of a stick at rest. */
+#define INPUT_JOY_DEAD 0x100
+
+/* A snapshot of the controls. */
+struct input_state
+{
+	uint16_t joy[INPUT_AXES];  /* 0 to 0xFFF                            */
+	uint8_t buttons;           /* held, debounced                        */
+	uint8_t pressed;           /* went down since the last Input_read    */
+	uint8_t released;          /* went up since the last Input_read      */
+	uint32_t samples;          /* input events run, a running count      */
+};
+
+typedef struct input_state input_state_t;
+
+/********* Input_init *******
+*  Calibrates and starts the ADC for the joysticks, then adds the input
+*  event to the scheduler. Pins and clocks are set up by Low_init.
+*   Inputs: none
+*  Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int Input_init(void);
+
+/********* Input_read *******
+*  Copies out the latest controls and clears the button edges.
+*   Inputs: pointer to an input_state_t to fill
+*  Outputs: none
+*/
+void Input_read( input_state_t *in );
+
+/********* Input_event *******
+*  Scheduler event, samples the controls at a fixed rate.
+*   Inputs: unused queue, pointer to the input run flag
+*  Outputs: none
+*/
+void Input_event( Queue_t *queue, int *flagPt );
+
+#define INPUT_H_ 1
+#endif
@@ -0,0 +1,73 @@
+#ifndef PIPELINE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "scheduler.h"
+#include "ssd1322_oled.h"
+
+/* Frame rate used when Pipe_init is given 0. */
+#define PIPE_FPS_DEFAULT 30
+
+/* Frame counters and timings, times in SysTick ticks (10 us). */
+struct pipe_stats
+{
+	uint32_t frames;       /* frames sent to the display                 */
+	uint32_t dropped;      /* frame slots missed, render or flush late   */
+	uint32_t render;       /* last Pipe_acquire to Pipe_submit time      */
+	uint32_t render_max;
+	uint32_t flush;        /* last flush start to last pixel out time    */
+	uint32_t flush_max;
+};
+
+typedef struct pipe_stats pipe_stats_t;
+
+/******** Pipe_init *********
+*  Starts paced flushing of frames. Each frame slot, the newest submitted
+*  frame is flushed by DMA while the application draws the next one.
+*  With one frame buffer the application waits for the flush between
+*  frames. With two, drawing overlaps the flush. Display RAM page flipping,
+*  when asked for, keeps the panel from showing a half sent frame either
+*  way; otherwise the current Oled_pageFlip setting is left alone.
+*   Inputs: first frame buffer, second frame buffer or NULL, frames per
+*           second or 0 for PIPE_FPS_DEFAULT, 1 to switch page flipping on
+*  Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int Pipe_init( frame_buffer_t *a, frame_buffer_t *b, int fps, int flip );
+
+/******** Pipe_acquire *********
+*  Hands out a frame buffer to draw the next frame into, one at a time. With
+*  two buffers, regions the other buffer changed in its last frame are copied
+*  over from it and marked dirty here, so every frame starts from the last
+*  one submitted.
+*   Inputs: none
+*  Outputs: frame buffer, or NULL while none is free
+*/
+frame_buffer_t *Pipe_acquire(void);
+
+/******** Pipe_submit *********
+*  Hands a drawn frame back for the next frame slot. An older frame still
+*  waiting for its slot is discarded and counted as dropped. With damage
+*  detection on, the frame is scanned here, so the frame slot event only
+*  starts the transfers.
+*   Inputs: frame buffer from Pipe_acquire
+*  Outputs: none
+*/
+void Pipe_submit( frame_buffer_t *f );
+
+/******** Pipe_stats *********
+*  Copies out the frame counters and timings.
+*   Inputs: pointer to a pipe_stats_t to fill
+*  Outputs: none
+*/
+void Pipe_stats( pipe_stats_t *stats );
+
+/******** Pipe_frameEvent *********
+*  Scheduler event, runs once per frame slot.
+*   Inputs: unused queue, pointer to the pipeline's run flag
+*  Outputs: none
+*/
+void Pipe_frameEvent( Queue_t *queue, int *flagPt );
+
+#define PIPELINE_H_ 1
+#endif
@@ -0,0 +1,66 @@
+#ifndef PLOT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "widget.h"
+#include "queue.h"
+
+/* Blank columns kept ahead of the write position. */
+#ifndef PLOT_GAP
+#define PLOT_GAP 3
+#endif
+
+/* Samples taken from the source per Queue_get. */
+#define PLOT_CHUNK 16
+
+/* A strip chart widget. Samples are plotted one per column, left to right,
+*  and the write position wraps back to the left edge like a sweeping
+*  oscilloscope trace, so each new sample costs one column of drawing and
+*  of flushing rather than a scroll of the whole chart. */
+struct plot
+{
+	widget_t w;             /* first, a plot_t * is a widget_t *         */
+	Queue_t *source;        /* FIFO_U16T queue of samples, or NULL       */
+	uint16_t *ring;         /* one sample per column, w.width entries    */
+	int cursor;             /* column the next sample goes to            */
+	int filled;             /* the cursor has wrapped at least once      */
+	int pending;            /* samples stored but not drawn              */
+	uint16_t min;           /* sample shown on the bottom row            */
+	uint16_t max;           /* sample shown on the top row               */
+	uint32_t scale;         /* rows per sample, 16.16                    */
+};
+
+typedef struct plot plot_t;
+
+/******** plot_init *********
+*  Initializes a strip chart widget, drawn in w.fore over w.back (0 unless
+*  changed). Add it to a tree with widget_add.
+*   Inputs: pointer to a plot_t, x, y relative to the parent, width,
+*   height, sample storage of width entries, source queue or NULL,
+*   sample shown on the bottom row, sample shown on the top row
+*  Outputs: none
+*/
+void plot_init( plot_t *p, int x, int y, int width, int height,
+	uint16_t *ring, Queue_t *source, int min, int max );
+
+/******** plot_push *********
+*  Appends samples without drawing them, plot_update draws them.
+*   Inputs: pointer to a plot_t, samples, number of samples
+*  Outputs: none
+*/
+void plot_push( plot_t *p, const uint16_t *samples, int n );
+
+/******** plot_update *********
+*  Takes the samples waiting in the source queue and draws the columns
+*  they and plot_push changed straight into the frame, marking only those
+*  columns dirty. Call once per frame before widget_redraw, in main
+*  context. A chart already invalidated, or with a full width of new
+*  samples, is left to widget_redraw.
+*   Inputs: pointer to a plot_t, pointer to a frame_buffer_t
+*  Outputs: number of new samples
+*/
+int plot_update( plot_t *p, frame_buffer_t *f );
+
+#define PLOT_H_ 1
+#endif
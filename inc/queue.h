@@ -7,7 +7,7 @@
 #include <libopencm3/stm32/gpio.h>
 
 #define B_SIZE_FIFO_UART 128
-#define B_SIZE_FIFO_SPI 2048
+#define B_SIZE_FIFO_SPI 1024
 #define B_SIZE_TEST 8
 
 /* These structs hold the data and fit in the queue_data container. */
@@ -0,0 +1,45 @@
+#ifndef RLE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+
+/* Run opcodes. Each run starts with one byte, the top two bits the opcode
+*  and the low six the length in pixels minus one:
+*    RLE_SKIP  transparent pixels, nothing follows;
+*    RLE_FILL  pixels of one grey level, held in the low nibble of the next
+*              byte;
+*    RLE_LIT   literal pixels, packed two per byte after it, first pixel
+*              in the low nibble.
+*  Runs never cross rows, rows have no terminator. */
+#define RLE_SKIP 0x00
+#define RLE_FILL 0x40
+#define RLE_LIT  0x80
+#define RLE_OP_MASK 0xC0
+#define RLE_LEN_MASK 0x3F
+#define RLE_RUN_MAX 64
+
+/* Run-length coded 4bpp image in flash. tools/pgm2rle generates these. */
+struct rle_image
+{
+	uint16_t width;
+	uint16_t height;
+	const uint16_t *rows;     /* offset of each row's first run in data */
+	const uint8_t *data;
+};
+
+typedef struct rle_image rle_image_t;
+
+/******** rle_blit *********
+*  Decodes an image straight into a frame buffer with its top left corner
+*  at x, y, clipped to the buffer. Fill runs are written a word at a time,
+*  literal runs copied, transparent runs skipped without touching memory.
+*  4bpp frames only, others are left untouched.
+*   Inputs: pointer to a frame_buffer_t, pointer to an rle_image_t, x, y
+*  Outputs: none
+*/
+void rle_blit( frame_buffer_t *f, const rle_image_t *img, int x, int y );
+
+#define RLE_H_ 1
+#endif
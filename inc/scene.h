@@ -1,6 +1,22 @@
 #ifndef SCENE_H_
 
 #include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "sprite.h"
+#include "grid.h"
+
+/* Backgrounds drawn per scene, back to front. */
+#ifndef SCENE_BACKGNDS
+#define SCENE_BACKGNDS 2
+#endif
+
+/* Objects a grid indexed scene draws per frame, more fall back to walking
+*  the whole list. */
+#ifndef SCENE_VISIBLE_MAX
+#define SCENE_VISIBLE_MAX 32
+#endif
 
 enum scene_tiling
 {
@@ -10,23 +26,120 @@ enum scene_tiling
 	TILE_XY
 };
 
+/* A background sprite, drawn at minus its scroll offset and repeated along
+*  the tiled axes so scrolling wraps around. */
 struct scene_backgnd
 {
 	sprite_obj_t *sprite;
-	uint16_t x;
-	uint16_t y;
-	enum scene_tiling;
+	int16_t x;
+	int16_t y;
+	enum scene_tiling tiling;
 };
 
+typedef struct scene_backgnd scene_backgnd_t;
+
+typedef struct scene_obj_list scene_obj_t;
+
+/* Scene object, a node of the scene's intrusive list kept sorted by layer
+*  then y so lower objects overlap the ones behind them. */
 struct scene_obj_list
 {
-	uint16_t x;
-	uint16_t y;
+	int16_t x;              /* scene coordinates of the top left corner */
+	int16_t y;
 	sprite_obj_t *sprite;
 	scene_obj_t *next;
-	//additional attributes
-	
-}
+	uint8_t layer;          /* drawn in increasing layer order          */
+	uint8_t flags;          /* sprite_blit flags                        */
+	uint8_t gx0;            /* grid cells covered, gx0 GRID_OUT if none */
+	uint8_t gy0;
+	uint8_t gx1;
+	uint8_t gy1;
+};
+
+struct scene
+{
+	scene_backgnd_t backgnd[SCENE_BACKGNDS];
+	int backgndCount;
+	scene_obj_t *objects;   /* head of the sorted list                  */
+	grid_t *grid;           /* index of the objects, or NULL            */
+	int16_t view_x;         /* scene coordinates of the viewport corner */
+	int16_t view_y;
+};
+
+typedef struct scene scene_t;
+
+/******** scene_init *********
+*  Initializes an empty scene with the viewport at the origin.
+*   Inputs: pointer to a scene_t
+*  Outputs: none
+*/
+void scene_init( scene_t *sc );
+
+/******** scene_backgndAdd *********
+*  Adds a background layer in front of those added before.
+*   Inputs: pointer to a scene_t, pointer to a sprite_obj_t, tiling
+*  Outputs: pointer to the background for scrolling, NULL if full
+*/
+scene_backgnd_t *scene_backgndAdd( scene_t *sc, sprite_obj_t *sprite,
+	enum scene_tiling tiling );
+
+/******** scene_objInit *********
+*  Initializes a scene object.
+*   Inputs: pointer to a scene_obj_t, pointer to a sprite_obj_t, x, y, layer
+*  Outputs: none
+*/
+void scene_objInit( scene_obj_t *o, sprite_obj_t *sprite, int x, int y,
+	int layer );
+
+/******** scene_add *********
+*  Inserts an object into a scene at its sorted position. It is drawn even
+*  when the scene's grid has no room for it, scene_render then walks the
+*  whole list until it fits.
+*   Inputs: pointer to a scene_t, pointer to a scene_obj_t
+*  Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_add( scene_t *sc, scene_obj_t *o );
+
+/******** scene_remove *********
+*  Takes an object out of a scene.
+*   Inputs: pointer to a scene_t, pointer to a scene_obj_t
+*  Outputs: none
+*/
+void scene_remove( scene_t *sc, scene_obj_t *o );
+
+/******** scene_objMove *********
+*  Moves an object, keeping the scene's grid up to date, see scene_add.
+*   Inputs: pointer to a scene_t, pointer to a scene_obj_t, x, y
+*  Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_objMove( scene_t *sc, scene_obj_t *o, int x, int y );
+
+/******** scene_gridAttach *********
+*  Indexes the scene's objects in a grid, which then culls them for
+*  scene_render and answers collision queries. Objects must be moved with
+*  scene_objMove, or grid_move called after changing them.
+*   Inputs: pointer to a scene_t, pointer to a grid_t, NULL to detach
+*  Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_gridAttach( scene_t *sc, grid_t *g );
+
+/******** scene_sort *********
+*  Restores layer and y order after objects have moved. An insertion sort,
+*  linear while the list is nearly sorted, as it is from frame to frame.
+*   Inputs: pointer to a scene_t
+*  Outputs: none
+*/
+void scene_sort( scene_t *sc );
+
+/******** scene_render *********
+*  Draws the backgrounds, then every object overlapping the viewport, into
+*  a frame buffer the size of the viewport. Objects outside are skipped
+*  before any blitting, with a grid without visiting them unless it has
+*  dropped objects.
+*   Inputs: pointer to a scene_t, pointer to a frame_buffer_t
+*  Outputs: none
+*/
+void scene_render( scene_t *sc, frame_buffer_t *f );
 
 #define SCENE_H_ 1
-#endif
\ No newline at end of file
+#endif
@@ -8,7 +8,8 @@
 #include "systick.h"
 #include "queue.h"
 
-#define NUMEVENTS 2
+/* UART, SPI, test, pipeline, animation and input, with room to spare. */
+#define NUMEVENTS 8
 
 /* Data transfer blocking flags. */
 extern int Flag_DMA_Chan3;
@@ -17,7 +18,7 @@ extern int Flag_test;
 
 /* Buffer parameter initialization exports to global. */
 extern Queue_t Q_fifo_u8_uart;
-extern Queue_t Q_fifo_u8_spi;
+extern Queue_t Q_fifo_u16_spi;
 
 /* Scheduler event table. */
 struct sched_eventTable {
@@ -62,11 +63,11 @@ void Sched_flagSignal( int *semaPt );
 /********* Sched_addEvent *******
 *  Adds event to event management table
 *   Inputs: pointer to a event function
-*           period in milliseconds
-*           pointer to a Queue type
-*  Outputs: none
+*           period in SysTick cycles
+*           pointer to a Queue type, or NULL for a purely periodic event
+*  Outputs: 1 if added, 0 if the table is full
 */
-void Sched_addEvent( 
+int Sched_addEvent( 
 	void(*function)( Queue_t *queue, int *flagPt ),
 	int period_cycles, Queue_t *queue, int *flagPt );
 
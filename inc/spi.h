@@ -11,10 +11,26 @@
 #include "queue.h"
 #include "dma__int.h"
 
+/* Display transport, selected at build time (Makefile OLED_TRANSPORT).
+*  3-wire: 9-bit frames, the D/C bit travels in bit 8 of every word.
+*  4-wire: 8-bit frames, D/C is driven on the DC pin between runs.
+*  Queued words always use the 9-bit layout; the 4-wire transport strips
+*  bit 8 and drives the pin instead.
+*/
+#define SPI_DC_DATA 0x100
+
+#ifdef OLED_SPI_4WIRE
+#define SPI_DATA_SIZE SPI_CR2_DS_8BIT
+typedef uint8_t spi_frame_t;
+#else
+#define SPI_DATA_SIZE SPI_CR2_DS_9BIT
+typedef uint16_t spi_frame_t;
+#endif
+
 
 /********* Spi_init *******
 *  Initializes the SPI peripheral for simplex serial transmission.
-*  8 bits per word
+*  9 or 8 bits per word depending on the display transport.
 *   Inputs: none
 *  Outputs: none
 */
@@ -36,6 +52,46 @@ void Spi_fifoTxEvent( Queue_t *buffer, int *flagPt );
 */
 void Spi_dmaTxHandler( volatile void* data, int length );
 
+/********* Spi_dmaTxStream *******
+*  Starts a DMA transfer that bypasses the SPI queue. The transfer only
+*  starts once the queue has drained and the channel is free, so it stays
+*  ordered behind queued commands. The callback runs from the SPI ISR once
+*  the last frame has left the shift register and may chain the next one;
+*  a chained transfer goes ahead of anything queued in the meantime.
+*   Inputs: pointer to a contiguous block of spi_frame_t, number of frames,
+*           D/C level for the 4-wire transport (ignored on 3-wire),
+*           completion callback or NULL
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+int Spi_dmaTxStream( volatile void* data, int length, int dc, 
+	void(*done)(void) );
+
+/********* Spi_dmaTxWords *******
+*  Streams 9-bit words (D/C in bit 8) outside of the SPI queue, by
+*  reference. The 4-wire transport takes D/C from the first word, so a call
+*  must not mix commands and data there.
+*   Inputs: pointer to 9-bit words, number of words, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+int Spi_dmaTxWords( const volatile uint16_t* words, int length, 
+	void(*done)(void) );
+
+/********* Spi_dmaTxComplete *******
+*  Runs the completion callback of a streamed transfer. Called from the SPI
+*  ISR after the channel flag has been signalled.
+*   Inputs: none
+*  Outputs: none
+*/
+void Spi_dmaTxComplete(void);
+
+/********* Spi_dcSelect *******
+*  Drives the D/C line of the 4-wire transport. Only call while the SPI is
+*  idle; the pin is written only when the level changes.
+*   Inputs: 0 for command, non-zero for data
+*  Outputs: none
+*/
+void Spi_dcSelect( int dc );
+
 /********* Spi_send *******
 *  Adds arbitrary number of elements to the UART transmission buffer.
 *   Inputs: pointer to a contiguous block of data, number of elements to copy
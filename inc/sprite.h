@@ -1,18 +1,94 @@
 #ifndef SPRITE_H_
 
 #include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "fixed.h"
+
+/* Key value for sprites drawn without transparency. */
+#define SPRITE_NO_KEY 0xFF
+
+/* Blit flags. */
+#define SPRITE_FLIP_H 0x01
+#define SPRITE_FLIP_V 0x02
+
+/* Bytes per bitmap row. */
+#define SPRITE_STRIDE(width) ( ( (width) + 1 ) >> 1 )
 
 struct sprite_obj
 {
 	uint16_t width;
 	uint16_t height;
 
-	static const uint8_t *bmp_data;
+	/* Packed 4bpp rows of SPRITE_STRIDE(width) bytes, even x in the low
+	*  nibble like frame_buffer_t, normally in flash. */
+	const uint8_t *bmp_data;
 	uint16_t length;
 
-}
+	uint8_t key;        /* transparent grey level, or SPRITE_NO_KEY */
+
+};
 
 typedef struct sprite_obj sprite_obj_t;
 
+/******** sprite_init *********
+*  Initializes a sprite_obj_t over a packed 4bpp bitmap.
+*   Inputs: pointer to a sprite_obj_t, width in pixels, height in pixels,
+*   pointer to the bitmap, length of bitmap in bytes, transparent grey level
+*   or SPRITE_NO_KEY
+*  Outputs: none
+*/
+void sprite_init( sprite_obj_t *s, int width, int height,
+	const uint8_t *data, int length, int key );
+
+/******** sprite_blit *********
+*  Draws a sprite into a frame buffer with its top left corner at x, y,
+*  clipped to the buffer. Pixels matching the key are left untouched.
+*  Unflipped rows whose source and destination nibbles line up are copied
+*  a word at a time, others two pixels per byte with the source realigned
+*  by a nibble shift. 4bpp frames only, others are left untouched.
+*   Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, x, y,
+*   SPRITE_FLIP_H and/or SPRITE_FLIP_V, or 0
+*  Outputs: none
+*/
+void sprite_blit( frame_buffer_t *f, const sprite_obj_t *s, int x, int y,
+	int flags );
+
+/******** sprite_blitAffine *********
+*  Draws a sprite through an affine transform from sprite to frame
+*  coordinates, nearest neighbour, clipped to the buffer. Each destination
+*  row inside the transformed bounding box is walked with the source
+*  position stepped by the inverse transform, no per pixel multiplies.
+*  Pixels matching the key are left untouched. 4bpp frames only.
+*   Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, pointer
+*   to the transform
+*  Outputs: none
+*/
+void sprite_blitAffine( frame_buffer_t *f, const sprite_obj_t *s,
+	const fixed_affine_t *m );
+
+/******** sprite_blitRotated *********
+*  Draws a sprite rotated and scaled about its centre, see
+*  sprite_blitAffine.
+*   Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, centre
+*   x, y in the frame, angle (0x10000 per turn), Q16.16 scale
+*  Outputs: none
+*/
+void sprite_blitRotated( frame_buffer_t *f, const sprite_obj_t *s, int x,
+	int y, fixed_angle_t angle, q16_t scale );
+
+/******** sprite_span *********
+*  Draws destination pixels x0 to x1 (exclusive) of a frame row from packed
+*  4bpp source pixels, starting at source pixel sx and stepping by step
+*  (1 or -1). Pixels equal to key are skipped. No clipping or damage
+*  tracking.
+*   Inputs: frame row, source row, x0, x1, sx, step, grey level key or
+*   SPRITE_NO_KEY
+*  Outputs: none
+*/
+void sprite_span( volatile uint8_t *d, const uint8_t *src, int x0,
+	int x1, int sx, int step, int key );
+
 #define SPRITE_H_ 1
-#endif
\ No newline at end of file
+#endif
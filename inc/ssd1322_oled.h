@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include "lowlevel.h"
 #include "systick.h"
+#include "frame.h"
+#include "crc.h"
 
 #define OLED_EN_GRAY 0x000
 #define OLED_DEFAULT_GRAYTABLE 0x0B9
@@ -35,8 +37,45 @@
 #define OLED_MAGIC_1 0x0B4
 #define OLED_MAGIC_2 0x0D1
 
+/* Visible panel, and the first display RAM column (4 pixels each) in view.
+*  Display RAM holds 128 rows, two pages of the 64 row panel. */
+#define OLED_WIDTH 256
+#define OLED_HEIGHT 64
+#define OLED_COL_OFFSET 0x1C
+#define OLED_RAM_ROWS 128
+
+/* D/C bit of a 9-bit word, set for data and parameters. */
+#define OLED_DATA 0x100
+
+/* Pixel bytes expanded per ping-pong half on the 3-wire transport, and for
+*  1 and 2bpp frames on either. */
+#ifndef OLED_CHUNK
+#define OLED_CHUNK 64
+#endif
+
+/* Words held by a RAM command buffer. */
+#ifndef OLED_CMDBUF_SIZE
+#define OLED_CMDBUF_SIZE 16
+#endif
+
+/* SysTick ticks the blocking helpers wait for the display link before
+*  giving up, 50ms. */
+#ifndef OLED_WAIT_TICKS
+#define OLED_WAIT_TICKS 5000
+#endif
+
+/* Short RAM command list for sequences with run-time parameters. */
+struct oled_cmdbuf
+{
+	uint16_t words[OLED_CMDBUF_SIZE];
+	int length;
+};
+
+typedef struct oled_cmdbuf oled_cmdbuf_t;
+
 /******** Oled_init *********
-*  Initializes the display controller.
+*  Initializes the display controller. Waits for the display link between
+*  steps, the scheduler and SysTick must be running.
 *   Inputs: none
 *  Outputs: none
 */
@@ -50,11 +89,13 @@ void Oled_init(void);
 void Oled_reset(void);
 
 /******** Oled_clear *********
-*  Clears the ssd1322 display memory.
+*  Clears both pages of the ssd1322 display memory. Waits up to
+*  OLED_WAIT_TICKS for the display link to be free, not from interrupt
+*  context.
 *   Inputs: none
-*  Outputs: none
+*  Outputs: 1 if the clear started, 0 if the link stayed busy
 */
-void Oled_clear(void);
+int Oled_clear(void);
 
 /******** Oled_on *********
 *  Turns the ssd1322 display on.
@@ -85,11 +126,11 @@ void Oled_invert(void);
 void Oled_normal(void);
 
 /******** Oled_test *********
-*  Test command sequence.
+*  Test command sequence. Waits like Oled_clear.
 *   Inputs: none
-*  Outputs: none
+*  Outputs: 1 if the ramp started, 0 if the link stayed busy
 */
-void Oled_test(void);
+int Oled_test(void);
 
 /******** Oled_sendCmd *********
 *  Sends a single byte command to the display controller.
@@ -105,12 +146,169 @@ void Oled_sendCmd( uint8_t cmd );
 */
 void Oled_sendData( uint8_t data );
 
+/******** Oled_sendSeq *********
+*  Sends a list of 9-bit command words (OLED_DATA set on parameters) by
+*  reference, bypassing the SPI queue. The list must stay valid until the
+*  callback runs, flash-resident const lists always do.
+*   Inputs: pointer to the command words, number of words, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_sendSeq( const volatile uint16_t *seq, int length, 
+	void(*done)(void) );
+
+/******** Oled_cmdReset *********
+*  Empties a RAM command buffer.
+*   Inputs: pointer to an oled_cmdbuf_t
+*  Outputs: none
+*/
+void Oled_cmdReset( oled_cmdbuf_t *b );
+
+/******** Oled_cmdAdd *********
+*  Appends a command byte to a RAM command buffer.
+*   Inputs: pointer to an oled_cmdbuf_t, command byte
+*  Outputs: none
+*/
+void Oled_cmdAdd( oled_cmdbuf_t *b, uint8_t cmd );
+
+/******** Oled_cmdParam *********
+*  Appends a parameter byte to a RAM command buffer.
+*   Inputs: pointer to an oled_cmdbuf_t, parameter byte
+*  Outputs: none
+*/
+void Oled_cmdParam( oled_cmdbuf_t *b, uint8_t value );
+
+/******** Oled_cmdSend *********
+*  Sends the contents of a RAM command buffer by reference. The buffer must
+*  not be modified until the callback runs.
+*   Inputs: pointer to an oled_cmdbuf_t, completion callback or NULL
+*  Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_cmdSend( oled_cmdbuf_t *b, void(*done)(void) );
+
+/******** Oled_expandData *********
+*  Expands packed 4bpp pixel bytes into 9-bit data words (OLED_DATA | byte).
+*  Reads the source a word at a time, four bytes per step.
+*   Inputs: 16-bit aligned destination, source bytes, number of bytes
+*  Outputs: none
+*/
+void Oled_expandData( uint16_t *dst, const volatile uint8_t *src, int length );
+
+/******** Oled_writeWindow *********
+*  Streams rows of packed 4bpp pixel bytes into display RAM at the current
+*  write pointer. 3-wire: rows are expanded in OLED_CHUNK byte pieces into a
+*  ping-pong pair, one half is DMA'd while the other is refilled.
+*  4-wire: rows are DMA'd straight from the source.
+*   Inputs: pointer to the first byte, bytes per row, number of rows,
+*           bytes between rows in the source, completion callback or NULL
+*  Outputs: 1 if the stream started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeWindow( const volatile uint8_t *src, int row_bytes, int rows,
+	int stride, void(*done)(void) );
+
+/******** Oled_writeData *********
+*  Streams a contiguous block of packed 4bpp pixel bytes into display RAM at
+*  the current write pointer.
+*   Inputs: pointer to pixel bytes, number of bytes, completion callback
+*  Outputs: 1 if the stream started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeData( const volatile uint8_t *data, int length, 
+	void(*done)(void) );
+
+/******** Oled_writeRect *********
+*  Sets the display RAM address window and streams a rectangle of packed
+*  4bpp pixels into it. The controller addresses columns in groups of four
+*  pixels, so x and width must be multiples of 4. y is a display RAM row.
+*   Inputs: x, y, width and height in pixels, pointer to the rectangle's
+*           first byte, bytes between rows in the source, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeRect( int x, int y, int width, int height, 
+	const volatile uint8_t *src, int stride, void(*done)(void) );
+
+/******** Oled_flush *********
+*  Brings the display up to date with a frame buffer. Only the regions marked
+*  dirty since the last flush are sent, each as a column/row window followed
+*  by OLED_WRITE and the pixels streamed by DMA, bypassing the SPI queue.
+*  With page flipping on, the regions go to the hidden page, which is then
+*  brought into view. 1 and 2bpp frames are expanded to 4bpp through their
+*  palette as they are sent. The frame's readyFlag is taken for the duration
+*  and signalled once the last pixel is out. With damage detection on the
+*  frame is scanned first, so call from main context.
+*   Inputs: pointer to a frame_buffer_t
+*  Outputs: 1 if the flush started, 0 if the display link is busy
+*/
+int Oled_flush( frame_buffer_t *f );
+
+/******** Oled_flushNotify *********
+*  Oled_flush with a completion callback, run from interrupt context after the
+*  readyFlag is signalled. With nothing dirty it runs before returning. Only
+*  starts the transfers, safe to call from an interrupt; with damage
+*  detection on, the caller runs Oled_damageScan on the frame first.
+*   Inputs: pointer to a frame_buffer_t, completion callback or NULL
+*  Outputs: 1 if the flush started, 0 if the display link is busy
+*/
+int Oled_flushNotify( frame_buffer_t *f, void(*done)(void) );
+
+/******** Oled_damageScan *********
+*  With damage detection on, replaces the frame's dirty regions with the
+*  runs of rows whose CRC differs from the last frame scanned. Call once per
+*  frame from main context, before the frame is flushed.
+*   Inputs: pointer to a frame_buffer_t about to be flushed
+*  Outputs: none
+*/
+void Oled_damageScan( frame_buffer_t *f );
+
+/******** Oled_pageFlip *********
+*  Switches double buffering in display RAM on or off. When on, flushes go to
+*  the off-screen rows and OLED_START_LINE flips them into view, so a frame
+*  never shows half drawn. The next flush sends the whole frame.
+*   Inputs: 1 to enable, 0 to write the visible page directly
+*  Outputs: none
+*/
+void Oled_pageFlip( int enable );
+
+/******** Oled_damageDetect *********
+*  Switches automatic damage detection on or off. When on, Oled_damageScan
+*  hashes each frame's rows with the CRC unit and sends only runs of rows
+*  that changed since the last flush, in place of the regions drawing marked
+*  dirty. Rows must be whole, aligned words. The first flush after switching
+*  on sends the whole frame, switch on again after writing display RAM by
+*  other means.
+*   Inputs: 1 to enable, 0 to send the dirty regions
+*  Outputs: none
+*/
+void Oled_damageDetect( int enable );
+
+/******** Oled_busy *********
+*  Reports whether a pixel stream is in flight.
+*   Inputs: none
+*  Outputs: 1 while streaming, 0 when idle
+*/
+int Oled_busy(void);
+
 // ******* Spi_send *******
 // Adds arbitrary number of elements to the UART transmission buffer.
 //  Inputs: pointer to a contiguous block of data, number of elements to copy
 // Outputs: none
 extern void Spi_send( volatile void* data, int length );
 
+/********* Spi_dmaTxStream *******
+*  Starts a DMA transfer that bypasses the SPI queue.
+*   Inputs: pointer to a contiguous block of frames, number of frames,
+*           D/C level for the 4-wire transport, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+extern int Spi_dmaTxStream( volatile void* data, int length, int dc, 
+	void(*done)(void) );
+
+/********* Spi_dmaTxWords *******
+*  Streams 9-bit words (D/C in bit 8) outside of the SPI queue.
+*   Inputs: pointer to 9-bit words, number of words, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+extern int Spi_dmaTxWords( const volatile uint16_t* words, int length, 
+	void(*done)(void) );
+
 /********* Uart_send *******
 *  Adds arbitrary number of bytes to the UART transmission queue.
 *   Inputs: pointer to a contiguous block of data, the number of bytes to read.
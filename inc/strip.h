@@ -0,0 +1,100 @@
+#ifndef STRIP_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ssd1322_oled.h"
+#include "sprite.h"
+
+/* Rows per band. Two bands of OLED_WIDTH / 2 bytes per row are held. */
+#ifndef STRIP_ROWS
+#define STRIP_ROWS 8
+#endif
+
+/* Display list capacity. */
+#ifndef STRIP_ITEMS_MAX
+#define STRIP_ITEMS_MAX 32
+#endif
+
+/* Display list item types. */
+#define STRIP_RECT   0
+#define STRIP_SPRITE 1
+#define STRIP_TEXT   2
+
+struct strip_item
+{
+	uint8_t type;
+	uint8_t value;        /* grey level, sprite flags for STRIP_SPRITE      */
+	int16_t x;
+	int16_t y;
+	int16_t w;
+	int16_t h;            /* rows covered, used to skip bands               */
+	const void *data;     /* sprite_obj_t or NUL terminated text            */
+};
+
+typedef struct strip_item strip_item_t;
+
+struct strip_list
+{
+	strip_item_t items[STRIP_ITEMS_MAX];
+	int count;
+};
+
+typedef struct strip_list strip_list_t;
+
+/******** Strip_init *********
+*  Prepares the band buffers. Strip rendering owns OLED_START_LINE while in
+*  use, so display RAM page flipping and the console must be off.
+*   Inputs: none
+*  Outputs: none
+*/
+void Strip_init(void);
+
+/******** Strip_listClear *********
+*  Empties a display list.
+*   Inputs: pointer to a strip_list_t
+*  Outputs: none
+*/
+void Strip_listClear( strip_list_t *list );
+
+/******** Strip_rect *********
+*  Appends a filled rectangle to a display list.
+*   Inputs: pointer to a strip_list_t, x, y, width, height, grey level
+*  Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_rect( strip_list_t *list, int x, int y, int width, int height,
+	int value );
+
+/******** Strip_sprite *********
+*  Appends a sprite to a display list. The sprite must stay valid until
+*  the list is drawn.
+*   Inputs: pointer to a strip_list_t, pointer to a sprite_obj_t, x, y,
+*   sprite_blit flags
+*  Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_sprite( strip_list_t *list, const sprite_obj_t *s, int x, int y,
+	int flags );
+
+/******** Strip_text *********
+*  Appends a line of 5x7 console font text to a display list. The text
+*  must stay valid until the list is drawn.
+*   Inputs: pointer to a strip_list_t, NUL terminated text, x, y, grey level
+*  Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_text( strip_list_t *list, const char *text, int x, int y,
+	int value );
+
+/******** Strip_draw *********
+*  Renders a display list band by band into the hidden display RAM page and
+*  flips it into view. Each band is sent by DMA while the next one renders
+*  into the other band buffer; items are drawn in list order and skipped in
+*  bands they do not touch. Returns once the last band is out. Each wait for
+*  the link gives up after OLED_WAIT_TICKS; the bands not yet sent are then
+*  dropped and the visible page is left as it was.
+*   Inputs: pointer to a strip_list_t, background grey level
+*  Outputs: 1 if the page was flipped into view, 0 on a timeout
+*/
+int Strip_draw( const strip_list_t *list, int background );
+
+#define STRIP_H_ 1
+#endif
@@ -7,6 +7,9 @@
 #include <libopencm3/cm3/cortex.h>
 #include <stdint.h>
 
+/* SysTick interrupt rate, one tick every 10 microseconds. */
+#define SYSTICK_HZ 100000
+
 // ******* Systick_init *******
 // Initializes the SysTick interrupt timer.
 //  Inputs: none
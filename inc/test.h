@@ -4,6 +4,8 @@
 #include <libopencm3/stm32/gpio.h>
 
 #include "systick.h"
+#include "frame.h"
+#include "sprite.h"
 
 #define NUM_TESTS 1
 
@@ -64,6 +66,17 @@ void Test_out( volatile test_table_t *t, int out );
 */
 void Test_calculate( volatile test_table_t *t );
 
+/******** Test_frameBench *********
+*  Times filling a frame buffer pixel by pixel, without damage tracking,
+*  against the word kernels, and a 64x64 sprite_blitRotated on 4bpp
+*  buffers. Reports the durations in SysTick ticks via serial terminal.
+*  Overwrites the buffer's contents. tools/frame_bench checks the same
+*  kernels for correctness on the build host.
+*   Inputs: pointer to a frame_buffer_t
+*  Outputs: none
+*/
+void Test_frameBench( frame_buffer_t *f );
+
 /* External fuctions */
 
 /********* Uart_send *******
@@ -0,0 +1,103 @@
+#ifndef TILEMAP_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "sprite.h"
+
+/* Square 4bpp tiles, normally in flash. Tile n is size * size / 2 bytes at
+*  data + n * size * size / 2, rows packed like sprite bitmaps. */
+struct tileset
+{
+	uint8_t size;           /* 8 or 16 pixels                           */
+	uint16_t count;
+	const uint8_t *data;
+};
+
+typedef struct tileset tileset_t;
+
+/* A map of tile numbers, one byte per tile, row by row. Pixels outside the
+*  map show tile 0. */
+struct tilemap
+{
+	const tileset_t *tiles;
+	uint16_t width;         /* tiles                                    */
+	uint16_t height;
+	const uint8_t *index;
+};
+
+typedef struct tilemap tilemap_t;
+
+/* Where a view of the map was last drawn. The frame itself is the cache:
+*  a frame holding the last view is scrolled in place and only the newly
+*  exposed strips are rendered from the tile set. */
+struct tilemap_view
+{
+	const tilemap_t *map;
+	int16_t x;              /* frame rectangle, clipped                 */
+	int16_t y;
+	int16_t width;
+	int16_t height;
+	int px;                 /* map pixel at the rectangle's top left    */
+	int py;
+	int valid;
+};
+
+typedef struct tilemap_view tilemap_view_t;
+
+/******** tilemap_viewInit *********
+*  Initializes a view of a map, drawn in full by the first tilemap_draw.
+*   Inputs: pointer to a tilemap_view_t, pointer to the map
+*  Outputs: none
+*/
+void tilemap_viewInit( tilemap_view_t *v, const tilemap_t *map );
+
+/******** tilemap_draw *********
+*  Draws the map pixels from px, py into a rectangle of a 4bpp frame and
+*  marks what changed dirty. The frame must still hold the view as the
+*  last call left it, as frames from Pipe_acquire do; anything drawn over
+*  it since is put back with tilemap_restore first. When the rectangle is
+*  the same and the view moved by an even number of pixels across, the
+*  rows are scrolled in place, a word at a time where they line up, and
+*  only the exposed strips are rendered; otherwise the view is rendered
+*  in full. The view is kept inside the map. Other formats are left
+*  untouched.
+*   Inputs: pointer to a tilemap_view_t, pointer to a frame_buffer_t,
+*   frame x, y, width, height, map pixel x, y of the view's top left
+*  Outputs: number of pixels rendered from the tile set
+*/
+int tilemap_draw( tilemap_view_t *v, frame_buffer_t *f, int x, int y,
+	int width, int height, int px, int py );
+
+/******** tilemap_restore *********
+*  Renders part of the view again where it was last drawn, for under
+*  sprites and text drawn over it, and marks it dirty.
+*   Inputs: pointer to a tilemap_view_t, pointer to a frame_buffer_t,
+*   frame x, y, width, height
+*  Outputs: none
+*/
+void tilemap_restore( tilemap_view_t *v, frame_buffer_t *f, int x, int y,
+	int width, int height );
+
+/******** tilemap_drawDirect *********
+*  Draws the map pixels from px, py into a rectangle of a 4bpp frame
+*  straight from the tile set, every pixel each call. Other formats are
+*  left untouched.
+*   Inputs: pointer to the map, pointer to a frame_buffer_t, frame x, y,
+*   width, height, map pixel x, y of the view's top left
+*  Outputs: none
+*/
+void tilemap_drawDirect( const tilemap_t *map, frame_buffer_t *f, int x,
+	int y, int width, int height, int px, int py );
+
+/******** tilemap_invalidate *********
+*  Has the next tilemap_draw render the view in full, for after the map's
+*  index changes or when drawing into a frame that does not hold the view.
+*   Inputs: pointer to a tilemap_view_t
+*  Outputs: none
+*/
+void tilemap_invalidate( tilemap_view_t *v );
+
+#define TILEMAP_H_ 1
+#endif
@@ -0,0 +1,142 @@
+#ifndef WIDGET_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "font.h"
+#include "draw.h"
+#include "fixed.h"
+
+/* Flags. */
+#define WIDGET_HIDDEN      0x01
+#define WIDGET_DIRTY       0x02     /* repaint this widget and its children */
+#define WIDGET_CHILD_DIRTY 0x04     /* something below needs repainting     */
+#define WIDGET_ERASE       0x08     /* blank its rectangle to 0 first       */
+
+/* Background level for widgets that paint over their parent. Repainting
+*  one that draws repaints the nearest ancestor with a background. */
+#define WIDGET_NO_BACK (-1)
+
+typedef struct widget widget_t;
+
+/* Draws a widget whose top left corner is at x, y of f. f is a view of the
+*  widget's rectangle, drawing outside it is clipped. */
+typedef void (*widget_draw_t)( widget_t *w, frame_buffer_t *f, int x, int y );
+
+/* A node of the widget tree. Bounds are relative to the parent and should
+*  start on whole frame bytes (even x at 4bpp), views are byte aligned.
+*  Siblings must not overlap. */
+struct widget
+{
+	int16_t x;
+	int16_t y;
+	int16_t width;
+	int16_t height;
+	widget_draw_t draw;     /* NULL for plain containers                */
+	widget_t *parent;
+	widget_t *child;        /* first child, painted in list order       */
+	widget_t *next;         /* next sibling                             */
+	uint8_t flags;
+	int8_t back;            /* filled before draw, or WIDGET_NO_BACK    */
+	uint8_t fore;           /* grey level for bars and gauges           */
+
+	/* Properties for the built-in draw functions. */
+	int32_t value;
+	int32_t max;
+	const char *text;
+	uint16_t textSum;       /* checksum of text's contents when set     */
+	const font_t *font;
+};
+
+/******** widget_init *********
+*  Initializes a widget, dirty so the first redraw paints it.
+*   Inputs: pointer to a widget_t, x, y relative to the parent, width,
+*   height, draw function or NULL, background level or WIDGET_NO_BACK
+*  Outputs: none
+*/
+void widget_init( widget_t *w, int x, int y, int width, int height,
+	widget_draw_t draw, int back );
+
+/******** widget_add *********
+*  Appends a widget to a parent's children and invalidates it.
+*   Inputs: pointer to the parent, pointer to the child
+*  Outputs: none
+*/
+void widget_add( widget_t *parent, widget_t *child );
+
+/******** widget_invalidate *********
+*  Marks a widget's rectangle for repainting by the next widget_redraw.
+*  A widget that draws without a background paints over what is behind
+*  it, so the nearest ancestor with one is repainted in its place, or
+*  without one the rectangle is blanked to level 0 first.
+*   Inputs: pointer to a widget_t
+*  Outputs: none
+*/
+void widget_invalidate( widget_t *w );
+
+/******** widget_setValue *********
+*  Sets a widget's value, invalidating it if it changed.
+*   Inputs: pointer to a widget_t, value
+*  Outputs: none
+*/
+void widget_setValue( widget_t *w, int32_t value );
+
+/******** widget_setText *********
+*  Sets a widget's text, invalidating it if it changed. The text is held by
+*  reference; a buffer rewritten in place and set again is caught by a
+*  checksum of its contents, call widget_invalidate to be certain.
+*   Inputs: pointer to a widget_t, NUL terminated text
+*  Outputs: none
+*/
+void widget_setText( widget_t *w, const char *text );
+
+/******** widget_setHidden *********
+*  Hides or shows a widget. Hiding it repaints the nearest ancestor with a
+*  background level, or blanks its rectangle to level 0 if none has one.
+*   Inputs: pointer to a widget_t, 1 to hide, 0 to show
+*  Outputs: none
+*/
+void widget_setHidden( widget_t *w, int hidden );
+
+/******** widget_redraw *********
+*  Repaints the invalidated widgets of a tree, each through a view of its
+*  rectangle clipped to its parent's, and marks their rectangles dirty for
+*  a partial flush. Subtrees without invalidated widgets are skipped, a
+*  static screen costs one flag test.
+*   Inputs: pointer to the root widget, pointer to a frame_buffer_t, the
+*   root's bounds being frame coordinates
+*  Outputs: number of widgets painted
+*/
+int widget_redraw( widget_t *root, frame_buffer_t *f );
+
+/******** widget_bounds *********
+*  Finds where a widget is on the frame, for widgets that draw between
+*  redraws.
+*   Inputs: pointer to a widget_t, pointer to a frame_buffer_t, pointers
+*   to the frame x, y of its top left corner, pointer to a frame_rect_t to
+*   receive its rectangle clipped to its ancestors and the frame
+*  Outputs: 1, or 0 when it or an ancestor is hidden or it is clipped away
+*/
+int widget_bounds( widget_t *w, frame_buffer_t *f, int *x, int *y,
+	frame_rect_t *clip );
+
+/******** widget_drawLabel *********
+*  Draw function for text, the widget's font and text at its top left.
+*/
+void widget_drawLabel( widget_t *w, frame_buffer_t *f, int x, int y );
+
+/******** widget_drawBar *********
+*  Draw function for a horizontal bar filled value / max of its width in
+*  the foreground level, with an outline.
+*/
+void widget_drawBar( widget_t *w, frame_buffer_t *f, int x, int y );
+
+/******** widget_drawGauge *********
+*  Draw function for a dial, a needle from the centre of the bottom edge
+*  swept from left (0) to right (max) through the top.
+*/
+void widget_drawGauge( widget_t *w, frame_buffer_t *f, int x, int y );
+
+#define WIDGET_H_ 1
+#endif
@@ -0,0 +1,337 @@
+#include "anim.h"
+
+static anim_obj_t *anim_list;          /* shown animations              */
+static int anim_running;               /* playing or moving, event flag */
+static uint32_t anim_last;             /* time the event last ran       */
+
+/******** anim_init *********
+* Adds the animation event to the scheduler. It only runs while an
+* animation is playing or moving, idle screens cost nothing.
+*  Inputs: none
+* Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int anim_init(void)
+{
+	anim_list = NULL;
+	anim_running = 0;
+	return Sched_addEvent( &anim_event, ANIM_PERIOD_MS * ANIM_TICKS_PER_MS,
+		NULL, &anim_running );
+}
+
+/******** anim_objInit *********
+* Initializes an animation over a sequence of frames.
+*  Inputs: pointer to an anim_obj_t, frames, number of frames, ANIM_ONCE,
+*  ANIM_LOOP or ANIM_PINGPONG
+* Outputs: none
+*/
+void anim_objInit( anim_obj_t *a, const anim_frame_t *frames, int count,
+	int mode )
+{
+	a->frames = frames;
+	a->count = count;
+	a->mode = mode;
+	a->index = 0;
+	a->dir = 1;
+	a->elapsed = 0;
+	a->x = 0;
+	a->y = 0;
+	a->tween_left = 0;
+	a->running = 0;
+	a->shown_index = -1;
+	a->drawn.x0 = a->drawn.x1 = 0;
+	a->drawn.y0 = a->drawn.y1 = 0;
+	a->next = NULL;
+}
+
+/******** anim_finished *********
+* Whether a sequence has nothing left to play.
+*/
+static int anim_finished( anim_obj_t *a )
+{
+	return ( a->count < 2 ) || ( ( a->mode == ANIM_ONCE ) && ( a->index == a->count - 1 ) );
+}
+
+/******** anim_start *********
+* Hands an animation to the event if it has anything left to do. Called
+* with interrupts off.
+*/
+static void anim_start( anim_obj_t *a )
+{
+	if ( a->running || ( anim_finished(a) && !a->tween_left ) )
+	{
+		return;
+	}
+
+	/* The event was idle, time starts now rather than when it last ran. */
+	if ( !anim_running )
+	{
+		anim_last = Systick_timeGetCount();
+	}
+
+	a->running = 1;
+	anim_running++;
+}
+
+/******** anim_play *********
+* Shows an animation at x, y and starts it from its first frame.
+*  Inputs: pointer to an anim_obj_t, x, y
+* Outputs: none
+*/
+void anim_play( anim_obj_t *a, int x, int y )
+{
+	anim_obj_t *p;
+
+	cm_disable_interrupts();
+
+	for ( p = anim_list; p && ( p != a ); p = p->next );
+	if ( !p )
+	{
+		a->next = anim_list;
+		anim_list = a;
+	}
+
+	a->index = 0;
+	a->dir = 1;
+	a->elapsed = 0;
+	a->x = Q16_INT( x );
+	a->y = Q16_INT( y );
+	a->tween_left = 0;
+	anim_start(a);
+
+	cm_enable_interrupts();
+}
+
+/******** anim_stop *********
+* Stops and hides an animation, marking where it was drawn as dirty.
+*  Inputs: pointer to a frame_buffer_t, pointer to an anim_obj_t
+* Outputs: none
+*/
+void anim_stop( frame_buffer_t *f, anim_obj_t *a )
+{
+	anim_obj_t **pp;
+
+	cm_disable_interrupts();
+
+	for ( pp = &anim_list; *pp; pp = &(*pp)->next )
+	{
+		if ( *pp == a )
+		{
+			*pp = a->next;
+			break;
+		}
+	}
+
+	if ( a->running )
+	{
+		a->running = 0;
+		anim_running--;
+	}
+
+	cm_enable_interrupts();
+
+	frame_dirtyAdd( f, a->drawn.x0, a->drawn.y0, a->drawn.x1, a->drawn.y1 );
+	a->drawn.x0 = a->drawn.x1 = 0;
+	a->drawn.y0 = a->drawn.y1 = 0;
+	a->shown_index = -1;
+}
+
+/******** anim_moveTo *********
+* Tweens an animation's position linearly to x, y.
+*  Inputs: pointer to an anim_obj_t, x, y, duration in milliseconds, 0
+*  jumps straight there
+* Outputs: none
+*/
+void anim_moveTo( anim_obj_t *a, int x, int y, int ms )
+{
+	int32_t ticks = ms * ANIM_TICKS_PER_MS;
+
+	cm_disable_interrupts();
+
+	a->to_x = Q16_INT( x );
+	a->to_y = Q16_INT( y );
+
+	if ( ticks <= 0 )
+	{
+		a->x = a->to_x;
+		a->y = a->to_y;
+		a->tween_left = 0;
+	}
+	else
+	{
+		/* One divide per move, the event only adds. */
+		a->vx = ( a->to_x - a->x ) / ticks;
+		a->vy = ( a->to_y - a->y ) / ticks;
+		a->tween_left = ticks;
+		anim_start(a);
+	}
+
+	cm_enable_interrupts();
+}
+
+/******** anim_advance *********
+* Moves a sequence on by dt ticks.
+*/
+static void anim_advance( anim_obj_t *a, uint32_t dt )
+{
+	uint32_t dur;
+
+	if ( anim_finished(a) )
+	{
+		return;
+	}
+
+	a->elapsed += dt;
+
+	for ( ;; )
+	{
+		dur = a->frames[a->index].duration * ANIM_TICKS_PER_MS;
+		if ( dur == 0 )
+		{
+			dur = 1;
+		}
+
+		if ( a->elapsed < dur )
+		{
+			return;
+		}
+
+		a->elapsed -= dur;
+
+		if ( a->mode == ANIM_LOOP )
+		{
+			a->index = ( a->index + 1 == a->count ) ? 0 : a->index + 1;
+		}
+		else if ( a->mode == ANIM_PINGPONG )
+		{
+			if ( ( a->index + a->dir < 0 ) || ( a->index + a->dir >= a->count ) )
+			{
+				a->dir = -a->dir;
+			}
+			a->index += a->dir;
+		}
+		else
+		{
+			a->index++;
+			if ( anim_finished(a) )
+			{
+				a->elapsed = 0;
+				return;
+			}
+		}
+	}
+}
+
+/******** anim_event *********
+* Scheduler event, advances the playing animations by the time since it
+* last ran. Finished ones drop out, when none are left the scheduler stops
+* calling it.
+*  Inputs: unused queue, pointer to the count of playing animations
+* Outputs: none
+*/
+void anim_event( Queue_t *queue, int *flagPt )
+{
+	uint32_t now = Systick_timeGetCount();
+	uint32_t dt = Systick_timeDelta( anim_last, now );
+	uint32_t step;
+	anim_obj_t *a;
+
+	anim_last = now;
+
+	for ( a = anim_list; a; a = a->next )
+	{
+		if ( !a->running )
+		{
+			continue;
+		}
+
+		if ( a->tween_left )
+		{
+			step = ( dt < a->tween_left ) ? dt : a->tween_left;
+			a->tween_left -= step;
+
+			if ( a->tween_left )
+			{
+				a->x += a->vx * (int32_t) step;
+				a->y += a->vy * (int32_t) step;
+			}
+			else
+			{
+				a->x = a->to_x;
+				a->y = a->to_y;
+			}
+		}
+
+		anim_advance( a, dt );
+
+		if ( !a->tween_left && anim_finished(a) )
+		{
+			a->running = 0;
+			(*flagPt)--;
+		}
+	}
+}
+
+/******** anim_update *********
+* Takes the animations' progress since the last call. Each one that moved
+* or changed frame has its old and new bounding boxes marked dirty, the
+* application restores the background there before anim_draw.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: number of animations that changed
+*/
+int anim_update( frame_buffer_t *f )
+{
+	const sprite_obj_t *s;
+	anim_obj_t *a;
+	int index, x, y, changed = 0;
+
+	for ( a = anim_list; a; a = a->next )
+	{
+		cm_disable_interrupts();
+		index = a->index;
+		x = a->x >> 16;
+		y = a->y >> 16;
+		cm_enable_interrupts();
+
+		if ( ( index == a->shown_index ) && ( x == a->shown_x ) && ( y == a->shown_y ) )
+		{
+			continue;
+		}
+
+		a->shown_index = index;
+		a->shown_x = x;
+		a->shown_y = y;
+
+		frame_dirtyAdd( f, a->drawn.x0, a->drawn.y0, a->drawn.x1, a->drawn.y1 );
+
+		s = a->frames[index].sprite;
+		a->drawn.x0 = x;
+		a->drawn.y0 = y;
+		a->drawn.x1 = x + s->width;
+		a->drawn.y1 = y + s->height;
+
+		frame_dirtyAdd( f, a->drawn.x0, a->drawn.y0, a->drawn.x1, a->drawn.y1 );
+		changed++;
+	}
+
+	return changed;
+}
+
+/******** anim_draw *********
+* Draws every shown animation as of the last anim_update.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void anim_draw( frame_buffer_t *f )
+{
+	const anim_frame_t *fr;
+	anim_obj_t *a;
+
+	for ( a = anim_list; a; a = a->next )
+	{
+		if ( a->shown_index >= 0 )
+		{
+			fr = &a->frames[a->shown_index];
+			sprite_blit( f, fr->sprite, a->shown_x, a->shown_y, fr->flags );
+		}
+	}
+}
@@ -0,0 +1,315 @@
+#include "console.h"
+
+#include <string.h>
+
+/* 5x7 glyphs for ASCII 0x20-0x7E, one byte per column, bit 0 at the top. */
+static const uint8_t console_font[][5] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 },
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },
+	{ 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 },
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 },
+	{ 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 },
+	{ 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 },
+	{ 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 },
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 },
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E },
+	{ 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 },
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 },
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E },
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 },
+	{ 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x49, 0x49, 0x7A },
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 },
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x0C, 0x02, 0x7F },
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E },
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 },
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F },
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F },
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x07, 0x08, 0x70, 0x08, 0x07 },
+	{ 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 },
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },
+	{ 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },
+	{ 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 },
+	{ 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 },
+	{ 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x0C, 0x52, 0x52, 0x52, 0x3E },
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 },
+	{ 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 },
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 },
+	{ 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },
+	{ 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C },
+	{ 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+	{ 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C },
+	{ 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C },
+	{ 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },
+	{ 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 },
+	{ 0x08, 0x04, 0x08, 0x10, 0x08 }
+};
+
+/* Scrollback text, line n lives in slot n % CONSOLE_HISTORY. */
+static char console_text[CONSOLE_HISTORY][CONSOLE_COLS];
+static int console_count;      /* completed lines                       */
+static int console_col;        /* characters in the line being written  */
+static int console_back;       /* lines scrolled back from the newest   */
+
+/* Line held by each band of display RAM, -1 when unknown. */
+static int console_bandLine[CONSOLE_BANDS];
+static int console_startLine;
+
+/* One rendered band, DMA'd to display RAM. */
+static uint8_t console_band[CONSOLE_LINE_H][OLED_WIDTH / 2]
+	__attribute__((aligned(4)));
+static frame_buffer_t console_frame;
+
+static oled_cmdbuf_t console_cmds;
+static volatile int console_busy;
+
+/******** console_sent *********
+* Display transfer completed, the band buffer is free again.
+*/
+static void console_sent(void)
+{
+	console_busy = 0;
+}
+
+/******** Console_glyph *********
+* Returns the 5x7 glyph for a character, one byte per column with bit 0 at
+* the top. Characters outside ASCII 0x20-0x7E map to '?'.
+*  Inputs: character
+* Outputs: pointer to 5 column bytes in flash
+*/
+const uint8_t *Console_glyph( char c )
+{
+	if ( ( c < 0x20 ) || ( c > 0x7E ) )
+	{
+		c = '?';
+	}
+
+	return console_font[c - 0x20];
+}
+
+/******** Console_drawChar *********
+* Draws a character's 5x7 glyph, as Console_glyph gives it, into a 4bpp
+* frame with its top left corner at x, y. Set pixels take a grey level,
+* the rest are left alone. Clipped to the frame, no damage tracking.
+*  Inputs: pointer to a frame_buffer_t, x, y, character, grey level
+* Outputs: none
+*/
+void Console_drawChar( frame_buffer_t *f, int x, int y, char c, int value )
+{
+	const uint8_t *glyph = Console_glyph( c );
+	uint8_t bits;
+	int k, r, px;
+
+	for ( k = 0; k < 5; k++ )
+	{
+		px = x + k;
+		if ( ( px < 0 ) || ( px >= f->width ) )
+		{
+			continue;
+		}
+
+		for ( r = 0, bits = glyph[k]; bits; r++, bits >>= 1 )
+		{
+			if ( ( bits & 1 ) && ( y + r >= 0 ) && ( y + r < f->height ) )
+			{
+				/* Even pixels in the low nibble. */
+				write_bits( f->data[( y + r ) * f->h_width + ( px >> 1 )],
+					( px & 1 ) << 2, 4, value );
+			}
+		}
+	}
+}
+
+/******** console_render *********
+* Draws one line of scrollback text into the band buffer. The unwritten
+* rest of the line is NUL and stays blank.
+*/
+static void console_render( int line )
+{
+	const char *text = console_text[line % CONSOLE_HISTORY];
+	int c;
+
+	memset( console_band, 0, sizeof( console_band ) );
+
+	for ( c = 0; c < CONSOLE_COLS; c++ )
+	{
+		if ( text[c] )
+		{
+			Console_drawChar( &console_frame, c * CONSOLE_CELL_W, 0, text[c],
+				CONSOLE_FG );
+		}
+	}
+}
+
+/******** console_newLine *********
+* Completes the line being written and starts an empty one.
+*/
+static void console_newLine(void)
+{
+	console_count++;
+	console_col = 0;
+	memset( console_text[console_count % CONSOLE_HISTORY], 0, CONSOLE_COLS );
+}
+
+/******** Console_init *********
+* Starts an empty console. The console owns OLED_START_LINE while in use,
+* so display RAM page flipping must be off.
+*  Inputs: none
+* Outputs: none
+*/
+void Console_init(void)
+{
+	int j;
+
+	memset( console_text, 0, sizeof( console_text ) );
+	console_count = 0;
+	console_col = 0;
+	console_back = 0;
+	console_startLine = -1;
+
+	frame_bufferInit( &console_frame, OLED_WIDTH, CONSOLE_LINE_H,
+		&console_band[0][0], sizeof( console_band ), NULL );
+
+	for ( j = 0; j < CONSOLE_BANDS; j++ )
+	{
+		console_bandLine[j] = -1;
+	}
+}
+
+/******** Console_print *********
+* Appends text to the console. A line is shown once it ends with '\n' or
+* fills the width of the panel.
+*  Inputs: pointer to characters, number of characters
+* Outputs: none
+*/
+void Console_print( const char *text, int length )
+{
+	int j;
+
+	for ( j = 0; j < length; j++ )
+	{
+		if ( text[j] == '\n' )
+		{
+			console_newLine();
+			continue;
+		}
+
+		if ( text[j] == '\r' )
+		{
+			continue;
+		}
+
+		console_text[console_count % CONSOLE_HISTORY][console_col++] = text[j];
+
+		if ( console_col == CONSOLE_COLS )
+		{
+			console_newLine();
+		}
+	}
+}
+
+/******** Console_scroll *********
+* Moves the view back through the scrollback. Lines still held in the
+* off-screen display RAM come back with a start line change only.
+*  Inputs: lines back from the newest, 0 follows new output
+* Outputs: none
+*/
+void Console_scroll( int lines )
+{
+	int max = CONSOLE_HISTORY - CONSOLE_ROWS - 1;
+
+	if ( max > console_count - CONSOLE_ROWS )
+	{
+		max = console_count - CONSOLE_ROWS;
+	}
+	if ( lines > max )
+	{
+		lines = max;
+	}
+	if ( lines < 0 )
+	{
+		lines = 0;
+	}
+
+	console_back = lines;
+}
+
+/******** Console_update *********
+* Sends pending console work to the display: renders at most one missing
+* line into its row band, or moves the start line once all bands of the
+* view are in place. Call from the main loop.
+*  Inputs: none
+* Outputs: none
+*/
+void Console_update(void)
+{
+	int bottom, line, band, start;
+
+	if ( console_busy )
+	{
+		return;
+	}
+
+	/* Newest completed line in view, and the bands it needs above it. */
+	bottom = console_count - 1 - console_back;
+	line = bottom - CONSOLE_ROWS + 1;
+
+	if ( line < 0 )
+	{
+		line = 0;
+	}
+
+	for ( ; line <= bottom; line++ )
+	{
+		band = line % CONSOLE_BANDS;
+
+		if ( console_bandLine[band] == line )
+		{
+			continue;
+		}
+
+		console_render(line);
+		console_busy = 1;
+
+		if ( !Oled_writeRect( 0, band * CONSOLE_LINE_H, OLED_WIDTH, 
+			CONSOLE_LINE_H, &console_band[0][0], OLED_WIDTH / 2, console_sent ) )
+		{
+			console_busy = 0;
+			return;
+		}
+
+		console_bandLine[band] = line;
+		return;
+	}
+
+	/* Scroll so the bottom line sits on the last row of the panel. */
+	start = ( ( bottom + 1 ) * CONSOLE_LINE_H - OLED_HEIGHT ) & ( OLED_RAM_ROWS - 1 );
+
+	if ( ( bottom < 0 ) || ( start == console_startLine ) )
+	{
+		return;
+	}
+
+	Oled_cmdReset( &console_cmds );
+	Oled_cmdAdd( &console_cmds, OLED_START_LINE );
+	Oled_cmdParam( &console_cmds, start );
+	console_busy = 1;
+
+	if ( !Oled_cmdSend( &console_cmds, console_sent ) )
+	{
+		console_busy = 0;
+		return;
+	}
+
+	console_startLine = start;
+}
@@ -0,0 +1,65 @@
+#include "crc.h"
+
+#ifdef STM32F0
+/********* Crc_words *******
+*  CRC-32 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection)
+*  over a block of 32-bit words, as the STM32 CRC unit computes it. Each
+*  word written to the data register is folded in within four AHB cycles,
+*  faster than the loop can supply the next one.
+*   Inputs: pointer to word aligned data, number of words
+*  Outputs: CRC of the block
+*/
+uint32_t Crc_words( const volatile uint32_t *data, int n )
+{
+	CRC_CR |= CRC_CR_RESET;
+
+	for ( ; n >= 4; n -= 4, data += 4 )
+	{
+		CRC_DR = data[0];
+		CRC_DR = data[1];
+		CRC_DR = data[2];
+		CRC_DR = data[3];
+	}
+
+	while ( n-- > 0 )
+	{
+		CRC_DR = *data++;
+	}
+
+	return CRC_DR;
+}
+#else
+/* Polynomial remainders of each nibble shifted into the top of the CRC. */
+static const uint32_t crc_nibble[16] =
+{
+	0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+	0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+	0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+	0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+};
+
+/********* Crc_words *******
+*  CRC-32 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection)
+*  over a block of 32-bit words, as the STM32 CRC unit computes it. Software
+*  version for builds without the CRC unit, four bits per step.
+*   Inputs: pointer to word aligned data, number of words
+*  Outputs: CRC of the block
+*/
+uint32_t Crc_words( const volatile uint32_t *data, int n )
+{
+	uint32_t crc = 0xFFFFFFFF;
+	int j;
+
+	while ( n-- > 0 )
+	{
+		crc ^= *data++;
+
+		for ( j = 0; j < 8; j++ )
+		{
+			crc = ( crc << 4 ) ^ crc_nibble[crc >> 28];
+		}
+	}
+
+	return crc;
+}
+#endif
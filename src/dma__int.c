@@ -76,9 +76,15 @@ void dma_spiTxInit(void) {
 	dma_set_read_from_memory( DMA1, DMA_CHANNEL3 );
 	dma_enable_memory_increment_mode( DMA1, DMA_CHANNEL3 );
 	dma_disable_peripheral_increment_mode(DMA1, DMA_CHANNEL3);
+#ifdef OLED_SPI_4WIRE
+	//copying bytes, D/C is driven on its own pin
+	dma_set_peripheral_size( DMA1, DMA_CHANNEL3, DMA_CCR_PSIZE_8BIT );
+	dma_set_memory_size( DMA1, DMA_CHANNEL3, DMA_CCR_MSIZE_8BIT );
+#else
 	//copying 9 bit words
 	dma_set_peripheral_size( DMA1, DMA_CHANNEL3, DMA_CCR_PSIZE_16BIT );
 	dma_set_memory_size( DMA1, DMA_CHANNEL3, DMA_CCR_MSIZE_16BIT );
+#endif
 	dma_set_priority( DMA1, DMA_CHANNEL3, DMA_CCR_PL_VERY_HIGH );
 }
 
@@ -123,12 +129,20 @@ void spi1_isr(void)
 		//Uart_send( test, s );
 		//Uart_send( " - spi. ", 8 );
 		spi_disable_tx_buffer_empty_interrupt(SPI1);	
+
+		/* TXE only means the FIFO has room. Let the last frames leave the
+		*  shift register before disabling, D/C may switch right after. */
+		while ( SPI_SR(SPI1) & ( SPI_SR_FTLVL_FIFO_FULL | SPI_SR_BSY ) );
+
 		spi_disable(SPI1);
 		spi_disable_tx_dma(SPI1);
 
 		gpio_toggle(GPIOC, GPIO0);
 
 		Sched_flagSignal( &Flag_DMA_Chan3 );
+
+		/* Chain the next streamed transfer, if one is waiting. */
+		Spi_dmaTxComplete();
 	}
 
 	else
@@ -0,0 +1,389 @@
+#include "draw.h"
+
+/* One chain of polygon edges, stepped a row at a time. */
+struct draw_edge
+{
+	int idx;           /* vertex the current edge ends at          */
+	int dir;           /* 1 or -1 through the vertex list           */
+	int y_end;
+	int32_t x;         /* 16.16 x at the current row                */
+	int32_t dx;        /* 16.16 x step per row                      */
+};
+
+/******** draw_plot *********
+* Sets a pixel known to be inside the buffer.
+*/
+static inline void draw_plot( frame_buffer_t *f, int x, int y, int value )
+{
+	frame_pixelPut( f, x, y, value );
+}
+
+/******** draw_plotClip *********
+* Sets a pixel if it is inside the buffer.
+*/
+static inline void draw_plotClip( frame_buffer_t *f, int x, int y, int value )
+{
+	if ( ( x >= 0 ) && ( y >= 0 ) && ( x < f->width ) && ( y < f->height ) )
+	{
+		draw_plot( f, x, y, value );
+	}
+}
+
+/******** draw_span *********
+* Fills pixels x0 to x1 (both included) of a row, clipped, no damage
+* tracking.
+*/
+static void draw_span( frame_buffer_t *f, int x0, int x1, int y, int value )
+{
+	if ( ( y < 0 ) || ( y >= f->height ) )
+	{
+		return;
+	}
+
+	if ( x0 < 0 ) x0 = 0;
+	if ( x1 >= f->width ) x1 = f->width - 1;
+
+	if ( x0 <= x1 )
+	{
+		frame_rowFill( f, y, x0, x1 + 1, value );
+	}
+}
+
+/******** draw_lineRun *********
+* Steps a line along its major axis u, the minor axis v taking a step
+* whenever the error term overflows, and plots the part inside the buffer.
+* Pixel t of the unclipped line is at u0 + su * t, v0 + sv * k(t) with
+* k(t) = ( 2 * dv * t + du ) / ( 2 * du ), so the visible range of t is
+* solved for first and the error term started where it enters. Clipped
+* lines stay exactly on their unclipped pixels. swap is set when u is y.
+*/
+static void draw_lineRun( frame_buffer_t *f, int u0, int v0, int su, int sv,
+	int du, int dv, int u_size, int v_size, int swap, int value )
+{
+	int32_t t0, t1, k0, k1, t, err;
+	int64_t n;
+	int u, v, u_end, v_end, lo[2], hi[2];
+
+	/* Steps along u, and minor steps, that stay inside the buffer. */
+	t0 = ( su > 0 ) ? -u0 : u0 - ( u_size - 1 );
+	t1 = ( su > 0 ) ? u_size - 1 - u0 : u0;
+	k0 = ( sv > 0 ) ? -v0 : v0 - ( v_size - 1 );
+	k1 = ( sv > 0 ) ? v_size - 1 - v0 : v0;
+
+	if ( t0 < 0 ) t0 = 0;
+	if ( t1 > du ) t1 = du;
+	if ( k0 < 0 ) k0 = 0;
+	if ( k1 > dv ) k1 = dv;
+
+	if ( k0 > k1 )
+	{
+		return;
+	}
+
+	/* First step whose k reaches k0, last one before k passes k1. */
+	if ( k0 > 0 )
+	{
+		n = ( (int64_t) 2 * du * k0 - du + 2 * dv - 1 ) / ( 2 * dv );
+		if ( n > t0 ) t0 = n;
+	}
+	n = ( (int64_t) 2 * du * k1 + du - 1 ) / ( 2 * dv );
+	if ( n < t1 ) t1 = n;
+
+	if ( t0 > t1 )
+	{
+		return;
+	}
+
+	n = (int64_t) 2 * dv * t0 + du;
+	u = u0 + su * t0;
+	v = v0 + sv * (int32_t) ( n / ( 2 * du ) );
+	err = n % ( 2 * du );
+
+	u_end = u0 + su * t1;
+	v_end = v0 + sv * (int32_t) ( ( (int64_t) 2 * dv * t1 + du ) / ( 2 * du ) );
+
+	/* Low and high corners, in buffer x and y. */
+	lo[swap] = ( u < u_end ) ? u : u_end;
+	hi[swap] = ( u > u_end ) ? u : u_end;
+	lo[swap ^ 1] = ( v < v_end ) ? v : v_end;
+	hi[swap ^ 1] = ( v > v_end ) ? v : v_end;
+	frame_dirtyAdd( f, lo[0], lo[1], hi[0] + 1, hi[1] + 1 );
+
+	for ( t = t0; t <= t1; t++ )
+	{
+		if ( swap )
+		{
+			draw_plot( f, v, u, value );
+		}
+		else
+		{
+			draw_plot( f, u, v, value );
+		}
+
+		u += su;
+		err += 2 * dv;
+		if ( err >= 2 * du )
+		{
+			err -= 2 * du;
+			v += sv;
+		}
+	}
+}
+
+/******** draw_line *********
+* Draws a line between two points, both included, stepped by Bresenham
+* along its longer axis. Only the steps inside the buffer are taken, from
+* an error term started where the line enters it, so a clipped line plots
+* exactly the visible pixels of the whole line. Horizontal and vertical
+* lines go to the span kernels.
+*  Inputs: pointer to a frame_buffer_t, x0, y0, x1, y1, grey level
+* Outputs: none
+*/
+void draw_line( frame_buffer_t *f, int x0, int y0, int x1, int y1,
+	int value )
+{
+	int dx, dy, sx, sy;
+
+	if ( y0 == y1 )
+	{
+		if ( x0 > x1 ) { dx = x0; x0 = x1; x1 = dx; }
+		frame_spanH( f, x0, y0, x1 - x0 + 1, value );
+		return;
+	}
+	if ( x0 == x1 )
+	{
+		if ( y0 > y1 ) { dy = y0; y0 = y1; y1 = dy; }
+		frame_spanV( f, x0, y0, y1 - y0 + 1, value );
+		return;
+	}
+
+	dx = ( x1 > x0 ) ? x1 - x0 : x0 - x1;
+	dy = ( y1 > y0 ) ? y1 - y0 : y0 - y1;
+	sx = ( x0 < x1 ) ? 1 : -1;
+	sy = ( y0 < y1 ) ? 1 : -1;
+
+	if ( dx >= dy )
+	{
+		draw_lineRun( f, x0, y0, sx, sy, dx, dy, f->width, f->height, 0,
+			value );
+	}
+	else
+	{
+		draw_lineRun( f, y0, x0, sy, sx, dy, dx, f->height, f->width, 1,
+			value );
+	}
+}
+
+/******** draw_rect *********
+* Draws the outline of a rectangle.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void draw_rect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value )
+{
+	if ( ( width <= 0 ) || ( height <= 0 ) )
+	{
+		return;
+	}
+
+	frame_spanH( f, x, y, width, value );
+	frame_spanH( f, x, y + height - 1, width, value );
+	frame_spanV( f, x, y, height, value );
+	frame_spanV( f, x + width - 1, y, height, value );
+}
+
+/******** draw_rectFill *********
+* Fills a rectangle, see frame_fillRect.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void draw_rectFill( frame_buffer_t *f, int x, int y, int width, int height,
+	int value )
+{
+	frame_fillRect( f, x, y, width, height, value );
+}
+
+/******** draw_circle *********
+* Draws the outline of a circle by the midpoint algorithm.
+*  Inputs: pointer to a frame_buffer_t, centre x, y, radius, grey level
+* Outputs: none
+*/
+void draw_circle( frame_buffer_t *f, int cx, int cy, int r, int value )
+{
+	int x = r, y = 0, d = 1 - r;
+
+	if ( r < 0 )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, cx - r, cy - r, cx + r + 1, cy + r + 1 );
+
+	while ( x >= y )
+	{
+		draw_plotClip( f, cx + x, cy + y, value );
+		draw_plotClip( f, cx - x, cy + y, value );
+		draw_plotClip( f, cx + x, cy - y, value );
+		draw_plotClip( f, cx - x, cy - y, value );
+		draw_plotClip( f, cx + y, cy + x, value );
+		draw_plotClip( f, cx - y, cy + x, value );
+		draw_plotClip( f, cx + y, cy - x, value );
+		draw_plotClip( f, cx - y, cy - x, value );
+
+		y++;
+		if ( d < 0 )
+		{
+			d += 2 * y + 1;
+		}
+		else
+		{
+			x--;
+			d += 2 * ( y - x ) + 1;
+		}
+	}
+}
+
+/******** draw_circleFill *********
+* Fills a circle with horizontal spans from the midpoint algorithm.
+*  Inputs: pointer to a frame_buffer_t, centre x, y, radius, grey level
+* Outputs: none
+*/
+void draw_circleFill( frame_buffer_t *f, int cx, int cy, int r, int value )
+{
+	int x = r, y = 0, d = 1 - r;
+
+	if ( r < 0 )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, cx - r, cy - r, cx + r + 1, cy + r + 1 );
+
+	while ( x >= y )
+	{
+		draw_span( f, cx - x, cx + x, cy + y, value );
+		draw_span( f, cx - x, cx + x, cy - y, value );
+		draw_span( f, cx - y, cx + y, cy + x, value );
+		draw_span( f, cx - y, cx + y, cy - x, value );
+
+		y++;
+		if ( d < 0 )
+		{
+			d += 2 * y + 1;
+		}
+		else
+		{
+			x--;
+			d += 2 * ( y - x ) + 1;
+		}
+	}
+}
+
+/******** draw_edgeStep *********
+* Moves a chain on to the edge covering row y, which must be above the
+* polygon's bottom.
+*/
+static void draw_edgeStep( struct draw_edge *e, const draw_point_t *pts,
+	int n, int y )
+{
+	const draw_point_t *a, *b;
+
+	while ( e->y_end <= y )
+	{
+		a = &pts[e->idx];
+		e->idx = ( e->idx + e->dir + n ) % n;
+		b = &pts[e->idx];
+		e->y_end = b->y;
+
+		if ( b->y > a->y )
+		{
+			e->dx = ( (int32_t) ( b->x - a->x ) << 16 ) / ( b->y - a->y );
+			e->x = ( (int32_t) a->x << 16 ) + e->dx * ( y - a->y );
+		}
+	}
+}
+
+/******** draw_polygonFill *********
+* Fills a convex polygon, vertices in either winding. Both edge chains
+* are walked down from the top vertex in 16.16 fixed point and each row
+* between them filled as one span, edges included.
+*  Inputs: pointer to a frame_buffer_t, vertices, number of vertices,
+*  grey level
+* Outputs: none
+*/
+void draw_polygonFill( frame_buffer_t *f, const draw_point_t *pts, int n,
+	int value )
+{
+	struct draw_edge e[2];
+	int j, top = 0, ytop, ybot, xmin, xmax, y, xa, xb;
+
+	if ( n < 1 )
+	{
+		return;
+	}
+
+	ytop = ybot = pts[0].y;
+	xmin = xmax = pts[0].x;
+
+	for ( j = 1; j < n; j++ )
+	{
+		if ( pts[j].y < ytop ) { ytop = pts[j].y; top = j; }
+		if ( pts[j].y > ybot ) ybot = pts[j].y;
+		if ( pts[j].x < xmin ) xmin = pts[j].x;
+		if ( pts[j].x > xmax ) xmax = pts[j].x;
+	}
+
+	frame_dirtyAdd( f, xmin, ytop, xmax + 1, ybot + 1 );
+
+	if ( ( ytop >= f->height ) || ( ybot < 0 ) )
+	{
+		return;
+	}
+
+	e[0].idx = e[1].idx = top;
+	e[0].dir = 1;
+	e[1].dir = -1;
+	e[0].y_end = e[1].y_end = ytop;
+
+	y = ( ytop > 0 ) ? ytop : 0;
+
+	for ( ; ( y < ybot ) && ( y < f->height ); y++ )
+	{
+		draw_edgeStep( &e[0], pts, n, y );
+		draw_edgeStep( &e[1], pts, n, y );
+
+		xa = ( e[0].x + 0x8000 ) >> 16;
+		xb = ( e[1].x + 0x8000 ) >> 16;
+
+		if ( xa < xb )
+		{
+			draw_span( f, xa, xb, y, value );
+		}
+		else
+		{
+			draw_span( f, xb, xa, y, value );
+		}
+
+		e[0].x += e[0].dx;
+		e[1].x += e[1].dx;
+	}
+
+	/* The bottom row is the extent of the vertices lying on it. */
+	if ( y == ybot )
+	{
+		xa = 0x7FFF;
+		xb = -0x8000;
+
+		for ( j = 0; j < n; j++ )
+		{
+			if ( pts[j].y == ybot )
+			{
+				if ( pts[j].x < xa ) xa = pts[j].x;
+				if ( pts[j].x > xb ) xb = pts[j].x;
+			}
+		}
+
+		draw_span( f, xa, xb, y, value );
+	}
+}
@@ -0,0 +1,255 @@
+#include "fixed.h"
+
+/* sin( i / 256 * pi / 2 ) in Q15 for i = 0 to 256, 1.0 held as 0x7FFF. */
+static const q15_t fixed_sinTable[257] =
+{
+	0, 201, 402, 603, 804, 1005, 1206, 1407, 1608, 1809,
+	2009, 2210, 2411, 2611, 2811, 3012, 3212, 3412, 3612, 3812,
+	4011, 4211, 4410, 4609, 4808, 5007, 5205, 5404, 5602, 5800,
+	5998, 6195, 6393, 6590, 6787, 6983, 7180, 7376, 7571, 7767,
+	7962, 8157, 8351, 8546, 8740, 8933, 9127, 9319, 9512, 9704,
+	9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+	11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+	13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+	15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+	17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+	18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+	20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+	22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+	23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+	24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+	26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+	27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+	28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+	29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+	30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+	30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+	31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+	31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+	32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+	32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+	32746, 32753, 32758, 32762, 32766, 32767, 32767
+};
+
+/* 1 / ( 1 + i / 256 ) in Q15 for i = 0 to 256, 1.0 held as 0x8000. */
+static const uint16_t fixed_recipTable[257] =
+{
+	32768, 32640, 32514, 32388, 32264, 32140, 32018, 31896, 31775, 31655,
+	31536, 31418, 31301, 31184, 31069, 30954, 30840, 30728, 30615, 30504,
+	30394, 30284, 30175, 30067, 29959, 29853, 29747, 29642, 29537, 29434,
+	29331, 29229, 29127, 29026, 28926, 28827, 28728, 28630, 28533, 28436,
+	28340, 28244, 28150, 28056, 27962, 27869, 27777, 27685, 27594, 27504,
+	27414, 27324, 27236, 27148, 27060, 26973, 26887, 26801, 26715, 26631,
+	26546, 26462, 26379, 26297, 26214, 26133, 26052, 25971, 25891, 25811,
+	25732, 25653, 25575, 25497, 25420, 25343, 25267, 25191, 25116, 25041,
+	24966, 24892, 24818, 24745, 24672, 24600, 24528, 24457, 24385, 24315,
+	24245, 24175, 24105, 24036, 23967, 23899, 23831, 23764, 23697, 23630,
+	23564, 23498, 23432, 23367, 23302, 23237, 23173, 23109, 23046, 22982,
+	22920, 22857, 22795, 22733, 22672, 22611, 22550, 22490, 22429, 22370,
+	22310, 22251, 22192, 22134, 22075, 22017, 21960, 21902, 21845, 21789,
+	21732, 21676, 21620, 21565, 21509, 21454, 21400, 21345, 21291, 21237,
+	21183, 21130, 21077, 21024, 20972, 20919, 20867, 20815, 20764, 20713,
+	20662, 20611, 20560, 20510, 20460, 20410, 20361, 20311, 20262, 20214,
+	20165, 20117, 20068, 20021, 19973, 19925, 19878, 19831, 19784, 19738,
+	19692, 19645, 19600, 19554, 19508, 19463, 19418, 19373, 19329, 19284,
+	19240, 19196, 19152, 19108, 19065, 19022, 18979, 18936, 18893, 18851,
+	18809, 18766, 18725, 18683, 18641, 18600, 18559, 18518, 18477, 18437,
+	18396, 18356, 18316, 18276, 18236, 18197, 18157, 18118, 18079, 18040,
+	18001, 17963, 17924, 17886, 17848, 17810, 17772, 17735, 17697, 17660,
+	17623, 17586, 17549, 17513, 17476, 17440, 17404, 17368, 17332, 17296,
+	17261, 17225, 17190, 17155, 17120, 17085, 17050, 17015, 16981, 16947,
+	16913, 16878, 16845, 16811, 16777, 16744, 16710, 16677, 16644, 16611,
+	16578, 16546, 16513, 16481, 16448, 16416, 16384
+};
+
+/******** fixed_sin *********
+* Sine from a quarter wave table in flash, linearly interpolated.
+*  Inputs: angle, 0x10000 per turn
+* Outputs: Q15 sine
+*/
+q15_t fixed_sin( fixed_angle_t angle )
+{
+	int p = angle & 0x3FFF;
+	int idx, frac, s;
+
+	/* The second and fourth quarters run the table backwards. */
+	if ( angle & FIXED_ANGLE_90 )
+	{
+		p = FIXED_ANGLE_90 - p;
+	}
+
+	idx = p >> 6;
+	frac = p & 0x3F;
+	s = fixed_sinTable[idx];
+
+	if ( frac )
+	{
+		s += ( ( fixed_sinTable[idx + 1] - s ) * frac + 0x20 ) >> 6;
+	}
+
+	return ( angle & FIXED_ANGLE_180 ) ? -s : s;
+}
+
+/******** fixed_cos *********
+* Cosine, see fixed_sin.
+*  Inputs: angle, 0x10000 per turn
+* Outputs: Q15 cosine
+*/
+q15_t fixed_cos( fixed_angle_t angle )
+{
+	return fixed_sin( angle + FIXED_ANGLE_90 );
+}
+
+/******** fixed_recip *********
+* Reciprocal from a table in flash, linearly interpolated after scaling
+* the input into 1 to 2 by shifts. Relative error under 2^-14. Saturates
+* for 0 and results past the Q16.16 range.
+*  Inputs: Q16.16 x
+* Outputs: Q16.16 1 / x
+*/
+q16_t fixed_recip( q16_t x )
+{
+	uint32_t n, r;
+	int neg = x < 0;
+	int s = 0, idx;
+
+	if ( x == 0 )
+	{
+		return INT32_MAX;
+	}
+
+	n = neg ? -(uint32_t) x : (uint32_t) x;
+
+	/* x = n / 2^16 * 2^s with n in 2^16 to 2^17. */
+	while ( n >= 0x20000 ) { n >>= 1; s++; }
+	while ( n < 0x10000 ) { n <<= 1; s--; }
+
+	idx = ( n >> 8 ) & 0xFF;
+	r = fixed_recipTable[idx];
+	r -= ( ( r - fixed_recipTable[idx + 1] ) * ( n & 0xFF ) + 0x80 ) >> 8;
+
+	/* r is 1 / m in Q15, the result 2^-s times that in Q16. */
+	if ( s <= 1 )
+	{
+		/* r is under 2^15 unless m is 1, shifting by 16 still fits then. */
+		if ( ( 1 - s > 16 ) || ( ( 1 - s == 16 ) && ( r >= 0x8000 ) ) )
+		{
+			return neg ? INT32_MIN : INT32_MAX;
+		}
+		r <<= 1 - s;
+	}
+	else
+	{
+		r = ( r + ( 1 << ( s - 2 ) ) ) >> ( s - 1 );
+	}
+
+	return neg ? -(q16_t) r : (q16_t) r;
+}
+
+/******** fixed_div *********
+* Divides by multiplying with fixed_recip, with its precision, avoiding
+* the library's software divide.
+*  Inputs: Q16.16 a, Q16.16 b
+* Outputs: Q16.16 a / b
+*/
+q16_t fixed_div( q16_t a, q16_t b )
+{
+	return fixed_mul( a, fixed_recip(b) );
+}
+
+/******** fixed_affineIdentity *********
+* Sets a transform to the identity.
+*  Inputs: pointer to a fixed_affine_t
+* Outputs: none
+*/
+void fixed_affineIdentity( fixed_affine_t *m )
+{
+	m->a = Q16_ONE;
+	m->b = 0;
+	m->c = 0;
+	m->d = Q16_ONE;
+	m->tx = 0;
+	m->ty = 0;
+}
+
+/******** fixed_affineRotScale *********
+* Sets a transform rotating by angle and scaling by scale about the
+* origin, then translating by tx, ty.
+*  Inputs: pointer to a fixed_affine_t, angle, Q16.16 scale, Q16.16 tx, ty
+* Outputs: none
+*/
+void fixed_affineRotScale( fixed_affine_t *m, fixed_angle_t angle,
+	q16_t scale, q16_t tx, q16_t ty )
+{
+	q16_t c = fixed_mulQ15Q16( scale, fixed_cos( angle ) );
+	q16_t s = fixed_mulQ15Q16( scale, fixed_sin( angle ) );
+
+	m->a = c;
+	m->b = -s;
+	m->c = s;
+	m->d = c;
+	m->tx = tx;
+	m->ty = ty;
+}
+
+/******** fixed_affineMul *********
+* Composes two transforms, applying second then first. out may be either.
+*  Inputs: pointer to the result, first, second
+* Outputs: none
+*/
+void fixed_affineMul( fixed_affine_t *out, const fixed_affine_t *first,
+	const fixed_affine_t *second )
+{
+	fixed_affine_t r;
+
+	r.a = fixed_mul( first->a, second->a ) + fixed_mul( first->b, second->c );
+	r.b = fixed_mul( first->a, second->b ) + fixed_mul( first->b, second->d );
+	r.c = fixed_mul( first->c, second->a ) + fixed_mul( first->d, second->c );
+	r.d = fixed_mul( first->c, second->b ) + fixed_mul( first->d, second->d );
+	r.tx = fixed_mul( first->a, second->tx ) + fixed_mul( first->b, second->ty ) + first->tx;
+	r.ty = fixed_mul( first->c, second->tx ) + fixed_mul( first->d, second->ty ) + first->ty;
+
+	*out = r;
+}
+
+/******** fixed_affineInvert *********
+* Inverts a transform.
+*  Inputs: pointer to the result, pointer to the transform
+* Outputs: 1 if inverted, 0 if the transform is singular
+*/
+int fixed_affineInvert( fixed_affine_t *out, const fixed_affine_t *m )
+{
+	fixed_affine_t r;
+	q16_t det = fixed_mul( m->a, m->d ) - fixed_mul( m->b, m->c );
+	q16_t inv;
+
+	if ( det == 0 )
+	{
+		return 0;
+	}
+
+	inv = fixed_recip( det );
+
+	r.a = fixed_mul( m->d, inv );
+	r.b = -fixed_mul( m->b, inv );
+	r.c = -fixed_mul( m->c, inv );
+	r.d = fixed_mul( m->a, inv );
+	r.tx = -( fixed_mul( r.a, m->tx ) + fixed_mul( r.b, m->ty ) );
+	r.ty = -( fixed_mul( r.c, m->tx ) + fixed_mul( r.d, m->ty ) );
+
+	*out = r;
+	return 1;
+}
+
+/******** fixed_affineApply *********
+* Maps a point through a transform.
+*  Inputs: pointer to a fixed_affine_t, Q16.16 x, y, pointers to the
+*  Q16.16 results
+* Outputs: none
+*/
+void fixed_affineApply( const fixed_affine_t *m, q16_t x, q16_t y,
+	q16_t *ox, q16_t *oy )
+{
+	*ox = fixed_mul( m->a, x ) + fixed_mul( m->b, y ) + m->tx;
+	*oy = fixed_mul( m->c, x ) + fixed_mul( m->d, y ) + m->ty;
+}
@@ -0,0 +1,96 @@
+#include "font.h"
+
+/******** font_glyph *********
+* Looks up the glyph for a character, '?' standing in for codes outside
+* the font.
+*  Inputs: pointer to a font_t, character
+* Outputs: pointer to the glyph, NULL if the font has neither
+*/
+const font_glyph_t *font_glyph( const font_t *font, char c )
+{
+	uint8_t code = (uint8_t) c;
+
+	if ( ( code < font->first ) || ( code > font->last ) )
+	{
+		code = '?';
+
+		if ( ( code < font->first ) || ( code > font->last ) )
+		{
+			return NULL;
+		}
+	}
+
+	return &font->glyphs[code - font->first];
+}
+
+/******** font_stringWidth *********
+* Returns the advance of a string in pixels.
+*  Inputs: pointer to a font_t, NUL terminated text
+* Outputs: width in pixels
+*/
+int font_stringWidth( const font_t *font, const char *text )
+{
+	const font_glyph_t *g;
+	int width = 0;
+
+	for ( ; *text; text++ )
+	{
+		g = font_glyph( font, *text );
+
+		if ( g )
+		{
+			width += g->advance;
+		}
+	}
+
+	return width;
+}
+
+/******** font_drawString *********
+* Draws a string into a frame buffer, glyphs clipped to the buffer and
+* blitted whole rows at a time through sprite_blit. Frames other than
+* 4bpp are left untouched.
+*  Inputs: pointer to a frame_buffer_t, pointer to a font_t, x of the pen,
+*  y of the top of the line, NUL terminated text
+* Outputs: x of the pen after the last glyph
+*/
+int font_drawString( frame_buffer_t *f, const font_t *font, int x, int y,
+	const char *text )
+{
+	const font_glyph_t *g;
+	sprite_obj_t s;
+
+	/* Lines entirely above or below the buffer draw nothing, nor do
+	*  frames other than 4bpp. */
+	if ( ( f->bpp != FRAME_BPP_4 ) || ( y >= f->height ) ||
+		( y + font->height <= 0 ) )
+	{
+		return x + font_stringWidth( font, text );
+	}
+
+	s.key = 0;
+
+	for ( ; *text; text++ )
+	{
+		g = font_glyph( font, *text );
+
+		if ( !g )
+		{
+			continue;
+		}
+
+		if ( g->width && ( x + g->x_off < f->width ) )
+		{
+			s.width = g->width;
+			s.height = g->height;
+			s.bmp_data = &font->atlas[g->offset];
+			s.length = SPRITE_STRIDE( g->width ) * g->height;
+
+			sprite_blit( f, &s, x + g->x_off, y + g->y_off, 0 );
+		}
+
+		x += g->advance;
+	}
+
+	return x;
+}
@@ -1,26 +1,230 @@
 #include "frame.h"
 
 /******** frame_bufferInit *********
-* Initializes a frame_buffer_t object.
+* Initializes a frame_buffer_t object. The ready flag starts signalled,
+* a flush takes it and signals it again once the data has been sent.
 *  Inputs: pointer to a frame_buffer_t, width in pixels, height in pixels, 
-*  pointer to an allocated data array, length of array in bytes.
+*  pointer to an allocated data array, length of array in bytes, pointer to
+*  the ready flag.
 * Outputs: none
 */
 void frame_bufferInit( frame_buffer_t *f, int width, int height, 
 	volatile uint8_t *data, int length, volatile int32_t *flag )
 {
+	frame_bufferInitBpp( f, width, height, FRAME_BPP_4, data, length, flag );
+}
+
+/******** frame_bufferInitBpp *********
+* frame_bufferInit for a 1, 2 or 4bpp buffer. A 256x64 screen takes 2 KB
+* at 1bpp and 4 KB at 2bpp. The palette starts as evenly spaced grey levels
+* from black to white.
+*  Inputs: pointer to a frame_buffer_t, width in pixels, height in pixels,
+*  bits per pixel, pointer to an allocated data array, length of array in
+*  bytes, pointer to the ready flag.
+* Outputs: none
+*/
+void frame_bufferInitBpp( frame_buffer_t *f, int width, int height, int bpp,
+	volatile uint8_t *data, int length, volatile int32_t *flag )
+{
+	static const uint8_t ramp1[2] = { 0x0, 0xF };
+	static const uint8_t ramp2[4] = { 0x0, 0x5, 0xA, 0xF };
+
 	f->width = width;
-	f->h_width = ( width >> 1 );
+	f->bpp = bpp;
+	f->h_width = ( width * bpp + 7 ) >> 3;
 	f->length = length;
 	f->height = height;
 	f->data = data;
 	f->readyFlag = flag;
+
+	if ( flag )
+	{
+		(*flag) = 1;
+	}
+
+	/* Display RAM contents are unknown, the first flush sends everything. */
+	frame_paletteSet( f, ( bpp == FRAME_BPP_1 ) ? ramp1 : ramp2 );
+}
+
+/******** frame_paletteSet *********
+* Sets the grey levels 1 and 2bpp pixel values are shown as, taking effect
+* from the next flush. The whole buffer is marked dirty.
+*  Inputs: pointer to a frame_buffer_t, grey level of each pixel value (2
+*  or 4 entries)
+* Outputs: none
+*/
+void frame_paletteSet( frame_buffer_t *f, const uint8_t *levels )
+{
+	int j, k, e;
+	int per = 4 >> ( f->bpp >> 1 );
+	int mask = ( 1 << f->bpp ) - 1;
+
+	for ( j = 0; ( f->bpp < FRAME_BPP_4 ) && ( j < 16 ); j++ )
+	{
+		/* Pixel k of the nibble becomes output nibble k. */
+		for ( k = 0, e = 0; k < per; k++ )
+		{
+			e |= ( levels[( j >> ( k * f->bpp ) ) & mask] & 0xF ) << ( k << 2 );
+		}
+		f->expand[j] = e;
+	}
+
+	frame_dirtyAll(f);
+}
+
+/******** frame_view *********
+* Sets up a frame_buffer_t that draws into a rectangle of another, so every
+* kernel clips to the rectangle. The left edge is rounded down and the
+* right edge up to whole bytes of the parent (2 pixels at 4bpp). Damage is
+* tracked in the view's own coordinates, not the parent's.
+*  Inputs: pointer to the view, pointer to the parent, x, y, width, height
+* Outputs: x of the view's left edge in the parent
+*/
+int frame_view( frame_buffer_t *view, frame_buffer_t *f, int x, int y,
+	int width, int height )
+{
+	int per = 8 >> ( f->bpp >> 1 );        /* pixels per byte */
+	int x1 = x + width, y1 = y + height;
+
+	if ( x < 0 ) x = 0;
+	if ( y < 0 ) y = 0;
+	if ( x1 > f->width ) x1 = f->width;
+	if ( y1 > f->height ) y1 = f->height;
+	if ( x1 < x ) x1 = x;
+	if ( y1 < y ) y1 = y;
+
+	x &= ~( per - 1 );
+	x1 = ( x1 + per - 1 ) & ~( per - 1 );
+	if ( x1 > f->width ) x1 = f->width;
+
+	*view = *f;
+	view->data = &f->data[y * f->h_width + ( ( x * f->bpp ) >> 3 )];
+	view->width = x1 - x;
+	view->height = y1 - y;
+	view->length = f->length - ( view->data - f->data );
+	view->readyFlag = NULL;
+	view->dirtyCount = 0;
+
+	return x;
+}
+
+/******** frame_dirtyAdd *********
+* Marks a region as changed. The region is clipped to the buffer and widened
+* to the display's 4 pixel column granularity, then merged with any tracked
+* region it overlaps or touches. When the list is full it is merged into
+* the region that grows the least.
+*  Inputs: pointer to a frame_buffer_t, x0, y0, x1, y1 (x1, y1 exclusive)
+* Outputs: none
+*/
+void frame_dirtyAdd( frame_buffer_t *f, int x0, int y0, int x1, int y1 )
+{
+	frame_rect_t *r;
+	int j, best, cost, best_cost, area;
+
+	if ( x0 < 0 ) x0 = 0;
+	if ( y0 < 0 ) y0 = 0;
+	if ( x1 > f->width ) x1 = f->width;
+	if ( y1 > f->height ) y1 = f->height;
+
+	if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+	{
+		return;
+	}
+
+	x0 &= ~3;
+	x1 = ( x1 + 3 ) & ~3;
+
+	/* Merging can make the union touch other regions, repeat until stable. */
+	j = 0;
+	while ( j < f->dirtyCount )
+	{
+		r = &f->dirty[j];
+
+		if ( ( x0 > r->x1 ) || ( r->x0 > x1 ) || ( y0 > r->y1 ) || ( r->y0 > y1 ) )
+		{
+			j++;
+			continue;
+		}
+
+		/* Already covered, the common case for pixel writes. */
+		if ( ( x0 >= r->x0 ) && ( x1 <= r->x1 ) && ( y0 >= r->y0 ) && ( y1 <= r->y1 ) )
+		{
+			return;
+		}
+
+		if ( r->x0 < x0 ) x0 = r->x0;
+		if ( r->y0 < y0 ) y0 = r->y0;
+		if ( r->x1 > x1 ) x1 = r->x1;
+		if ( r->y1 > y1 ) y1 = r->y1;
+
+		/* Take the region out of the list and rescan with the union. */
+		f->dirty[j] = f->dirty[--f->dirtyCount];
+		j = 0;
+	}
+
+	if ( f->dirtyCount == FRAME_DIRTY_MAX )
+	{
+		best = 0;
+		best_cost = 0x7FFFFFFF;
+
+		for ( j = 0; j < FRAME_DIRTY_MAX; j++ )
+		{
+			r = &f->dirty[j];
+			area = ( r->x1 - r->x0 ) * ( r->y1 - r->y0 );
+			cost = ( ( ( r->x1 > x1 ) ? r->x1 : x1 ) - ( ( r->x0 < x0 ) ? r->x0 : x0 ) ) *
+			       ( ( ( r->y1 > y1 ) ? r->y1 : y1 ) - ( ( r->y0 < y0 ) ? r->y0 : y0 ) ) - area;
+
+			if ( cost < best_cost )
+			{
+				best_cost = cost;
+				best = j;
+			}
+		}
+
+		r = &f->dirty[best];
+		if ( r->x0 < x0 ) x0 = r->x0;
+		if ( r->y0 < y0 ) y0 = r->y0;
+		if ( r->x1 > x1 ) x1 = r->x1;
+		if ( r->y1 > y1 ) y1 = r->y1;
+
+		/* The grown region may now reach others, merge it in again. */
+		f->dirty[best] = f->dirty[--f->dirtyCount];
+		frame_dirtyAdd( f, x0, y0, x1, y1 );
+		return;
+	}
+
+	r = &f->dirty[f->dirtyCount++];
+	r->x0 = x0;
+	r->y0 = y0;
+	r->x1 = x1;
+	r->y1 = y1;
+}
+
+/******** frame_dirtyAll *********
+* Marks the whole buffer as changed.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void frame_dirtyAll( frame_buffer_t *f )
+{
+	f->dirtyCount = 0;
+	frame_dirtyAdd( f, 0, 0, f->width, f->height );
+}
+
+/******** frame_dirtyClear *********
+* Forgets all tracked regions, normally once they have been flushed.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void frame_dirtyClear( frame_buffer_t *f )
+{
+	f->dirtyCount = 0;
 }
 
 /******** frame_pixelSet *********
 * Sets an arbitary pixel to grey level value at the x,y coordinates provided.
 *  Inputs: pointer to a frame_buffer_t, x coordinate, y coordinate, grey value
-*  from 0 (black) to F (white).
+*  from 0 (black) to F (white), or palette index for 1 and 2bpp.
 * Outputs: none
 */
 void frame_pixelSet( frame_buffer_t *f, int x, int y, int value ) 
@@ -33,18 +237,464 @@ void frame_pixelSet( frame_buffer_t *f, int x, int y, int value )
 		return;	//Abort update if out of bounds
 	}
 
-	int index = y * f->h_width + ( x >> 1 );
-	write_bits( f->data[index], ( x & 1 ) << 2, 4, value );
-	//( x & 1 ) << 2 will be 0 for even and 4 for odd
+	frame_pixelPut( f, x, y, value );
+
+	frame_dirtyAdd( f, x, y, x + 1, y + 1 );
 
 }
 
 /******** frame_pixelGet *********
 * Returns a pixel's greyLvl located by the x,y coordinates provided.
 *  Inputs: pointer to a frame_buffer_t, x coordinate, y coordinate.
-* Outputs: grey level from 0 (black) to F (white).
+* Outputs: grey level from 0 (black) to F (white), or palette index.
 */
 uint8_t frame_pixelGet( frame_buffer_t *f, int x, int y )
 {
-	return 0;
+	int bit = x * f->bpp;
+
+	if ( ( x < 0 ) || ( y < 0 ) || ( x >= f->width ) || ( y >= f->height ) ) 
+	{
+		return 0;
+	}
+
+	return get_bits( f->data[y * f->h_width + ( bit >> 3 )], bit & 7, f->bpp );
+}
+
+/******** frame_clip *********
+* Clips a rectangle to the buffer. Returns 0 when nothing is left.
+*/
+static int frame_clip( frame_buffer_t *f, int *x, int *y, int *w, int *h )
+{
+	if ( *x < 0 ) { *w += *x; *x = 0; }
+	if ( *y < 0 ) { *h += *y; *y = 0; }
+	if ( *x + *w > f->width ) *w = f->width - *x;
+	if ( *y + *h > f->height ) *h = f->height - *y;
+
+	return ( *w > 0 ) && ( *h > 0 );
+}
+
+/******** frame_spanOp *********
+* Sets (op FRAME_OP_SET) or XORs (FRAME_OP_XOR) the pattern into pixels
+* x0 to x1 (exclusive) of a row. Odd edge pixels are done as nibbles, the
+* byte run between them a byte at a time up to a word boundary, then eight
+* pixels per word. pattern holds the grey level in every nibble.
+*/
+#define FRAME_OP_SET 0
+#define FRAME_OP_XOR 1
+
+static void frame_spanOp( volatile uint8_t *row, int x0, int x1, int op, 
+	uint32_t pattern )
+{
+	volatile uint8_t *p;
+	volatile uint32_t *w;
+	uint8_t b = (uint8_t) pattern;
+	int n;
+
+	/* Odd x is the high nibble, a span ending on an even pixel ends low. */
+	if ( x0 & 1 )
+	{
+		p = &row[x0 >> 1];
+		*p = ( op == FRAME_OP_SET ) ? ( ( *p & 0x0F ) | ( b & 0xF0 ) ) : ( *p ^ ( b & 0xF0 ) );
+		x0++;
+	}
+	if ( ( x1 & 1 ) && ( x1 > x0 ) )
+	{
+		p = &row[x1 >> 1];
+		*p = ( op == FRAME_OP_SET ) ? ( ( *p & 0xF0 ) | ( b & 0x0F ) ) : ( *p ^ ( b & 0x0F ) );
+		x1--;
+	}
+
+	p = &row[x0 >> 1];
+	n = ( x1 - x0 ) >> 1;
+
+	while ( ( n > 0 ) && ( (uintptr_t) p & 3 ) )
+	{
+		*p = ( op == FRAME_OP_SET ) ? b : ( *p ^ b );
+		p++;
+		n--;
+	}
+
+	w = (volatile uint32_t *) p;
+	if ( op == FRAME_OP_SET )
+	{
+		for ( ; n >= 16; n -= 16, w += 4 )
+		{
+			w[0] = pattern; w[1] = pattern; w[2] = pattern; w[3] = pattern;
+		}
+		for ( ; n >= 4; n -= 4 )
+		{
+			*w++ = pattern;
+		}
+	}
+	else
+	{
+		for ( ; n >= 4; n -= 4 )
+		{
+			*w++ ^= pattern;
+		}
+	}
+
+	p = (volatile uint8_t *) w;
+	while ( n-- > 0 )
+	{
+		*p = ( op == FRAME_OP_SET ) ? b : ( *p ^ b );
+		p++;
+	}
+}
+
+/******** frame_rowSet *********
+* Sets pixels x0 to x1 (exclusive) of a 4bpp frame row to a grey level.
+* No clipping, damage tracking or format check, callers hold a 4bpp frame;
+* frame_rowFill takes any format.
+*  Inputs: frame row, x0, x1, grey level
+* Outputs: none
+*/
+void frame_rowSet( volatile uint8_t *row, int x0, int x1, int value )
+{
+	frame_spanOp( row, x0, x1, FRAME_OP_SET, ( value & 0xF ) * 0x11111111u );
+}
+
+/******** frame_bitSpanOp *********
+* frame_spanOp over bits b0 to b1 (exclusive) of a row, for any pixel
+* size. Partial bytes at either end are masked, whole bytes go through
+* frame_spanOp as pairs of nibbles.
+*/
+static void frame_bitSpanOp( volatile uint8_t *row, int b0, int b1, int op,
+	uint32_t pattern )
+{
+	volatile uint8_t *p;
+	uint8_t b = (uint8_t) pattern;
+	uint8_t m;
+
+	if ( b0 & 7 )
+	{
+		p = &row[b0 >> 3];
+		m = 0xFF << ( b0 & 7 );
+		if ( ( b1 >> 3 ) == ( b0 >> 3 ) )
+		{
+			m &= ( 1 << ( b1 & 7 ) ) - 1;
+		}
+		*p = ( op == FRAME_OP_SET ) ? ( ( *p & ~m ) | ( b & m ) ) : ( *p ^ ( b & m ) );
+		b0 = ( b0 + 7 ) & ~7;
+	}
+	if ( ( b1 & 7 ) && ( b1 > b0 ) )
+	{
+		p = &row[b1 >> 3];
+		m = ( 1 << ( b1 & 7 ) ) - 1;
+		*p = ( op == FRAME_OP_SET ) ? ( ( *p & ~m ) | ( b & m ) ) : ( *p ^ ( b & m ) );
+		b1 &= ~7;
+	}
+
+	if ( b1 > b0 )
+	{
+		frame_spanOp( row, b0 >> 2, b1 >> 2, op, pattern );
+	}
+}
+
+/******** frame_pattern *********
+* Repeats a pixel value through a word.
+*/
+static inline uint32_t frame_pattern( frame_buffer_t *f, int value )
+{
+	static const uint32_t ones[5] = { 0, 0xFFFFFFFFu, 0x55555555u, 0, 0x11111111u };
+
+	return ( value & ( ( 1 << f->bpp ) - 1 ) ) * ones[f->bpp];
+}
+
+/******** frame_rowFill *********
+* Sets pixels x0 to x1 (exclusive) of row y, any format. No clipping or
+* damage tracking.
+*  Inputs: pointer to a frame_buffer_t, y, x0, x1, grey level or index
+* Outputs: none
+*/
+void frame_rowFill( frame_buffer_t *f, int y, int x0, int x1, int value )
+{
+	frame_bitSpanOp( &f->data[y * f->h_width], x0 * f->bpp, x1 * f->bpp,
+		FRAME_OP_SET, frame_pattern( f, value ) );
+}
+
+/******** frame_rectOp *********
+* Applies frame_bitSpanOp to each row of a clipped rectangle. Rows filling
+* the whole stride are contiguous and done as one span.
+*/
+static void frame_rectOp( frame_buffer_t *f, int x, int y, int w, int h, 
+	int op, int value )
+{
+	volatile uint8_t *row;
+	uint32_t pattern = frame_pattern( f, value );
+
+	if ( !frame_clip( f, &x, &y, &w, &h ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x, y, x + w, y + h );
+
+	row = &f->data[y * f->h_width];
+
+	if ( w * f->bpp == ( f->h_width << 3 ) )
+	{
+		frame_bitSpanOp( row, 0, w * h * f->bpp, op, pattern );
+		return;
+	}
+
+	for ( ; h > 0; h--, row += f->h_width )
+	{
+		frame_bitSpanOp( row, x * f->bpp, ( x + w ) * f->bpp, op, pattern );
+	}
+}
+
+/******** frame_spanH *********
+* Fills a horizontal run of pixels with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, grey level 0 to F
+* Outputs: none
+*/
+void frame_spanH( frame_buffer_t *f, int x, int y, int width, int value )
+{
+	frame_rectOp( f, x, y, width, 1, FRAME_OP_SET, value );
+}
+
+/******** frame_spanV *********
+* Fills a vertical run of pixels with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, height, grey level 0 to F
+* Outputs: none
+*/
+void frame_spanV( frame_buffer_t *f, int x, int y, int height, int value )
+{
+	volatile uint8_t *p;
+	uint8_t keep, set;
+	int w = 1;
+
+	if ( !frame_clip( f, &x, &y, &w, &height ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x, y, x + 1, y + height );
+
+	/* The same bits of every row, mask and value worked out once. */
+	x *= f->bpp;
+	keep = ~( ( ( 1 << f->bpp ) - 1 ) << ( x & 7 ) );
+	set = (uint8_t) frame_pattern( f, value ) & ~keep;
+	p = &f->data[y * f->h_width + ( x >> 3 )];
+
+	for ( ; height > 0; height--, p += f->h_width )
+	{
+		*p = ( *p & keep ) | set;
+	}
+}
+
+/******** frame_fillRect *********
+* Fills a rectangle with a grey level.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void frame_fillRect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value )
+{
+	frame_rectOp( f, x, y, width, height, FRAME_OP_SET, value );
+}
+
+/******** frame_clear *********
+* Fills the whole buffer with a grey level.
+*  Inputs: pointer to a frame_buffer_t, grey level
+* Outputs: none
+*/
+void frame_clear( frame_buffer_t *f, int value )
+{
+	frame_rectOp( f, 0, 0, f->width, f->height, FRAME_OP_SET, value );
+}
+
+/******** frame_xorRect *********
+* XORs a grey level into every pixel of a rectangle, 0xF inverts.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, grey level
+* Outputs: none
+*/
+void frame_xorRect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value )
+{
+	frame_rectOp( f, x, y, width, height, FRAME_OP_XOR, value );
+}
+
+/******** frame_maskCopy *********
+* Copies a rectangle of pixels from one buffer into another, skipping
+* source pixels of grey level 0 so they leave the destination showing.
+* When source and destination x have the same parity eight pixels go per
+* word, two per byte when the buffers are not word aligned to each other,
+* otherwise pixel by pixel. Both buffers must be 4bpp, nothing is copied
+* otherwise.
+*  Inputs: destination frame_buffer_t, destination x, y, source
+*  frame_buffer_t, source x, y, width, height
+* Outputs: none
+*/
+void frame_maskCopy( frame_buffer_t *dst, int x, int y, frame_buffer_t *src,
+	int sx, int sy, int width, int height )
+{
+	volatile uint8_t *d, *s;
+	uint8_t m;
+	int j, n, x0, x1, so;
+
+	if ( ( dst->bpp != FRAME_BPP_4 ) || ( src->bpp != FRAME_BPP_4 ) )
+	{
+		return;
+	}
+
+	/* Clip against the source, then the destination. */
+	if ( sx < 0 ) { x -= sx; width += sx; sx = 0; }
+	if ( sy < 0 ) { y -= sy; height += sy; sy = 0; }
+	if ( sx + width > src->width ) width = src->width - sx;
+	if ( sy + height > src->height ) height = src->height - sy;
+	if ( x < 0 ) { sx -= x; width += x; x = 0; }
+	if ( y < 0 ) { sy -= y; height += y; y = 0; }
+
+	if ( !frame_clip( dst, &x, &y, &width, &height ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( dst, x, y, x + width, y + height );
+
+	for ( ; height > 0; height--, y++, sy++ )
+	{
+		if ( ( x ^ sx ) & 1 )
+		{
+			for ( j = 0; j < width; j++ )
+			{
+				m = get_bits( src->data[sy * src->h_width + ( ( sx + j ) >> 1 )],
+					( ( sx + j ) & 1 ) << 2, 4 );
+				if ( m )
+				{
+					write_bits( dst->data[y * dst->h_width + ( ( x + j ) >> 1 )],
+						( ( x + j ) & 1 ) << 2, 4, m );
+				}
+			}
+			continue;
+		}
+
+		/* Same parity: work in destination pixels, source bytes line up. */
+		x0 = x;
+		x1 = x + width;
+		d = &dst->data[y * dst->h_width];
+		s = &src->data[sy * src->h_width];
+		so = ( sx >> 1 ) - ( x >> 1 );
+
+		if ( x0 & 1 )
+		{
+			m = s[( x0 >> 1 ) + so] & 0xF0;
+			if ( m ) d[x0 >> 1] = ( d[x0 >> 1] & 0x0F ) | m;
+			x0++;
+		}
+		if ( ( x1 & 1 ) && ( x1 > x0 ) )
+		{
+			m = s[( x1 >> 1 ) + so] & 0x0F;
+			if ( m ) d[x1 >> 1] = ( d[x1 >> 1] & 0xF0 ) | m;
+			x1--;
+		}
+
+		d += x0 >> 1;
+		s += ( x0 >> 1 ) + so;
+		n = ( x1 - x0 ) >> 1;
+
+		if ( ( ( (uintptr_t) d ^ (uintptr_t) s ) & 3 ) == 0 )
+		{
+			while ( ( n > 0 ) && ( (uintptr_t) d & 3 ) )
+			{
+				m = (uint8_t) frame_opaque( *s );
+				*d = ( *d & ~m ) | ( *s & m );
+				d++; s++; n--;
+			}
+			for ( ; n >= 4; n -= 4, d += 4, s += 4 )
+			{
+				uint32_t sw = *(volatile uint32_t *) s;
+				uint32_t mw = frame_opaque( sw );
+
+				if ( mw == 0xFFFFFFFFu )
+				{
+					*(volatile uint32_t *) d = sw;
+				}
+				else if ( mw )
+				{
+					*(volatile uint32_t *) d = ( *(volatile uint32_t *) d & ~mw ) | ( sw & mw );
+				}
+			}
+		}
+
+		while ( n-- > 0 )
+		{
+			m = (uint8_t) frame_opaque( *s );
+			*d = ( *d & ~m ) | ( *s & m );
+			d++; s++;
+		}
+	}
+}
+
+/******** frame_brightnessLut *********
+* Builds a grey level table scaling brightness by level / 16.
+*  Inputs: 16 entry table to fill, level 0 (black) to 16 (unchanged)
+* Outputs: none
+*/
+void frame_brightnessLut( uint8_t *lut, int level )
+{
+	int j;
+
+	for ( j = 0; j < 16; j++ )
+	{
+		lut[j] = (uint8_t) ( ( j * level + 8 ) >> 4 );
+	}
+}
+
+/******** frame_lutRect *********
+* Maps every pixel of a rectangle through a 16 entry grey level table, for
+* brightness scaling, gamma or palette effects. Whole bytes map both
+* nibbles with one read and write. 4bpp buffers only, others are left
+* untouched.
+*  Inputs: pointer to a frame_buffer_t, x, y, width, height, table
+* Outputs: none
+*/
+void frame_lutRect( frame_buffer_t *f, int x, int y, int width, int height,
+	const uint8_t *lut )
+{
+	volatile uint8_t *row, *p;
+	uint8_t b;
+	int x0, x1, n;
+
+	if ( f->bpp != FRAME_BPP_4 )
+	{
+		return;
+	}
+
+	if ( !frame_clip( f, &x, &y, &width, &height ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x, y, x + width, y + height );
+
+	row = &f->data[y * f->h_width];
+
+	for ( ; height > 0; height--, row += f->h_width )
+	{
+		x0 = x;
+		x1 = x + width;
+
+		if ( x0 & 1 )
+		{
+			p = &row[x0 >> 1];
+			*p = ( *p & 0x0F ) | ( lut[*p >> 4] << 4 );
+			x0++;
+		}
+		if ( ( x1 & 1 ) && ( x1 > x0 ) )
+		{
+			p = &row[x1 >> 1];
+			*p = ( *p & 0xF0 ) | ( lut[*p & 0x0F] & 0x0F );
+			x1--;
+		}
+
+		p = &row[x0 >> 1];
+		for ( n = ( x1 - x0 ) >> 1; n > 0; n--, p++ )
+		{
+			b = *p;
+			*p = ( lut[b & 0x0F] & 0x0F ) | ( lut[b >> 4] << 4 );
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "game.h"
+
+static game_update_t game_update;
+static game_render_t game_render;
+static void (*game_idle)(void);
+
+static input_state_t game_in;
+static game_stats_t game_stat;
+
+/******** Game_init *********
+* Sets up the game loop and starts the frame pipeline with page flipping.
+* Input_init must have been called.
+*  Inputs: update function, render function, function to run while
+*          waiting or NULL to sleep, first frame buffer, second frame
+*          buffer or NULL, frames per second or 0 for PIPE_FPS_DEFAULT
+* Outputs: 1 if the pipeline started, 0 if the scheduler table is full,
+*          when Game_run must not be called
+*/
+int Game_init( game_update_t update, game_render_t render,
+	void (*idle)(void), frame_buffer_t *a, frame_buffer_t *b, int fps )
+{
+	game_update = update;
+	game_render = render;
+	game_idle = idle;
+
+	return Pipe_init( a, b, fps, 1 );
+}
+
+/******** game_wait *********
+* Nothing to do until time passes or a buffer comes back.
+*/
+static void game_wait(void)
+{
+	uint32_t t = Systick_timeGetCount();
+
+	if ( game_idle )
+	{
+		game_idle();
+	}
+	else
+	{
+		/* SysTick wakes us within 10 us. */
+		__asm__ __volatile__ ("wfi");
+	}
+
+	game_stat.idle += Systick_timeDelta( t, Systick_timeGetCount() );
+}
+
+/******** Game_run *********
+* Runs the game loop, does not return. Update steps run at a fixed rate
+* from an accumulator of elapsed time, each with a fresh input snapshot.
+* After new steps a frame is rendered into whichever buffer the pipeline
+* has free while the previous frame is flushed by DMA. With nothing to
+* do, the idle function runs or the CPU sleeps until the next interrupt.
+*  Inputs: none
+* Outputs: none
+*/
+void Game_run(void)
+{
+	frame_buffer_t *f;
+	uint32_t last, now, acc = 0, t;
+	int n, fresh = 1;
+
+	last = Systick_timeGetCount();
+
+	while (1)
+	{
+		now = Systick_timeGetCount();
+		t = Systick_timeDelta( last, now );
+		acc += t;
+		game_stat.elapsed += t;
+		last = now;
+
+		for ( n = 0; acc >= GAME_STEP_TICKS; n++ )
+		{
+			if ( n == GAME_STEPS_MAX )
+			{
+				game_stat.steps_dropped += acc / GAME_STEP_TICKS;
+				acc %= GAME_STEP_TICKS;
+				break;
+			}
+
+			Input_read( &game_in );
+			game_stat.inputs = game_in.samples;
+			game_update( &game_in );
+			acc -= GAME_STEP_TICKS;
+		}
+
+		if ( n )
+		{
+			t = Systick_timeDelta( now, Systick_timeGetCount() );
+			game_stat.update = t;
+			if ( t > game_stat.update_max )
+			{
+				game_stat.update_max = t;
+			}
+			game_stat.steps += n;
+			fresh = 1;
+		}
+
+		/* A frame only after the game moved on, and only into a free
+		*  buffer; the one being flushed is left to the DMA. */
+		f = fresh ? Pipe_acquire() : NULL;
+		if ( !f )
+		{
+			game_wait();
+			continue;
+		}
+
+		t = Systick_timeGetCount();
+		game_render( f, (q15_t) ( ( acc * Q15_ONE ) / GAME_STEP_TICKS ) );
+		Pipe_submit( f );
+		fresh = 0;
+
+		t = Systick_timeDelta( t, Systick_timeGetCount() );
+		game_stat.render = t;
+		if ( t > game_stat.render_max )
+		{
+			game_stat.render_max = t;
+		}
+	}
+}
+
+/******** Game_stats *********
+* Copies out the stage counters and timings. Called from the game's own
+* functions, the loop owns the counters.
+*  Inputs: pointer to a game_stats_t to fill
+* Outputs: none
+*/
+void Game_stats( game_stats_t *stats )
+{
+	*stats = game_stat;
+
+	Pipe_stats( &stats->pipe );
+}
@@ -0,0 +1,360 @@
+#include "grid.h"
+#include "scene.h"
+
+/******** grid_cell *********
+* Cell index of a world coordinate, clamped to the grid.
+*/
+static int grid_cell( int v, int count )
+{
+	v >>= GRID_SHIFT;
+
+	if ( v < 0 )
+	{
+		return 0;
+	}
+
+	return ( v >= count ) ? count - 1 : v;
+}
+
+/******** grid_span *********
+* Cells covered by an object's bounding box, inclusive.
+*/
+static void grid_span( const scene_obj_t *o, int *cx0, int *cy0, int *cx1,
+	int *cy1 )
+{
+	int w = o->sprite->width ? o->sprite->width : 1;
+	int h = o->sprite->height ? o->sprite->height : 1;
+
+	*cx0 = grid_cell( o->x, GRID_COLS );
+	*cy0 = grid_cell( o->y, GRID_ROWS );
+	*cx1 = grid_cell( o->x + w - 1, GRID_COLS );
+	*cy1 = grid_cell( o->y + h - 1, GRID_ROWS );
+}
+
+/******** grid_init *********
+* Empties a grid.
+*  Inputs: pointer to a grid_t
+* Outputs: none
+*/
+void grid_init( grid_t *g )
+{
+	int j, k;
+
+	for ( j = 0; j < GRID_ROWS; j++ )
+	{
+		for ( k = 0; k < GRID_COLS; k++ )
+		{
+			g->cell[j][k] = GRID_NONE;
+		}
+	}
+
+	for ( j = 0; j < GRID_ENTRIES; j++ )
+	{
+		g->entry[j].obj = NULL;
+		g->entry[j].next = ( j + 1 < GRID_ENTRIES ) ? j + 1 : GRID_NONE;
+	}
+
+	g->free = 0;
+	g->freeCount = GRID_ENTRIES;
+	g->dropped = 0;
+}
+
+/******** grid_insert *********
+* Adds an object to the cells its bounding box covers. An object that
+* does not fit is counted in dropped until it is removed or fits.
+*  Inputs: pointer to a grid_t, pointer to a scene object not in a grid
+* Outputs: 1, or 0 if the grid is out of entries and it was not added
+*/
+int grid_insert( grid_t *g, scene_obj_t *o )
+{
+	int cx0, cy0, cx1, cy1, cx, cy;
+	uint16_t e;
+
+	grid_span( o, &cx0, &cy0, &cx1, &cy1 );
+
+	if ( ( cx1 - cx0 + 1 ) * ( cy1 - cy0 + 1 ) > g->freeCount )
+	{
+		if ( o->gx0 != GRID_DROPPED )
+		{
+			o->gx0 = GRID_DROPPED;
+			g->dropped++;
+		}
+		return 0;
+	}
+
+	if ( o->gx0 == GRID_DROPPED )
+	{
+		g->dropped--;
+	}
+
+	for ( cy = cy0; cy <= cy1; cy++ )
+	{
+		for ( cx = cx0; cx <= cx1; cx++ )
+		{
+			e = g->free;
+			g->free = g->entry[e].next;
+			g->freeCount--;
+
+			g->entry[e].obj = o;
+			g->entry[e].next = g->cell[cy][cx];
+			g->cell[cy][cx] = e;
+		}
+	}
+
+	o->gx0 = cx0;
+	o->gy0 = cy0;
+	o->gx1 = cx1;
+	o->gy1 = cy1;
+
+	return 1;
+}
+
+/******** grid_remove *********
+* Takes an object out of the grid, nothing if it is not in it.
+*  Inputs: pointer to a grid_t, pointer to a scene object
+* Outputs: none
+*/
+void grid_remove( grid_t *g, scene_obj_t *o )
+{
+	uint16_t *p;
+	uint16_t e;
+	int cx, cy;
+
+	if ( o->gx0 == GRID_OUT )
+	{
+		return;
+	}
+
+	if ( o->gx0 == GRID_DROPPED )
+	{
+		g->dropped--;
+		o->gx0 = GRID_OUT;
+		return;
+	}
+
+	for ( cy = o->gy0; cy <= o->gy1; cy++ )
+	{
+		for ( cx = o->gx0; cx <= o->gx1; cx++ )
+		{
+			for ( p = &g->cell[cy][cx]; *p != GRID_NONE; p = &g->entry[*p].next )
+			{
+				if ( g->entry[*p].obj == o )
+				{
+					e = *p;
+					*p = g->entry[e].next;
+
+					g->entry[e].obj = NULL;
+					g->entry[e].next = g->free;
+					g->free = e;
+					g->freeCount++;
+					break;
+				}
+			}
+		}
+	}
+
+	o->gx0 = GRID_OUT;
+}
+
+/******** grid_move *********
+* Updates an object's cells after it moved or changed sprite. Costs one
+* comparison while it stays within the same cells. A dropped object is
+* tried again.
+*  Inputs: pointer to a grid_t, pointer to a scene object in the grid
+* Outputs: 1, or 0 if the grid ran out of entries and it was dropped
+*/
+int grid_move( grid_t *g, scene_obj_t *o )
+{
+	int cx0, cy0, cx1, cy1;
+
+	grid_span( o, &cx0, &cy0, &cx1, &cy1 );
+
+	if ( ( cx0 == o->gx0 ) && ( cy0 == o->gy0 ) && ( cx1 == o->gx1 ) &&
+		( cy1 == o->gy1 ) )
+	{
+		return 1;
+	}
+
+	grid_remove( g, o );
+
+	return grid_insert( g, o );
+}
+
+/******** grid_find *********
+* Collects the objects other than skip overlapping a rectangle. An object
+* in several cells is reported from the one holding the top left corner
+* of its overlap with the rectangle, so each comes out once without
+* marking.
+*/
+static int grid_find( grid_t *g, int x0, int y0, int x1, int y1,
+	const scene_obj_t *skip, scene_obj_t **out, int max )
+{
+	scene_obj_t *o;
+	uint16_t e;
+	int cx0, cy0, cx1, cy1, cx, cy, n = 0;
+
+	if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+	{
+		return 0;
+	}
+
+	cx0 = grid_cell( x0, GRID_COLS );
+	cy0 = grid_cell( y0, GRID_ROWS );
+	cx1 = grid_cell( x1 - 1, GRID_COLS );
+	cy1 = grid_cell( y1 - 1, GRID_ROWS );
+
+	for ( cy = cy0; cy <= cy1; cy++ )
+	{
+		for ( cx = cx0; cx <= cx1; cx++ )
+		{
+			for ( e = g->cell[cy][cx]; e != GRID_NONE; e = g->entry[e].next )
+			{
+				o = g->entry[e].obj;
+
+				if ( ( o == skip ) || ( o->x >= x1 ) || ( o->y >= y1 ) ||
+					( o->x + o->sprite->width <= x0 ) ||
+					( o->y + o->sprite->height <= y0 ) )
+				{
+					continue;
+				}
+
+				if ( ( grid_cell( ( o->x > x0 ) ? o->x : x0, GRID_COLS ) != cx ) ||
+					( grid_cell( ( o->y > y0 ) ? o->y : y0, GRID_ROWS ) != cy ) )
+				{
+					continue;
+				}
+
+				if ( n == max )
+				{
+					return n;
+				}
+				out[n++] = o;
+			}
+		}
+	}
+
+	return n;
+}
+
+/******** grid_query *********
+* Finds the objects whose bounding boxes overlap a rectangle, each once,
+* in no particular order. Only the cells under the rectangle are visited.
+*  Inputs: pointer to a grid_t, world x0, y0, x1, y1 (exclusive), array
+*  to receive the objects, its size
+* Outputs: number of objects found, at most the array size
+*/
+int grid_query( grid_t *g, int x0, int y0, int x1, int y1,
+	scene_obj_t **out, int max )
+{
+	return grid_find( g, x0, y0, x1, y1, NULL, out, max );
+}
+
+/******** grid_collide *********
+* Finds the other objects whose bounding boxes overlap an object's.
+*  Inputs: pointer to a grid_t, pointer to a scene object, array to
+*  receive the objects, its size
+* Outputs: number of objects found, at most the array size
+*/
+int grid_collide( grid_t *g, scene_obj_t *o, scene_obj_t **out, int max )
+{
+	return grid_find( g, o->x, o->y, o->x + o->sprite->width,
+		o->y + o->sprite->height, o, out, max );
+}
+
+/******** grid_maskInit *********
+* Derives a collision mask from a sprite's pixels other than its key.
+*  Inputs: pointer to a grid_mask_t, pointer to a sprite_obj_t, mask
+*  memory of GRID_MASK_WORDS words, its length in words
+* Outputs: 1, or 0 if the memory is too small
+*/
+int grid_maskInit( grid_mask_t *m, const sprite_obj_t *s, uint32_t *bits,
+	int length )
+{
+	const uint8_t *row;
+	uint32_t *w;
+	int x, y, p;
+
+	m->width = s->width;
+	m->height = s->height;
+	m->stride = ( s->width + 31 ) >> 5;
+	m->bits = bits;
+
+	if ( length < GRID_MASK_WORDS( s->width, s->height ) )
+	{
+		return 0;
+	}
+
+	for ( y = 0; y < s->height; y++ )
+	{
+		row = &s->bmp_data[y * SPRITE_STRIDE( s->width )];
+		w = &bits[y * m->stride];
+
+		for ( x = 0; x < m->stride; x++ )
+		{
+			w[x] = 0;
+		}
+
+		for ( x = 0; x < s->width; x++ )
+		{
+			p = ( row[x >> 1] >> ( ( x & 1 ) << 2 ) ) & 0x0F;
+
+			if ( p != s->key )
+			{
+				w[x >> 5] |= 1u << ( x & 31 );
+			}
+		}
+	}
+
+	return 1;
+}
+
+/******** grid_bits *********
+* n (1 to 32) mask bits of a row from bit on, in the low bits.
+*/
+static uint32_t grid_bits( const uint32_t *row, int bit, int n )
+{
+	int sh = bit & 31;
+	uint32_t w = row[bit >> 5] >> sh;
+
+	if ( sh && ( sh + n > 32 ) )
+	{
+		w |= row[( bit >> 5 ) + 1] << ( 32 - sh );
+	}
+
+	return ( n < 32 ) ? w & ( ( 1u << n ) - 1 ) : w;
+}
+
+/******** grid_maskOverlap *********
+* Tests two masks at world positions for a shared opaque pixel, 32
+* pixels of a row at a time. Masks are unflipped.
+*  Inputs: first mask, its x, y, second mask, its x, y
+* Outputs: 1 if they touch, 0 if not
+*/
+int grid_maskOverlap( const grid_mask_t *a, int ax, int ay,
+	const grid_mask_t *b, int bx, int by )
+{
+	int x0 = ( ax > bx ) ? ax : bx;
+	int y0 = ( ay > by ) ? ay : by;
+	int x1 = ( ax + a->width < bx + b->width ) ? ax + a->width : bx + b->width;
+	int y1 = ( ay + a->height < by + b->height ) ? ay + a->height : by + b->height;
+	const uint32_t *ra, *rb;
+	int x, y, n;
+
+	for ( y = y0; y < y1; y++ )
+	{
+		ra = &a->bits[( y - ay ) * a->stride];
+		rb = &b->bits[( y - by ) * b->stride];
+
+		for ( x = x0; x < x1; x += 32 )
+		{
+			n = ( x1 - x < 32 ) ? x1 - x : 32;
+
+			if ( grid_bits( ra, x - ax, n ) & grid_bits( rb, x - bx, n ) )
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include "input.h"
+
+/* ADC channel of each axis: PA0, PA1, PC1, PC0. */
+static uint8_t input_channel[INPUT_AXES] = { 0, 1, 11, 10 };
+
+static input_state_t input_now;
+static int input_axis;          /* axis being converted                 */
+static uint8_t input_last;      /* previous raw button sample           */
+static int input_run;
+
+/********* input_buttons *******
+*  Raw button bits from the pins.
+*/
+static uint8_t input_buttons(void)
+{
+	uint16_t pins = gpio_get( PORT_BTN, BTN_LEFT | BTN_RIGHT );
+	uint8_t b = 0;
+
+	if ( INPUT_BTN_ACTIVE_LOW )
+	{
+		pins = ~pins;
+	}
+
+	if ( pins & BTN_LEFT )
+	{
+		b |= INPUT_BTN_LEFT;
+	}
+	if ( pins & BTN_RIGHT )
+	{
+		b |= INPUT_BTN_RIGHT;
+	}
+
+	return b;
+}
+
+/********* input_start *******
+*  Starts a single conversion of the current axis.
+*/
+static void input_start(void)
+{
+	adc_set_regular_sequence( ADC1, 1, &input_channel[input_axis] );
+	adc_start_conversion_regular( ADC1 );
+}
+
+/********* Input_init *******
+*  Calibrates and starts the ADC for the joysticks, then adds the input
+*  event to the scheduler. Pins and clocks are set up by Low_init.
+*   Inputs: none
+*  Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int Input_init(void)
+{
+	int j;
+
+	adc_power_off( ADC1 );
+	adc_set_clk_source( ADC1, ADC_CLKSOURCE_ADC );
+	adc_calibrate( ADC1 );
+	adc_set_operation_mode( ADC1, ADC_MODE_SCAN );
+	adc_disable_external_trigger_regular( ADC1 );
+	adc_set_right_aligned( ADC1 );
+	adc_set_sample_time_on_all_channels( ADC1, ADC_SMPTIME_071DOT5 );
+	adc_set_resolution( ADC1, ADC_RESOLUTION_12BIT );
+	adc_power_on( ADC1 );
+
+	for ( j = 0; j < INPUT_AXES; j++ )
+	{
+		input_now.joy[j] = INPUT_JOY_CENTRE;
+	}
+	input_now.buttons = 0;
+	input_now.pressed = 0;
+	input_now.released = 0;
+	input_now.samples = 0;
+	input_last = input_buttons();
+
+	input_axis = 0;
+	input_start();
+
+	input_run = 1;
+	return Sched_addEvent( &Input_event, INPUT_PERIOD_MS * INPUT_TICKS_PER_MS,
+		NULL, &input_run );
+}
+
+/********* Input_read *******
+*  Copies out the latest controls and clears the button edges.
+*   Inputs: pointer to an input_state_t to fill
+*  Outputs: none
+*/
+void Input_read( input_state_t *in )
+{
+	cm_disable_interrupts();
+	*in = input_now;
+	input_now.pressed = 0;
+	input_now.released = 0;
+	cm_enable_interrupts();
+}
+
+/********* Input_event *******
+*  Scheduler event, samples the controls at a fixed rate. The conversion
+*  started by the last run is read and the next axis started, so the
+*  event never waits on the ADC. A button changes state once two samples
+*  in a row agree.
+*   Inputs: unused queue, pointer to the input run flag
+*  Outputs: none
+*/
+void Input_event( Queue_t *queue, int *flagPt )
+{
+	uint8_t b, changed;
+
+	if ( adc_eoc( ADC1 ) )
+	{
+		input_now.joy[input_axis] = adc_read_regular( ADC1 );
+
+		if ( ++input_axis == INPUT_AXES )
+		{
+			input_axis = 0;
+		}
+		input_start();
+	}
+
+	b = input_buttons();
+	if ( b == input_last )
+	{
+		changed = b ^ input_now.buttons;
+		input_now.pressed |= changed & b;
+		input_now.released |= changed & ~b;
+		input_now.buttons = b;
+	}
+	input_last = b;
+
+	input_now.samples++;
+}
@@ -18,13 +18,15 @@ void Low_init(void) {
 */
 void rcc_init(void) {
 	rcc_clock_setup_in_hsi_out_48mhz();
-	/*  rcc_clock_setup_in_hse_8mhz_out_48mhz();
+	/*  rcc_clock_setup_in_hse_8mhz_out_48mhz(); */
 	rcc_periph_clock_enable(RCC_GPIOA);
 	rcc_periph_clock_enable(RCC_GPIOB);
 	rcc_periph_clock_enable(RCC_GPIOC);
 	rcc_periph_clock_enable(RCC_DMA);
 	rcc_periph_clock_enable(RCC_SPI1);
 	rcc_periph_clock_enable(RCC_USART2);
+	rcc_periph_clock_enable(RCC_CRC);
+	rcc_periph_clock_enable(RCC_ADC);
 }
 
 /********* gpio_init *******
@@ -67,7 +69,20 @@ void gpio_init(void) {
 	gpio_set_output_options( PORT_OLED, GPIO_OTYPE_OD, GPIO_OSPEED_2MHZ, RST );
 
 	/* Additional pins for OLED display: Data/Command Select (DC) */
+#ifdef OLED_SPI_4WIRE
+	/* 4-wire transport switches D/C between SPI runs, needs fast edges */
+	gpio_mode_setup( PORT_OLED, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DC );
+	gpio_set_output_options( PORT_OLED, GPIO_OTYPE_PP, GPIO_OSPEED_25MHZ, DC );
+#else
 	gpio_mode_setup( PORT_OLED, GPIO_MODE_OUTPUT, GPIO_PUPD_PULLUP, DC );
 	gpio_set_output_options( PORT_OLED, GPIO_OTYPE_OD, GPIO_OSPEED_2MHZ, DC );
+#endif
+
+	/* Buttons, switched to ground */
+	gpio_mode_setup( PORT_BTN, GPIO_MODE_INPUT, GPIO_PUPD_PULLUP, BTN_LEFT | BTN_RIGHT );
+
+	/* Joysticks, ADC inputs */
+	gpio_mode_setup( JOY_PORT_LEFT, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, JOY_X_LEFT | JOY_Y_LEFT );
+	gpio_mode_setup( JOY_PORT_RIGHT, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, JOY_X_RIGHT | JOY_Y_RIGHT );
 }
 
@@ -9,18 +9,70 @@
 
 #include "ssd1322_oled.h"
 #include "frame.h"
+#include "input.h"
+#include "game.h"
 
 #include <libopencm3/stm32/f0/rcc.h>
 #include <stdio.h>
 #include <stddef.h>
 
+/* Two 2bpp frames, 4 KB each, so rendering overlaps the flush. */
+static uint8_t frame_a[256 * 64 / 4] __attribute__((aligned(4)));
+static uint8_t frame_b[256 * 64 / 4] __attribute__((aligned(4)));
+static frame_buffer_t fb_a, fb_b;
+
+/* Demo: a box steered by the left joystick, buttons change its shade. */
+static int box_x = 120, box_y = 24, box_px = 120, box_py = 24;
+static int box_level = 3;
+
+/* Where the box was drawn last. Each frame starts as a copy of the last one
+*  submitted, so only that rectangle needs erasing. */
+static int box_dx = 120, box_dy = 24;
+
+/* Steps per update from an axis, none inside the dead zone, where a stick
+*  at rest still reads a little off centre. */
+static int demo_axis( uint16_t raw )
+{
+	int d = raw - INPUT_JOY_CENTRE;
+
+	if ( ( d > -INPUT_JOY_DEAD ) && ( d < INPUT_JOY_DEAD ) )
+	{
+		return 0;
+	}
+	return d / 512;
+}
+
+static void demo_update( const input_state_t *in )
+{
+	box_px = box_x;
+	box_py = box_y;
+
+	box_x += demo_axis( in->joy[INPUT_LEFT_X] );
+	box_y += demo_axis( in->joy[INPUT_LEFT_Y] );
+
+	if ( box_x < 0 ) box_x = 0;
+	if ( box_x > 256 - 16 ) box_x = 256 - 16;
+	if ( box_y < 0 ) box_y = 0;
+	if ( box_y > 64 - 16 ) box_y = 64 - 16;
+
+	if ( ( in->pressed & INPUT_BTN_LEFT ) && ( box_level > 1 ) ) box_level--;
+	if ( ( in->pressed & INPUT_BTN_RIGHT ) && ( box_level < 3 ) ) box_level++;
+}
+
+static void demo_render( frame_buffer_t *f, q15_t alpha )
+{
+	/* Between the last two steps, by how far time is into the next. */
+	int x = box_px + fixed_mulQ15( box_x - box_px, alpha );
+	int y = box_py + fixed_mulQ15( box_y - box_py, alpha );
+
+	frame_fillRect( f, box_dx, box_dy, 16, 16, 0 );
+	frame_fillRect( f, x, y, 16, 16, box_level );
+	box_dx = x;
+	box_dy = y;
+}
+
 int main(void)
 {
-	
-	size_t s;
-	char test[64];
-	volatile int i;
-	int x,y,prev_x,prev_y = 0;
 	/*
 	volatile uint8_t frame_buffer[16];
 	frame_buffer_t fb_t;
@@ -37,53 +89,27 @@ int main(void)
 	
 	Sched_init();
 	Systick_init();
+
+	Oled_init();
 	
-	
-	//s = sprintf( test, " %lu ", RCC_CFGR );
-	//Uart_send( test, s );
-
-	while (1) {
-
-		//Test_start( &a_test_table );
-
-		Uart_send( " Fluffy cats shed hair everywhere ", 34 );
-		
-		/*
-		for ( i = 0; i < 16; i++ )
-		{
-			s = sprintf( test, " %x ", frame_buffer[i] );
-			Uart_send( test, s );
-			Uart_send( " ", 1 );
-		}
-		Uart_send( "\n\n", 2 );
-
-		prev_x = x - 1;
-		if ( prev_x < 0 )
-		{
-			prev_x = 7;
-			prev_y = y - 1;
-			if ( prev_y < 0 ) prev_y = 3;
-		}
-		
-
-		// set current pixel to F
-		//buffer_pixelSet( &fb_t,  )
-		// set last pixel to 0
-		//buffer_pixelSet( &fb_t,  )
-		// increment column
-		x += 1;
-		if ( x == 8 ) // reached end of column, increment line and reset column
-		{
-			x = 0;
-			y += 1;
-		}
-		if ( y = 4 ) // reached last line, return to first line
-		{
-			y = 0;
-		}
-		*/
-		Systick_delayTicks(5000);
-		
+
+	if ( !Input_init() )
+	{
+		Uart_send( " Input_init: scheduler full ", 28 );
+		while ( 1 );
+	}
+
+	frame_bufferInitBpp( &fb_a, 256, 64, FRAME_BPP_2, frame_a, sizeof( frame_a ), NULL );
+	frame_bufferInitBpp( &fb_b, 256, 64, FRAME_BPP_2, frame_b, sizeof( frame_b ), NULL );
+
+	Uart_send( " Fluffy cats shed hair everywhere ", 34 );
+
+	if ( !Game_init( demo_update, demo_render, NULL, &fb_a, &fb_b, 50 ) )
+	{
+		Uart_send( " Game_init: scheduler full ", 27 );
+		while ( 1 );
 	}
+	Game_run();
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "pipeline.h"
+
+/* Frame buffer states. */
+#define PIPE_FREE     0        /* may be handed to the application      */
+#define PIPE_DRAWING  1        /* held by the application               */
+#define PIPE_READY    2        /* drawn, waiting for a frame slot       */
+#define PIPE_FLUSHING 3        /* being sent to the display             */
+
+struct pipe_buffer
+{
+	frame_buffer_t *frame;
+	int state;
+	uint32_t stamp;            /* time drawing started                  */
+};
+
+static struct pipe_buffer pipe_buf[2];
+static int pipe_count;
+static int pipe_flushing = -1;          /* buffer being flushed or -1   */
+static uint32_t pipe_flushStart;
+static int pipe_run;
+
+/* Regions the last submitted frame changed, and the buffer it came from. */
+static frame_rect_t pipe_lastRects[FRAME_DIRTY_MAX];
+static int pipe_lastCount;
+static int pipe_last = -1;
+
+static pipe_stats_t pipe_stat;
+
+/******** pipe_flushed *********
+* Last pixel of the flushed frame is out, the buffer is free again.
+*/
+static void pipe_flushed(void)
+{
+	uint32_t t = Systick_timeDelta( pipe_flushStart, Systick_timeGetCount() );
+
+	pipe_stat.flush = t;
+	if ( t > pipe_stat.flush_max )
+	{
+		pipe_stat.flush_max = t;
+	}
+	pipe_stat.frames++;
+
+	pipe_buf[pipe_flushing].state = PIPE_FREE;
+	pipe_flushing = -1;
+}
+
+/******** pipe_copyRect *********
+* Copies a region of the last submitted frame into the buffer about to be
+* drawn, rounded out to whole words, or to whole bytes when the rows are
+* not word aligned. Both buffers share one format, and outside the regions
+* the last frame changed they already match, so the rounding is harmless.
+*/
+static void pipe_copyRect( frame_buffer_t *dst, const frame_buffer_t *src,
+	const frame_rect_t *r )
+{
+	int b0 = ( r->x0 * dst->bpp ) >> 3;
+	int b1 = ( r->x1 * dst->bpp + 7 ) >> 3;
+	int y, b;
+
+	if ( !( ( (uintptr_t) dst->data | (uintptr_t) src->data |
+		dst->h_width ) & 3 ) )
+	{
+		b0 >>= 2;
+		b1 = ( b1 + 3 ) >> 2;
+
+		for ( y = r->y0; y < r->y1; y++ )
+		{
+			volatile uint32_t *d =
+				(volatile uint32_t *) ( dst->data + y * dst->h_width );
+			const volatile uint32_t *s =
+				(const volatile uint32_t *) ( src->data + y * src->h_width );
+
+			for ( b = b0; b < b1; b++ )
+			{
+				d[b] = s[b];
+			}
+		}
+		return;
+	}
+
+	for ( y = r->y0; y < r->y1; y++ )
+	{
+		volatile uint8_t *d = dst->data + y * dst->h_width;
+		const volatile uint8_t *s = src->data + y * src->h_width;
+
+		for ( b = b0; b < b1; b++ )
+		{
+			d[b] = s[b];
+		}
+	}
+}
+
+/******** Pipe_init *********
+* Starts paced flushing of frames. Each frame slot, the newest submitted
+* frame is flushed by DMA while the application draws the next one.
+* With one frame buffer the application waits for the flush between
+* frames. With two, drawing overlaps the flush. Display RAM page flipping,
+* when asked for, keeps the panel from showing a half sent frame either
+* way; otherwise the current Oled_pageFlip setting is left alone.
+*  Inputs: first frame buffer, second frame buffer or NULL, frames per
+*          second or 0 for PIPE_FPS_DEFAULT, 1 to switch page flipping on
+* Outputs: 1 if started, 0 if the scheduler table is full
+*/
+int Pipe_init( frame_buffer_t *a, frame_buffer_t *b, int fps, int flip )
+{
+	if ( fps <= 0 )
+	{
+		fps = PIPE_FPS_DEFAULT;
+	}
+
+	pipe_buf[0].frame = a;
+	pipe_buf[0].state = PIPE_FREE;
+	pipe_buf[1].frame = b;
+	pipe_buf[1].state = PIPE_FREE;
+	pipe_count = b ? 2 : 1;
+
+	if ( flip )
+	{
+		Oled_pageFlip(1);
+	}
+
+	pipe_run = 1;
+	return Sched_addEvent( &Pipe_frameEvent, SYSTICK_HZ / fps, NULL,
+		&pipe_run );
+}
+
+/******** Pipe_acquire *********
+* Hands out a frame buffer to draw the next frame into, one at a time. With
+* two buffers, regions the other buffer changed in its last frame are copied
+* over from it and marked dirty here, so every frame starts from the last
+* one submitted.
+*  Inputs: none
+* Outputs: frame buffer, or NULL while none is free
+*/
+frame_buffer_t *Pipe_acquire(void)
+{
+	frame_buffer_t *f = NULL;
+	int j, k, from = -1;
+
+	cm_disable_interrupts();
+
+	/* One frame is drawn at a time, so each starts from the last submitted. */
+	for ( j = 0; j < pipe_count; j++ )
+	{
+		if ( pipe_buf[j].state == PIPE_DRAWING )
+		{
+			cm_enable_interrupts();
+			return NULL;
+		}
+	}
+
+	/* Starting after the last submitted buffer, so two free buffers take
+	*  turns. Handing the same one out twice would leave the other behind
+	*  by more than the last frame's regions. */
+	for ( k = 1; k <= pipe_count; k++ )
+	{
+		j = pipe_last + k;
+		if ( j >= pipe_count )
+		{
+			j -= pipe_count;
+		}
+		if ( pipe_buf[j].state == PIPE_FREE )
+		{
+			break;
+		}
+	}
+
+	if ( k <= pipe_count )
+	{
+		f = pipe_buf[j].frame;
+		pipe_buf[j].state = PIPE_DRAWING;
+		pipe_buf[j].stamp = Systick_timeGetCount();
+
+		if ( ( pipe_last >= 0 ) && ( pipe_last != j ) )
+		{
+			from = pipe_last;
+		}
+	}
+
+	cm_enable_interrupts();
+
+	/* Copied with interrupts on. Marked DRAWING, nothing else hands out a
+	*  buffer meanwhile, and only Pipe_submit changes the last frame's
+	*  regions. The flush only reads the other buffer. */
+	if ( from >= 0 )
+	{
+		for ( k = 0; k < pipe_lastCount; k++ )
+		{
+			pipe_copyRect( f, pipe_buf[from].frame, &pipe_lastRects[k] );
+			frame_dirtyAdd( f, pipe_lastRects[k].x0, pipe_lastRects[k].y0,
+				pipe_lastRects[k].x1, pipe_lastRects[k].y1 );
+		}
+	}
+
+	return f;
+}
+
+/******** Pipe_submit *********
+* Hands a drawn frame back for the next frame slot. An older frame still
+* waiting for its slot is discarded and counted as dropped. With damage
+* detection on, the frame is scanned here, so the frame slot event only
+* starts the transfers.
+*  Inputs: frame buffer from Pipe_acquire
+* Outputs: none
+*/
+void Pipe_submit( frame_buffer_t *f )
+{
+	uint32_t t;
+	int j, k;
+
+	Oled_damageScan(f);
+
+	cm_disable_interrupts();
+
+	j = ( pipe_buf[0].frame == f ) ? 0 : 1;
+
+	t = Systick_timeDelta( pipe_buf[j].stamp, Systick_timeGetCount() );
+	pipe_stat.render = t;
+	if ( t > pipe_stat.render_max )
+	{
+		pipe_stat.render_max = t;
+	}
+
+	if ( pipe_buf[j ^ 1].state == PIPE_READY )
+	{
+		/* Never shown, its changes carry over into this frame. A scan
+		*  compared this frame to it, not to what the display holds. */
+		for ( k = 0; k < pipe_buf[j ^ 1].frame->dirtyCount; k++ )
+		{
+			frame_rect_t *r = &pipe_buf[j ^ 1].frame->dirty[k];
+
+			frame_dirtyAdd( f, r->x0, r->y0, r->x1, r->y1 );
+		}
+		pipe_buf[j ^ 1].state = PIPE_FREE;
+		pipe_stat.dropped++;
+	}
+
+	for ( k = 0; k < f->dirtyCount; k++ )
+	{
+		pipe_lastRects[k] = f->dirty[k];
+	}
+	pipe_lastCount = f->dirtyCount;
+	pipe_last = j;
+
+	pipe_buf[j].state = PIPE_READY;
+
+	cm_enable_interrupts();
+}
+
+/******** Pipe_stats *********
+* Copies out the frame counters and timings.
+*  Inputs: pointer to a pipe_stats_t to fill
+* Outputs: none
+*/
+void Pipe_stats( pipe_stats_t *stats )
+{
+	cm_disable_interrupts();
+	*stats = pipe_stat;
+	cm_enable_interrupts();
+}
+
+/******** Pipe_frameEvent *********
+* Scheduler event, runs once per frame slot. Flushes the frame waiting for
+* this slot, or counts the slot as dropped when the previous flush or the
+* frame being drawn is late.
+*  Inputs: unused queue, pointer to the pipeline's run flag
+* Outputs: none
+*/
+void Pipe_frameEvent( Queue_t *queue, int *flagPt )
+{
+	int j;
+
+	for ( j = 0; j < pipe_count; j++ )
+	{
+		if ( pipe_buf[j].state == PIPE_READY )
+		{
+			break;
+		}
+	}
+
+	if ( j == pipe_count )
+	{
+		/* Nothing new. Only late if a frame is being drawn. */
+		for ( j = 0; j < pipe_count; j++ )
+		{
+			if ( pipe_buf[j].state == PIPE_DRAWING )
+			{
+				pipe_stat.dropped++;
+				break;
+			}
+		}
+		return;
+	}
+
+	if ( pipe_flushing >= 0 )
+	{
+		pipe_stat.dropped++;
+		return;
+	}
+
+	pipe_buf[j].state = PIPE_FLUSHING;
+	pipe_flushing = j;
+	pipe_flushStart = Systick_timeGetCount();
+
+	if ( !Oled_flushNotify( pipe_buf[j].frame, pipe_flushed ) )
+	{
+		/* Display link taken by other traffic, retry next slot. */
+		pipe_buf[j].state = PIPE_READY;
+		pipe_flushing = -1;
+		pipe_stat.dropped++;
+	}
+}
@@ -0,0 +1,237 @@
+#include "plot.h"
+
+static void plot_draw( widget_t *w, frame_buffer_t *f, int x, int y );
+
+/******** plot_init *********
+* Initializes a strip chart widget, drawn in w.fore over w.back (0 unless
+* changed). Add it to a tree with widget_add.
+*  Inputs: pointer to a plot_t, x, y relative to the parent, width,
+*  height, sample storage of width entries, source queue or NULL,
+*  sample shown on the bottom row, sample shown on the top row
+* Outputs: none
+*/
+void plot_init( plot_t *p, int x, int y, int width, int height,
+	uint16_t *ring, Queue_t *source, int min, int max )
+{
+	widget_init( &p->w, x, y, width, height, plot_draw, 0 );
+
+	p->source = source;
+	p->ring = ring;
+	p->cursor = 0;
+	p->filled = 0;
+	p->pending = 0;
+	p->min = min;
+	p->max = max;
+
+	/* One divide here, none per sample. */
+	p->scale = ( max > min ) ? ( (uint32_t) ( height - 1 ) << 16 ) / ( max - min ) : 0;
+}
+
+/******** plot_push *********
+* Appends samples without drawing them, plot_update draws them.
+*  Inputs: pointer to a plot_t, samples, number of samples
+* Outputs: none
+*/
+void plot_push( plot_t *p, const uint16_t *samples, int n )
+{
+	int j;
+
+	for ( j = 0; j < n; j++ )
+	{
+		p->ring[p->cursor] = samples[j];
+
+		if ( ++p->cursor == p->w.width )
+		{
+			p->cursor = 0;
+			p->filled = 1;
+		}
+	}
+
+	p->pending += n;
+	if ( p->pending > p->w.width )
+	{
+		p->pending = p->w.width;
+	}
+}
+
+/******** plot_row *********
+* Row of the chart a sample is plotted on.
+*/
+static int plot_row( plot_t *p, uint16_t s )
+{
+	if ( s <= p->min )
+	{
+		return p->w.height - 1;
+	}
+	if ( s >= p->max )
+	{
+		return 0;
+	}
+
+	/* ( s - min ) * scale stays below height << 16. */
+	return p->w.height - 1 - (int) ( ( ( s - p->min ) * p->scale ) >> 16 );
+}
+
+/******** plot_valid *********
+* Whether a column holds a sample, columns in the gap ahead of the cursor
+* do not.
+*/
+static int plot_valid( plot_t *p, int col )
+{
+	int d = col - p->cursor;
+
+	if ( d < 0 )
+	{
+		d += p->w.width;
+	}
+
+	return ( d >= PLOT_GAP ) && ( p->filled || ( col < p->cursor ) );
+}
+
+/******** plot_column *********
+* Draws one column of the trace, a vertical span joining the sample to the
+* previous column's so steep edges stay connected.
+*/
+static void plot_column( plot_t *p, frame_buffer_t *f, int x, int y,
+	int col, int clear )
+{
+	int prev = ( col ? col : p->w.width ) - 1;
+	int y0, y1, t;
+
+	if ( clear )
+	{
+		frame_spanV( f, x + col, y, p->w.height, p->w.back );
+	}
+
+	if ( !plot_valid( p, col ) )
+	{
+		return;
+	}
+
+	y1 = plot_row( p, p->ring[col] );
+	y0 = plot_valid( p, prev ) ? plot_row( p, p->ring[prev] ) : y1;
+
+	if ( y0 > y1 )
+	{
+		t = y0;
+		y0 = y1;
+		y1 = t;
+	}
+
+	frame_spanV( f, x + col, y + y0, y1 - y0 + 1, p->w.fore );
+}
+
+/******** plot_draw *********
+* Widget draw function, the whole chart over the filled background.
+*/
+static void plot_draw( widget_t *w, frame_buffer_t *f, int x, int y )
+{
+	plot_t *p = (plot_t *) w;
+	int col;
+
+	for ( col = 0; col < w->width; col++ )
+	{
+		plot_column( p, f, x, y, col, 0 );
+	}
+
+	p->pending = 0;
+}
+
+/******** plot_dirty *********
+* Marks frame columns x0 to x1 (exclusive) of the chart dirty, clipped.
+*/
+static void plot_dirty( frame_buffer_t *f, const frame_rect_t *r, int x0,
+	int x1 )
+{
+	if ( x0 < r->x0 )
+	{
+		x0 = r->x0;
+	}
+	if ( x1 > r->x1 )
+	{
+		x1 = r->x1;
+	}
+
+	if ( x0 < x1 )
+	{
+		frame_dirtyAdd( f, x0, r->y0, x1, r->y1 );
+	}
+}
+
+/******** plot_update *********
+* Takes the samples waiting in the source queue and draws the columns
+* they and plot_push changed straight into the frame, marking only those
+* columns dirty. Call once per frame before widget_redraw, in main
+* context. A chart already invalidated, or with a full width of new
+* samples, is left to widget_redraw.
+*  Inputs: pointer to a plot_t, pointer to a frame_buffer_t
+* Outputs: number of new samples
+*/
+int plot_update( plot_t *p, frame_buffer_t *f )
+{
+	uint16_t s[PLOT_CHUNK];
+	frame_buffer_t view;
+	frame_rect_t r;
+	int n, m, j, col, first, x, y, vx;
+
+	if ( p->source )
+	{
+		while ( ( n = Queue_get( p->source, s, PLOT_CHUNK ) ) > 0 )
+		{
+			plot_push( p, s, n );
+		}
+	}
+
+	n = p->pending;
+	if ( !n )
+	{
+		return 0;
+	}
+
+	if ( ( p->w.flags & WIDGET_DIRTY ) || ( n + PLOT_GAP >= p->w.width ) )
+	{
+		widget_invalidate( &p->w );
+		return n;
+	}
+
+	p->pending = 0;
+
+	if ( !widget_bounds( &p->w, f, &x, &y, &r ) )
+	{
+		return n;
+	}
+
+	/* The new columns, the gap after them and the first old column, which
+	*  is no longer joined to the one before it. Possibly wrapping. */
+	m = n + PLOT_GAP + 1;
+	first = p->cursor - n;
+	if ( first < 0 )
+	{
+		first += p->w.width;
+	}
+
+	vx = frame_view( &view, f, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0 );
+
+	for ( j = 0, col = first; j < m; j++ )
+	{
+		plot_column( p, &view, x - vx, y - r.y0, col, 1 );
+
+		if ( ++col == p->w.width )
+		{
+			col = 0;
+		}
+	}
+
+	/* Mark them dirty, as two spans if they wrapped. */
+	if ( first + m <= p->w.width )
+	{
+		plot_dirty( f, &r, x + first, x + first + m );
+	}
+	else
+	{
+		plot_dirty( f, &r, x + first, x + p->w.width );
+		plot_dirty( f, &r, x, x + first + m - p->w.width );
+	}
+
+	return n;
+}
@@ -0,0 +1,84 @@
+#include "rle.h"
+#include "sprite.h"
+
+/******** rle_row *********
+* Decodes one image row into a frame row. px is the frame x of the image's
+* first pixel, x0 and x1 the visible frame columns.
+*/
+static void rle_row( volatile uint8_t *row, const uint8_t *run, int width,
+	int px, int x0, int x1 )
+{
+	int n, a, b, op;
+
+	while ( width > 0 )
+	{
+		op = *run & RLE_OP_MASK;
+		n = ( *run++ & RLE_LEN_MASK ) + 1;
+
+		/* Visible part of the run. */
+		a = ( px > x0 ) ? px : x0;
+		b = ( px + n < x1 ) ? px + n : x1;
+
+		if ( op == RLE_FILL )
+		{
+			if ( a < b )
+			{
+				frame_rowSet( row, a, b, *run & 0x0F );
+			}
+			run++;
+		}
+		else if ( op == RLE_LIT )
+		{
+			if ( a < b )
+			{
+				sprite_span( row, run, a, b, a - px, 1, SPRITE_NO_KEY );
+			}
+			run += ( n + 1 ) >> 1;
+		}
+
+		px += n;
+		width -= n;
+
+		if ( px >= x1 )
+		{
+			break;
+		}
+	}
+}
+
+/******** rle_blit *********
+* Decodes an image straight into a frame buffer with its top left corner
+* at x, y, clipped to the buffer. Fill runs are written a word at a time,
+* literal runs copied, transparent runs skipped without touching memory.
+* 4bpp frames only, others are left untouched.
+*  Inputs: pointer to a frame_buffer_t, pointer to an rle_image_t, x, y
+* Outputs: none
+*/
+void rle_blit( frame_buffer_t *f, const rle_image_t *img, int x, int y )
+{
+	int x0 = x, y0 = y, x1 = x + img->width, y1 = y + img->height;
+	int row;
+
+	if ( f->bpp != FRAME_BPP_4 )
+	{
+		return;
+	}
+
+	if ( x0 < 0 ) x0 = 0;
+	if ( y0 < 0 ) y0 = 0;
+	if ( x1 > f->width ) x1 = f->width;
+	if ( y1 > f->height ) y1 = f->height;
+
+	if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x0, y0, x1, y1 );
+
+	for ( row = y0; row < y1; row++ )
+	{
+		rle_row( &f->data[row * f->h_width], &img->data[img->rows[row - y]],
+			img->width, x, x0, x1 );
+	}
+}
@@ -0,0 +1,329 @@
+#include "scene.h"
+
+/******** scene_before *********
+* Returns 1 if object a is drawn before object b.
+*/
+static int scene_before( const scene_obj_t *a, const scene_obj_t *b )
+{
+	if ( a->layer != b->layer )
+	{
+		return a->layer < b->layer;
+	}
+
+	return a->y < b->y;
+}
+
+/******** scene_insert *********
+* Links an object in after the last node that sorts before or with it.
+*/
+static void scene_insert( scene_obj_t **head, scene_obj_t *o )
+{
+	while ( *head && !scene_before( o, *head ) )
+	{
+		head = &(*head)->next;
+	}
+
+	o->next = *head;
+	*head = o;
+}
+
+/******** scene_wrap *********
+* Returns the scroll offset folded into 0 to size - 1.
+*/
+static int scene_wrap( int offset, int size )
+{
+	offset %= size;
+
+	return ( offset < 0 ) ? offset + size : offset;
+}
+
+/******** scene_init *********
+* Initializes an empty scene with the viewport at the origin.
+*  Inputs: pointer to a scene_t
+* Outputs: none
+*/
+void scene_init( scene_t *sc )
+{
+	sc->backgndCount = 0;
+	sc->objects = NULL;
+	sc->grid = NULL;
+	sc->view_x = 0;
+	sc->view_y = 0;
+}
+
+/******** scene_backgndAdd *********
+* Adds a background layer in front of those added before.
+*  Inputs: pointer to a scene_t, pointer to a sprite_obj_t, tiling
+* Outputs: pointer to the background for scrolling, NULL if full
+*/
+scene_backgnd_t *scene_backgndAdd( scene_t *sc, sprite_obj_t *sprite,
+	enum scene_tiling tiling )
+{
+	scene_backgnd_t *b;
+
+	if ( sc->backgndCount == SCENE_BACKGNDS )
+	{
+		return NULL;
+	}
+
+	b = &sc->backgnd[sc->backgndCount++];
+	b->sprite = sprite;
+	b->x = 0;
+	b->y = 0;
+	b->tiling = tiling;
+
+	return b;
+}
+
+/******** scene_objInit *********
+* Initializes a scene object.
+*  Inputs: pointer to a scene_obj_t, pointer to a sprite_obj_t, x, y, layer
+* Outputs: none
+*/
+void scene_objInit( scene_obj_t *o, sprite_obj_t *sprite, int x, int y,
+	int layer )
+{
+	o->x = x;
+	o->y = y;
+	o->sprite = sprite;
+	o->next = NULL;
+	o->layer = layer;
+	o->flags = 0;
+	o->gx0 = GRID_OUT;
+}
+
+/******** scene_add *********
+* Inserts an object into a scene at its sorted position. It is drawn even
+* when the scene's grid has no room for it, scene_render then walks the
+* whole list until it fits.
+*  Inputs: pointer to a scene_t, pointer to a scene_obj_t
+* Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_add( scene_t *sc, scene_obj_t *o )
+{
+	scene_insert( &sc->objects, o );
+
+	if ( sc->grid )
+	{
+		return grid_insert( sc->grid, o );
+	}
+
+	return 1;
+}
+
+/******** scene_remove *********
+* Takes an object out of a scene.
+*  Inputs: pointer to a scene_t, pointer to a scene_obj_t
+* Outputs: none
+*/
+void scene_remove( scene_t *sc, scene_obj_t *o )
+{
+	scene_obj_t **p = &sc->objects;
+
+	while ( *p && ( *p != o ) )
+	{
+		p = &(*p)->next;
+	}
+
+	if ( *p )
+	{
+		*p = o->next;
+		o->next = NULL;
+
+		if ( sc->grid )
+		{
+			grid_remove( sc->grid, o );
+		}
+	}
+}
+
+/******** scene_objMove *********
+* Moves an object, keeping the scene's grid up to date, see scene_add.
+*  Inputs: pointer to a scene_t, pointer to a scene_obj_t, x, y
+* Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_objMove( scene_t *sc, scene_obj_t *o, int x, int y )
+{
+	o->x = x;
+	o->y = y;
+
+	if ( sc->grid )
+	{
+		return grid_move( sc->grid, o );
+	}
+
+	return 1;
+}
+
+/******** scene_gridAttach *********
+* Indexes the scene's objects in a grid, which then culls them for
+* scene_render and answers collision queries. Objects must be moved with
+* scene_objMove, or grid_move called after changing them.
+*  Inputs: pointer to a scene_t, pointer to a grid_t, NULL to detach
+* Outputs: 1, or 0 if the grid ran out of entries
+*/
+int scene_gridAttach( scene_t *sc, grid_t *g )
+{
+	scene_obj_t *o;
+	int ok = 1;
+
+	for ( o = sc->objects; o; o = o->next )
+	{
+		o->gx0 = GRID_OUT;
+	}
+
+	sc->grid = g;
+	if ( !g )
+	{
+		return 1;
+	}
+
+	grid_init( g );
+	for ( o = sc->objects; o; o = o->next )
+	{
+		ok &= grid_insert( g, o );
+	}
+
+	return ok;
+}
+
+/******** scene_sort *********
+* Restores layer and y order after objects have moved. An insertion sort,
+* linear while the list is nearly sorted, as it is from frame to frame.
+*  Inputs: pointer to a scene_t
+* Outputs: none
+*/
+void scene_sort( scene_t *sc )
+{
+	scene_obj_t *o = sc->objects;
+	scene_obj_t *next;
+
+	if ( !o )
+	{
+		return;
+	}
+
+	/* Walk the list, unlinking only nodes that sort before their
+	*  predecessor and reinserting them from the head. */
+	while ( o->next )
+	{
+		next = o->next;
+
+		if ( scene_before( next, o ) )
+		{
+			o->next = next->next;
+			scene_insert( &sc->objects, next );
+		}
+		else
+		{
+			o = next;
+		}
+	}
+}
+
+/******** scene_backgndRender *********
+* Draws one background, repeating the sprite along its tiled axes.
+*/
+static void scene_backgndRender( scene_backgnd_t *b, frame_buffer_t *f )
+{
+	sprite_obj_t *s = b->sprite;
+	int x0, y0, x, y;
+
+	if ( ( b->tiling == TILE_X ) || ( b->tiling == TILE_XY ) )
+	{
+		x0 = -scene_wrap( b->x, s->width );
+	}
+	else
+	{
+		x0 = -b->x;
+	}
+
+	if ( ( b->tiling == TILE_Y ) || ( b->tiling == TILE_XY ) )
+	{
+		y0 = -scene_wrap( b->y, s->height );
+	}
+	else
+	{
+		y0 = -b->y;
+	}
+
+	for ( y = y0; y < f->height; y += s->height )
+	{
+		for ( x = x0; x < f->width; x += s->width )
+		{
+			sprite_blit( f, s, x, y, 0 );
+
+			if ( ( b->tiling != TILE_X ) && ( b->tiling != TILE_XY ) )
+			{
+				break;
+			}
+		}
+
+		if ( ( b->tiling != TILE_Y ) && ( b->tiling != TILE_XY ) )
+		{
+			break;
+		}
+	}
+}
+
+/******** scene_render *********
+* Draws the backgrounds, then every object overlapping the viewport, into
+* a frame buffer the size of the viewport. Objects outside are skipped
+* before any blitting, with a grid without visiting them unless it has
+* dropped objects.
+*  Inputs: pointer to a scene_t, pointer to a frame_buffer_t
+* Outputs: none
+*/
+void scene_render( scene_t *sc, frame_buffer_t *f )
+{
+	scene_obj_t *vis[SCENE_VISIBLE_MAX];
+	scene_obj_t *o;
+	int j, k, n, x, y;
+
+	for ( j = 0; j < sc->backgndCount; j++ )
+	{
+		scene_backgndRender( &sc->backgnd[j], f );
+	}
+
+	/* A grid missing objects would not find them all. */
+	if ( sc->grid && !sc->grid->dropped )
+	{
+		n = grid_query( sc->grid, sc->view_x, sc->view_y,
+			sc->view_x + f->width, sc->view_y + f->height, vis, SCENE_VISIBLE_MAX );
+
+		if ( n < SCENE_VISIBLE_MAX )
+		{
+			/* Back into drawing order, an insertion sort of the few found. */
+			for ( j = 1; j < n; j++ )
+			{
+				o = vis[j];
+				for ( k = j; ( k > 0 ) && scene_before( o, vis[k - 1] ); k-- )
+				{
+					vis[k] = vis[k - 1];
+				}
+				vis[k] = o;
+			}
+
+			for ( j = 0; j < n; j++ )
+			{
+				sprite_blit( f, vis[j]->sprite, vis[j]->x - sc->view_x,
+					vis[j]->y - sc->view_y, vis[j]->flags );
+			}
+			return;
+		}
+	}
+
+	for ( o = sc->objects; o; o = o->next )
+	{
+		x = o->x - sc->view_x;
+		y = o->y - sc->view_y;
+
+		if ( ( x >= f->width ) || ( y >= f->height ) || 
+			( x + o->sprite->width <= 0 ) || ( y + o->sprite->height <= 0 ) )
+		{
+			continue;
+		}
+
+		sprite_blit( f, o->sprite, x, y, o->flags );
+	}
+}
@@ -13,7 +13,7 @@ int Flag_test;
 /* Instantiate Queue structures */
 
 Queue_t Q_fifo_u8_uart;
-Queue_t Q_fifo_u8_spi;
+Queue_t Q_fifo_u16_spi;
 Queue_t Q_fifo_u16_test;
 
 /* Create counting flags to track queue sizes */
@@ -24,7 +24,7 @@ int Flag_queueSize_spi;
 /* Allocate data stores for queues */
 
 volatile uint8_t fifo_uartTxData[B_SIZE_FIFO_UART];
-volatile uint8_t fifo_spiTxData[B_SIZE_FIFO_SPI];
+volatile uint16_t fifo_spiTxData[B_SIZE_FIFO_SPI];
 volatile uint16_t fifo_testData[B_SIZE_TEST];
 
 /* Assign data stores to queue_data types */
@@ -32,7 +32,7 @@ volatile uint16_t fifo_testData[B_SIZE_TEST];
 struct queue_fifo_u8 fifo_uartTx =
 	{ .data = fifo_uartTxData };
 
-struct queue_fifo_u8 fifo_spiTx =
+struct queue_fifo_u16 fifo_spiTx =
 	{ .data = fifo_spiTxData };
 
 struct queue_fifo_u16 fifo_test =
@@ -44,7 +44,7 @@ struct queue_data fifo_uartTx_data =
     { .format = FIFO_U8T, .is= { .fifo_u8 = &fifo_uartTx } };
 
 struct queue_data fifo_spiTx_data = 
-    { .format = FIFO_U8T, .is= { .fifo_u8 = &fifo_spiTx } };
+    { .format = FIFO_U16T, .is= { .fifo_u16 = &fifo_spiTx } };
 
 struct queue_data fifo_test_data = 
     { .format = FIFO_U16T, .is= { .fifo_u16= &fifo_test } };
@@ -77,9 +77,9 @@ void Sched_init(void) {
 				queue_fifo_u8_put, queue_fifo_u8_get,
 				&Uart_dmaTxHandler );
 
-	Queue_init( &Q_fifo_u8_spi, sizeSpi, &fifo_spiTx_data, 
+	Queue_init( &Q_fifo_u16_spi, sizeSpi, &fifo_spiTx_data, 
 				&Flag_queueSize_spi,
-				queue_fifo_u8_put, queue_fifo_u8_get,
+				queue_fifo_u16_put, queue_fifo_u16_get,
 				&Spi_dmaTxHandler );
 
 	Queue_init( &Q_fifo_u16_test, sizeTest, &fifo_test_data, 
@@ -93,10 +93,8 @@ void Sched_init(void) {
 
 	Sched_addEvent( &Uart_fifoTxEvent, 25, &Q_fifo_u8_uart, 
 				&Flag_DMA_Chan4 );
-	/*
-	Sched_addEvent( &Spi_fifoTxEvent, 1, &Q_fifo_u8_spi, 
+	Sched_addEvent( &Spi_fifoTxEvent, 1, &Q_fifo_u16_spi, 
 				&Flag_DMA_Chan3 );
-	*/
 	Sched_addEvent( &test_event, 10000, &Q_fifo_u16_test, &Flag_test );
 
 }
@@ -138,10 +136,10 @@ void Sched_flagSignal( int *flagPt )
 *  Adds event to event management table
 *   Inputs: pointer to a event function
 *           period in cycles through the event queue
-*           pointer to a fifo type
-*  Outputs: none
+*           pointer to a fifo type, or NULL for a purely periodic event
+*  Outputs: 1 if added, 0 if the table is full
 */
-void Sched_addEvent( 
+int Sched_addEvent( 
 	void(*function)( Queue_t *queue, int *flagPt ),
 	int period_cycles, Queue_t *queue, int *flagPt )
 {
@@ -150,14 +148,16 @@ void Sched_addEvent(
 	{
 		if ( !events[j].eventFunction )
 		{
-			events[j].eventFunction = function;
 			events[j].interval = period_cycles;
 			events[j].last = 0;
 			events[j].queue = queue;
 			events[j].flag = flagPt;
-			break;
+			/* Publish last, the manager may already be running. */
+			events[j].eventFunction = function;
+			return 1;
 		}
 	}
+	return 0;
 }
 
 /********* Sched_runEventManager *******
@@ -174,6 +174,11 @@ void Sched_runEventManager(void)
 	
 	for ( j = 0; j < NUMEVENTS; j++ )
 	{
+		if ( !events[j].eventFunction )
+		{
+			continue;
+		}
+
 		now = Systick_timeGetCount();
 
 		/* Number of program execution cycles since last execution.
@@ -181,10 +186,10 @@ void Sched_runEventManager(void)
 		diff = Systick_timeDelta( events[j].last, now );
 
 		/* if: reception conditions are true (at or past interval delta, 
-		*  task flag > 0, queue size > 0), run event
+		*  task flag > 0, queue size > 0 or no queue), run event
 		*/
 		if ( ( diff >= events[j].interval ) && ( (*events[j].flag) ) 
-				&& ( (*events[j].queue->flagSize) ) )  
+				&& ( !events[j].queue || (*events[j].queue->flagSize) ) )  
 		{
 			events[j].eventFunction( events[j].queue, events[j].flag );
 			events[j].last = now;
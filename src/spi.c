@@ -1,8 +1,17 @@
 #include "spi.h"
 
+/* Completion callback of the streamed transfer in flight, if any. */
+static void (*spi_streamDone)(void);
+
+/* Set while a completion callback runs, lets it chain ahead of the queue. */
+static int spi_chaining;
+
+/* Last level written to the D/C pin by the 4-wire transport. */
+static int spi_dcLevel = -1;
+
 /********* Spi_init *******
 *  Initializes the SPI peripheral for simplex serial transmission.
-*  8 bits per word
+*  9 or 8 bits per word depending on the display transport.
 *   Inputs: none
 *  Outputs: none
 */
@@ -17,7 +26,7 @@ void Spi_init(void)
 		SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE, SPI_CR1_CPHA_CLK_TRANSITION_1, 
 		SPI_CR1_MSBFIRST );
 
-	spi_set_data_size( SPI1, SPI_CR2_DS_9BIT );
+	spi_set_data_size( SPI1, SPI_DATA_SIZE );
 
 	//spi_set_baudrate_prescaler( SPI1, SPI_CR1_BR_FPCLK_DIV_64 );
 
@@ -40,16 +49,26 @@ void Spi_init(void)
 */
 void Spi_fifoTxEvent( Queue_t *queue, int *flagPt )
 {
-	int buf[1], len;
+	/* DMA reads the frame after we return, keep it off the stack. */
+	static spi_frame_t buf[1];
+	uint16_t word[1];
+	int len;
 
 	// attempt to read an element from the queue.
-	if ( ( len = Queue_get( queue, &buf, 1 ) ) )
+	if ( ( len = Queue_get( queue, &word, 1 ) ) )
 	{
 		// Wait until transaction is complete
 		Sched_flagWait(flagPt);
-		
+
+#ifdef OLED_SPI_4WIRE
+		// D/C travels in bit 8 of the queued word, drive the pin instead
+		Spi_dcSelect( word[0] & SPI_DC_DATA );
+		dma_set_memory_size( DMA1, DMA_CHANNEL3, DMA_CCR_MSIZE_8BIT );
+#endif
+		buf[0] = (spi_frame_t) word[0];
+
 		// Send data to the queue transfer handler function
-		queue->handler_function( &buf, len );
+		queue->handler_function( buf, len );
 
 		gpio_toggle(GPIOC, GPIO0);
 
@@ -80,6 +99,120 @@ void Spi_dmaTxHandler( volatile void* data, int length )
 	
 }
 
+/********* spi_streamStart *******
+*  Claims the SPI DMA channel and starts a transfer outside of the queue.
+*  The 4-wire transport reads 9-bit words with a 16-bit memory size, the
+*  peripheral side keeps the low byte.
+*/
+static int spi_streamStart( volatile void* data, int length, int dc, 
+	int words, void(*done)(void) )
+{
+	cm_disable_interrupts();
+
+	if ( ( Flag_DMA_Chan3 <= 0 ) || 
+		( !spi_chaining && ( *Q_fifo_u16_spi.flagSize ) ) )
+	{
+		cm_enable_interrupts();
+		return 0;
+	}
+
+	Sched_flagWait( &Flag_DMA_Chan3 );
+	spi_streamDone = done;
+
+#ifdef OLED_SPI_4WIRE
+	Spi_dcSelect(dc);
+	dma_set_memory_size( DMA1, DMA_CHANNEL3, 
+		words ? DMA_CCR_MSIZE_16BIT : DMA_CCR_MSIZE_8BIT );
+#else
+	(void) dc;
+	(void) words;
+#endif
+
+	Spi_dmaTxHandler( data, length );
+
+	cm_enable_interrupts();
+
+	return 1;
+}
+
+/********* Spi_dmaTxStream *******
+*  Starts a DMA transfer that bypasses the SPI queue. The transfer only
+*  starts once the queue has drained and the channel is free, so it stays
+*  ordered behind queued commands. The callback runs from the SPI ISR once
+*  the last frame has left the shift register and may chain the next one;
+*  a chained transfer goes ahead of anything queued in the meantime.
+*   Inputs: pointer to a contiguous block of spi_frame_t, number of frames,
+*           D/C level for the 4-wire transport (ignored on 3-wire),
+*           completion callback or NULL
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+int Spi_dmaTxStream( volatile void* data, int length, int dc, 
+	void(*done)(void) )
+{
+	return spi_streamStart( data, length, dc, 0, done );
+}
+
+/********* Spi_dmaTxWords *******
+*  Streams 9-bit words (D/C in bit 8) outside of the SPI queue, by
+*  reference. The 4-wire transport takes D/C from the first word, so a call
+*  must not mix commands and data there.
+*   Inputs: pointer to 9-bit words, number of words, completion callback
+*  Outputs: 1 if the transfer started, 0 if the SPI is busy
+*/
+int Spi_dmaTxWords( const volatile uint16_t* words, int length, 
+	void(*done)(void) )
+{
+	return spi_streamStart( (volatile void *) words, length, 
+		words[0] & SPI_DC_DATA, 1, done );
+}
+
+/********* Spi_dmaTxComplete *******
+*  Runs the completion callback of a streamed transfer. Called from the SPI
+*  ISR after the channel flag has been signalled.
+*   Inputs: none
+*  Outputs: none
+*/
+void Spi_dmaTxComplete(void)
+{
+	void (*done)(void) = spi_streamDone;
+
+	spi_streamDone = NULL;
+
+	if ( done )
+	{
+		spi_chaining = 1;
+		done();
+		spi_chaining = 0;
+	}
+}
+
+/********* Spi_dcSelect *******
+*  Drives the D/C line of the 4-wire transport. Only call while the SPI is
+*  idle; the pin is written only when the level changes.
+*   Inputs: 0 for command, non-zero for data
+*  Outputs: none
+*/
+void Spi_dcSelect( int dc )
+{
+	dc = ( dc != 0 );
+
+	if ( dc == spi_dcLevel )
+	{
+		return;
+	}
+
+	if ( dc )
+	{
+		gpio_set( PORT_OLED, DC );
+	}
+	else
+	{
+		gpio_clear( PORT_OLED, DC );
+	}
+
+	spi_dcLevel = dc;
+}
+
 /********* Spi_send *******
 *  Adds arbitrary number of elements to the UART transmission buffer.
 *   Inputs: pointer to a contiguous block of data, number of elements to copy
@@ -87,7 +220,7 @@ void Spi_dmaTxHandler( volatile void* data, int length )
 */
 void Spi_send( volatile void* data, int length )
 {
-	Queue_put( &Q_fifo_u8_spi, data, length );
+	Queue_put( &Q_fifo_u16_spi, data, length );
 
 }
 
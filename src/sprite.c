@@ -0,0 +1,312 @@
+#include "sprite.h"
+
+/******** sprite_init *********
+* Initializes a sprite_obj_t over a packed 4bpp bitmap.
+*  Inputs: pointer to a sprite_obj_t, width in pixels, height in pixels,
+*  pointer to the bitmap, length of bitmap in bytes, transparent grey level
+*  or SPRITE_NO_KEY
+* Outputs: none
+*/
+void sprite_init( sprite_obj_t *s, int width, int height,
+	const uint8_t *data, int length, int key )
+{
+	s->width = width;
+	s->height = height;
+	s->bmp_data = data;
+	s->length = length;
+	s->key = key;
+}
+
+/******** sprite_pixel *********
+* Returns pixel x of a bitmap row.
+*/
+static inline uint8_t sprite_pixel( const uint8_t *row, int x )
+{
+	return ( row[x >> 1] >> ( ( x & 1 ) << 2 ) ) & 0x0F;
+}
+
+/******** sprite_pair *********
+* Returns source pixel sx and the next one in the blit direction packed as
+* a destination byte, sx in the low nibble. Odd starts and flips are
+* realigned with nibble shifts.
+*/
+static inline uint8_t sprite_pair( const uint8_t *row, int sx, int step )
+{
+	const uint8_t *p = &row[sx >> 1];
+
+	if ( step > 0 )
+	{
+		return ( sx & 1 ) ? ( ( p[0] >> 4 ) | ( p[1] << 4 ) ) : p[0];
+	}
+
+	return ( sx & 1 ) ? ( ( p[0] >> 4 ) | ( p[0] << 4 ) ) : ( ( p[0] & 0x0F ) | ( p[-1] & 0xF0 ) );
+}
+
+/******** sprite_span *********
+* Draws destination pixels x0 to x1 (exclusive) of a frame row from packed
+* 4bpp source pixels, starting at source pixel sx and stepping by step
+* (1 or -1). Pixels equal to key are skipped. No clipping or damage
+* tracking.
+*  Inputs: frame row, source row, x0, x1, sx, step, grey level key or
+*  SPRITE_NO_KEY
+* Outputs: none
+*/
+void sprite_span( volatile uint8_t *d, const uint8_t *src, int x0,
+	int x1, int sx, int step, int key )
+{
+	uint32_t kp = ( key & 0x0F ) * 0x11111111u;
+	uint32_t sw, mw;
+	const uint8_t *s;
+	uint8_t p, m;
+	int n;
+
+	/* Odd x is the high nibble, a run ending on an even pixel ends low. */
+	if ( x0 & 1 )
+	{
+		p = sprite_pixel( src, sx );
+		if ( p != key ) d[x0 >> 1] = ( d[x0 >> 1] & 0x0F ) | ( p << 4 );
+		x0++;
+		sx += step;
+	}
+	if ( ( x1 & 1 ) && ( x1 > x0 ) )
+	{
+		p = sprite_pixel( src, sx + ( x1 - 1 - x0 ) * step );
+		if ( p != key ) d[x1 >> 1] = ( d[x1 >> 1] & 0xF0 ) | p;
+		x1--;
+	}
+
+	d += x0 >> 1;
+	n = ( x1 - x0 ) >> 1;
+
+	if ( ( step < 0 ) || ( sx & 1 ) )
+	{
+		for ( ; n > 0; n--, d++, sx += step << 1 )
+		{
+			p = sprite_pair( src, sx, step );
+			if ( key == SPRITE_NO_KEY )
+			{
+				*d = p;
+			}
+			else
+			{
+				m = (uint8_t) frame_opaque( p ^ kp );
+				*d = ( *d & ~m ) | ( p & m );
+			}
+		}
+		return;
+	}
+
+	/* Nibbles line up, whole source bytes go straight across. */
+	s = &src[sx >> 1];
+
+	if ( ( ( (uintptr_t) d ^ (uintptr_t) s ) & 3 ) == 0 )
+	{
+		for ( ; ( n > 0 ) && ( (uintptr_t) d & 3 ); n--, d++, s++ )
+		{
+			m = ( key == SPRITE_NO_KEY ) ? 0xFF : (uint8_t) frame_opaque( *s ^ kp );
+			*d = ( *d & ~m ) | ( *s & m );
+		}
+
+		for ( ; n >= 4; n -= 4, d += 4, s += 4 )
+		{
+			sw = *(const uint32_t *) s;
+			mw = ( key == SPRITE_NO_KEY ) ? 0xFFFFFFFFu : frame_opaque( sw ^ kp );
+
+			if ( mw == 0xFFFFFFFFu )
+			{
+				*(volatile uint32_t *) d = sw;
+			}
+			else if ( mw )
+			{
+				*(volatile uint32_t *) d = ( *(volatile uint32_t *) d & ~mw ) | ( sw & mw );
+			}
+		}
+	}
+
+	for ( ; n > 0; n--, d++, s++ )
+	{
+		m = ( key == SPRITE_NO_KEY ) ? 0xFF : (uint8_t) frame_opaque( *s ^ kp );
+		*d = ( *d & ~m ) | ( *s & m );
+	}
+}
+
+/******** sprite_blit *********
+* Draws a sprite into a frame buffer with its top left corner at x, y,
+* clipped to the buffer. Pixels matching the key are left untouched.
+* Unflipped rows whose source and destination nibbles line up are copied
+* a word at a time, others two pixels per byte with the source realigned
+* by a nibble shift. 4bpp frames only, others are left untouched.
+*  Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, x, y,
+*  SPRITE_FLIP_H and/or SPRITE_FLIP_V, or 0
+* Outputs: none
+*/
+void sprite_blit( frame_buffer_t *f, const sprite_obj_t *s, int x, int y,
+	int flags )
+{
+	int x0 = x, y0 = y, x1 = x + s->width, y1 = y + s->height;
+	int stride = SPRITE_STRIDE( s->width );
+	int row, sx, sy, step;
+
+	if ( f->bpp != FRAME_BPP_4 )
+	{
+		return;
+	}
+
+	if ( x0 < 0 ) x0 = 0;
+	if ( y0 < 0 ) y0 = 0;
+	if ( x1 > f->width ) x1 = f->width;
+	if ( y1 > f->height ) y1 = f->height;
+
+	if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x0, y0, x1, y1 );
+
+	if ( flags & SPRITE_FLIP_H )
+	{
+		step = -1;
+		sx = s->width - 1 - ( x0 - x );
+	}
+	else
+	{
+		step = 1;
+		sx = x0 - x;
+	}
+
+	for ( row = y0; row < y1; row++ )
+	{
+		sy = ( flags & SPRITE_FLIP_V ) ? ( s->height - 1 - ( row - y ) ) : ( row - y );
+
+		sprite_span( &f->data[row * f->h_width], &s->bmp_data[sy * stride],
+			x0, x1, sx, step, s->key );
+	}
+}
+
+/******** sprite_blitAffine *********
+* Draws a sprite through an affine transform from sprite to frame
+* coordinates, nearest neighbour, clipped to the buffer. Each destination
+* row inside the transformed bounding box is walked with the source
+* position stepped by the inverse transform, no per pixel multiplies.
+* Pixels matching the key are left untouched. 4bpp frames only.
+*  Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, pointer
+*  to the transform
+* Outputs: none
+*/
+void sprite_blitAffine( frame_buffer_t *f, const sprite_obj_t *s,
+	const fixed_affine_t *m )
+{
+	fixed_affine_t inv;
+	q16_t cx[4], cy[4], min_x, max_x, min_y, max_y, u, v, ru, rv;
+	uint32_t wq = (uint32_t) s->width << 16;
+	uint32_t hq = (uint32_t) s->height << 16;
+	int stride = SPRITE_STRIDE( s->width );
+	int x0, y0, x1, y1, x, row, j;
+	volatile uint8_t *d;
+	uint8_t p;
+
+	if ( ( f->bpp != FRAME_BPP_4 ) || !fixed_affineInvert( &inv, m ) )
+	{
+		return;
+	}
+
+	/* Destination bounding box of the sprite's corners. */
+	fixed_affineApply( m, 0, 0, &cx[0], &cy[0] );
+	fixed_affineApply( m, wq, 0, &cx[1], &cy[1] );
+	fixed_affineApply( m, 0, hq, &cx[2], &cy[2] );
+	fixed_affineApply( m, wq, hq, &cx[3], &cy[3] );
+
+	min_x = max_x = cx[0];
+	min_y = max_y = cy[0];
+	for ( j = 1; j < 4; j++ )
+	{
+		if ( cx[j] < min_x ) min_x = cx[j];
+		if ( cx[j] > max_x ) max_x = cx[j];
+		if ( cy[j] < min_y ) min_y = cy[j];
+		if ( cy[j] > max_y ) max_y = cy[j];
+	}
+
+	x0 = min_x >> 16;
+	y0 = min_y >> 16;
+	x1 = ( max_x + 0xFFFF ) >> 16;
+	y1 = ( max_y + 0xFFFF ) >> 16;
+
+	if ( x0 < 0 ) x0 = 0;
+	if ( y0 < 0 ) y0 = 0;
+	if ( x1 > f->width ) x1 = f->width;
+	if ( y1 > f->height ) y1 = f->height;
+
+	if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x0, y0, x1, y1 );
+
+	/* Source position of the centre of the box's top left pixel. */
+	fixed_affineApply( &inv, ( x0 << 16 ) + Q16_HALF, ( y0 << 16 ) + Q16_HALF,
+		&ru, &rv );
+
+	for ( row = y0; row < y1; row++, ru += inv.b, rv += inv.d )
+	{
+		u = ru;
+		v = rv;
+		x = x0;
+
+		/* The sprite covers one run of each row, skip up to it. Negative
+		*  positions wrap to large unsigned ones, one compare per axis. */
+		while ( ( x < x1 ) && ( ( (uint32_t) u >= wq ) || ( (uint32_t) v >= hq ) ) )
+		{
+			u += inv.a;
+			v += inv.c;
+			x++;
+		}
+
+		d = &f->data[row * f->h_width];
+
+		for ( ; ( x < x1 ) && ( (uint32_t) u < wq ) && ( (uint32_t) v < hq );
+			x++, u += inv.a, v += inv.c )
+		{
+			p = sprite_pixel( &s->bmp_data[( v >> 16 ) * stride], u >> 16 );
+
+			if ( p == s->key )
+			{
+				continue;
+			}
+
+			if ( x & 1 )
+			{
+				d[x >> 1] = ( d[x >> 1] & 0x0F ) | ( p << 4 );
+			}
+			else
+			{
+				d[x >> 1] = ( d[x >> 1] & 0xF0 ) | p;
+			}
+		}
+	}
+}
+
+/******** sprite_blitRotated *********
+* Draws a sprite rotated and scaled about its centre, see
+* sprite_blitAffine.
+*  Inputs: pointer to a frame_buffer_t, pointer to a sprite_obj_t, centre
+*  x, y in the frame, angle (0x10000 per turn), Q16.16 scale
+* Outputs: none
+*/
+void sprite_blitRotated( frame_buffer_t *f, const sprite_obj_t *s, int x,
+	int y, fixed_angle_t angle, q16_t scale )
+{
+	fixed_affine_t m;
+	q16_t hx, hy;
+
+	fixed_affineRotScale( &m, angle, scale, 0, 0 );
+
+	/* Move the sprite's centre onto x, y. */
+	fixed_affineApply( &m, (q16_t) s->width << 15, (q16_t) s->height << 15,
+		&hx, &hy );
+	m.tx = Q16_INT( x ) - hx;
+	m.ty = Q16_INT( y ) - hy;
+
+	sprite_blitAffine( f, s, &m );
+}
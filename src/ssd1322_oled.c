@@ -23,49 +23,1026 @@ void Oled_sendCmd( uint8_t cmd )
 */
 void Oled_sendData( uint8_t data )
 {
-	uint16_t data_bit = data & 0x100;
 	uint16_t data_out[] =
 	{
-		data_bit
+		OLED_DATA | data
 	};
 
 	Spi_send( &data_out, 1 );
 }
 
+/* State of the command sequence and pixel stream in flight. */
+struct oled_stream
+{
+	const volatile uint16_t *seq; /* next 9-bit command word              */
+	int seq_len;                  /* command words left                   */
+	void (*seq_then)(void);       /* runs once the sequence is out        */
+	const volatile uint8_t *src;  /* first byte of the current row        */
+	int row_bytes;                /* bytes per row                        */
+	int stride;                   /* bytes between rows in the source     */
+	int rows;                     /* rows left, current one included      */
+	int col;                      /* bytes of the current row consumed    */
+	const uint16_t *lut;          /* 1/2bpp expansion, NULL at 4bpp       */
+	int nib;                      /* source nibble the rows start at      */
+	int nib_shift;                /* 1 at 1bpp: two bytes out per nibble  */
+	int ready[2];                 /* words staged in each ping-pong half  */
+	int send;                     /* half that goes out next              */
+	int busy;
+	int failed;                   /* a chained transfer could not start   */
+	void (*done)(void);
+};
+
+static struct oled_stream oled_stream;
+
+/* Address window and write command, rebuilt per rectangle. */
+static oled_cmdbuf_t oled_windowCmds;
+
+/* Flash-resident command lists, DMA'd by reference. */
+static const uint16_t oled_initSeq[] = 
+{
+	OLED_LOCK_STATUS, 0x112,
+	OLED_DISP_OFF,
+	OLED_CLOCK_DIV, 0x191,
+	OLED_MUX_RATIO, 0x13F,
+	//OLED_COL_START_END, 0x11C, 0x15B,
+	//OLED_ROW_START_END, 0x100, 0x13F,
+	OLED_SET_REMAP, 0x114, 0x111,
+
+	OLED_SET_VDD, 0x101,
+	//OLED_MAGIC_1, 0x1A0, 0x1FD,
+	OLED_CONTRAST_CURRENT, 0x1FF,
+	OLED_MASTER_CONTRAST, 0x10F,
+	//OLED_DEFAULT_GRAYTABLE,
+	//OLED_EN_GRAY,
+	//OLED_MAGIC_2, 0x182, 0x120,
+	OLED_SET_PRECHARGE_1, 0x11F,
+	OLED_SET_PRECHARGE_2, 0x108,
+	OLED_SET_VCOMH, 0x107,
+	OLED_START_LINE, 0x100,
+	OLED_NORMAL
+};
+
+static const uint16_t oled_onSeq[] = { OLED_DISP_ON };
+static const uint16_t oled_offSeq[] = { OLED_DISP_OFF };
+static const uint16_t oled_invertSeq[] = { OLED_INVERSE };
+static const uint16_t oled_normalSeq[] = { OLED_NORMAL };
+
+#define OLED_SEQ_LEN(seq) ( (int) ( sizeof(seq) / sizeof(uint16_t) ) )
+
+/* Frame buffer being flushed and a snapshot of its damaged regions. */
+static frame_buffer_t *oled_flushFrame;
+static frame_rect_t oled_flushRects[FRAME_DIRTY_MAX];
+static int oled_flushCount;
+static int oled_flushBase;                /* first display RAM row written */
+static void (*oled_flushThen)(void);      /* completion callback or NULL   */
+
+/* Page flipping: visible page and the previous flush's own damage. */
+static int oled_flipping;
+static int oled_page;
+static frame_rect_t oled_prevRects[FRAME_DIRTY_MAX];
+static int oled_prevCount;
+static oled_cmdbuf_t oled_flipCmds;
+
+/* Damage detection: CRC of each row as last scanned, of the frame the
+*  display will show once the flushes started so far are out. */
+static int oled_detect;
+static int oled_sigValid;
+static uint32_t oled_rowSig[OLED_HEIGHT];
+
+/* A flush failed part way, the next one sends the whole frame. */
+static int oled_resend;
+
+/* Flash-resident rows for clearing and testing the panel. */
+static const uint8_t oled_blankRow[OLED_WIDTH / 2] = { 0 };
+
+#define OLED_TEST_8 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0
+#define OLED_TEST_32 OLED_TEST_8, OLED_TEST_8, OLED_TEST_8, OLED_TEST_8
+static const uint8_t oled_testRow[OLED_WIDTH / 2] =
+{
+	OLED_TEST_32, OLED_TEST_32, OLED_TEST_32, OLED_TEST_32
+};
+
+/* SPI frames as the transport sends them, see spi_frame_t. */
+#ifdef OLED_SPI_4WIRE
+typedef uint8_t oled_frame_t;
+#define OLED_FRAME_DC 0
+#else
+typedef uint16_t oled_frame_t;
+#define OLED_FRAME_DC OLED_DATA
+#endif
+
+/* Ping-pong halves for expanded pixel words, word aligned for the kernel.
+*  The 4-wire transport only needs them for 1 and 2bpp frames. */
+static oled_frame_t oled_chunk[2][OLED_CHUNK] __attribute__((aligned(4)));
+
+static void oled_seqNext(void);
+static void oled_flushNext(void);
+static int oled_rectFrom( int x, int y, int width, int height, 
+	const volatile uint8_t *src, int stride, const uint16_t *lut, int nib,
+	int nib_shift, void(*done)(void) );
+
+/******** Oled_expandData *********
+* Expands packed 4bpp pixel bytes into 9-bit data words (OLED_DATA | byte).
+* Reads the source a word at a time, four bytes per step.
+*  Inputs: 16-bit aligned destination, source bytes, number of bytes
+* Outputs: none
+*/
+void Oled_expandData( uint16_t *dst, const volatile uint8_t *src, int length )
+{
+	const uint32_t *s;
+	uint32_t *d;
+	uint32_t w;
+
+	/* Bytes up to the first aligned source word. */
+	while ( ( (uint32_t) src & 3 ) && ( length > 0 ) )
+	{
+		*dst++ = OLED_DATA | *src++;
+		length--;
+	}
+
+	s = (const uint32_t *) src;
+
+	if ( (uint32_t) dst & 2 )
+	{
+		/* Destination off by one word, store halfwords. */
+		for ( ; length >= 4; length -= 4 )
+		{
+			w = *s++;
+			dst[0] = OLED_DATA | ( w & 0xFF );
+			dst[1] = OLED_DATA | ( ( w >> 8 ) & 0xFF );
+			dst[2] = OLED_DATA | ( ( w >> 16 ) & 0xFF );
+			dst[3] = OLED_DATA | ( w >> 24 );
+			dst += 4;
+		}
+	}
+	else
+	{
+		/* Little endian: byte n lands in halfword n of the output pair. */
+		d = (uint32_t *) dst;
+
+		for ( ; length >= 8; length -= 8 )
+		{
+			w = s[0];
+			d[0] = ( w & 0xFF ) | ( ( w & 0xFF00 ) << 8 ) | 0x01000100;
+			d[1] = ( ( w >> 16 ) & 0xFF ) | ( ( w >> 8 ) & 0xFF0000 ) | 0x01000100;
+			w = s[1];
+			d[2] = ( w & 0xFF ) | ( ( w & 0xFF00 ) << 8 ) | 0x01000100;
+			d[3] = ( ( w >> 16 ) & 0xFF ) | ( ( w >> 8 ) & 0xFF0000 ) | 0x01000100;
+			s += 2;
+			d += 4;
+		}
+
+		for ( ; length >= 4; length -= 4 )
+		{
+			w = *s++;
+			d[0] = ( w & 0xFF ) | ( ( w & 0xFF00 ) << 8 ) | 0x01000100;
+			d[1] = ( ( w >> 16 ) & 0xFF ) | ( ( w >> 8 ) & 0xFF0000 ) | 0x01000100;
+			d += 2;
+		}
+
+		dst = (uint16_t *) d;
+	}
+
+	src = (const volatile uint8_t *) s;
+
+	while ( length-- > 0 )
+	{
+		*dst++ = OLED_DATA | *src++;
+	}
+}
+
+/******** oled_streamFinish *********
+* Marks the stream idle and hands over to the caller's callback, which may
+* chain the next transfer.
+*/
+static void oled_streamFinish(void)
+{
+	void (*done)(void) = oled_stream.done;
+
+	oled_stream.busy = 0;
+
+	if ( done )
+	{
+		done();
+	}
+}
+
+/******** oled_streamFail *********
+* A transfer chained from a completion callback found the SPI taken. Ends
+* the stream marked failed rather than leaving it busy for good.
+*/
+static void oled_streamFail(void)
+{
+	oled_stream.failed = 1;
+	oled_streamFinish();
+}
+
+/******** oled_expandLut *********
+* Expands length output bytes of 1 or 2bpp pixels, starting at source
+* nibble nib, through the stream's table. Each source nibble is two pixels
+* (one byte out) at 2bpp and four (two bytes out) at 1bpp.
+*/
+static void oled_expandLut( oled_frame_t *dst, const volatile uint8_t *src,
+	int nib, int length )
+{
+	const uint16_t *lut = oled_stream.lut;
+	int n = length >> oled_stream.nib_shift;
+	uint16_t e;
+	uint8_t b;
+
+	src += nib >> 1;
+
+	if ( oled_stream.nib_shift )
+	{
+		if ( ( nib & 1 ) && ( n > 0 ) )
+		{
+			e = lut[*src++ >> 4];
+			dst[0] = OLED_FRAME_DC | ( e & 0xFF );
+			dst[1] = OLED_FRAME_DC | ( e >> 8 );
+			dst += 2;
+			n--;
+		}
+		for ( ; n >= 2; n -= 2, dst += 4 )
+		{
+			b = *src++;
+			e = lut[b & 0x0F];
+			dst[0] = OLED_FRAME_DC | ( e & 0xFF );
+			dst[1] = OLED_FRAME_DC | ( e >> 8 );
+			e = lut[b >> 4];
+			dst[2] = OLED_FRAME_DC | ( e & 0xFF );
+			dst[3] = OLED_FRAME_DC | ( e >> 8 );
+		}
+		if ( n )
+		{
+			e = lut[*src & 0x0F];
+			dst[0] = OLED_FRAME_DC | ( e & 0xFF );
+			dst[1] = OLED_FRAME_DC | ( e >> 8 );
+		}
+		return;
+	}
+
+	if ( ( nib & 1 ) && ( n > 0 ) )
+	{
+		*dst++ = OLED_FRAME_DC | lut[*src++ >> 4];
+		n--;
+	}
+	for ( ; n >= 2; n -= 2, dst += 2 )
+	{
+		b = *src++;
+		dst[0] = OLED_FRAME_DC | lut[b & 0x0F];
+		dst[1] = OLED_FRAME_DC | lut[b >> 4];
+	}
+	if ( n )
+	{
+		*dst = OLED_FRAME_DC | lut[*src & 0x0F];
+	}
+}
+
+#ifdef OLED_SPI_4WIRE
+/******** oled_streamNext *********
+* SPI completion callback, DMAs the next source row or finishes.
+*/
+static void oled_streamNext(void)
+{
+	if ( --oled_stream.rows > 0 )
+	{
+		oled_stream.src += oled_stream.stride;
+		if ( !Spi_dmaTxStream( (volatile void *) oled_stream.src, 
+			oled_stream.row_bytes, 1, oled_streamNext ) )
+		{
+			oled_streamFail();
+		}
+	}
+	else
+	{
+		oled_streamFinish();
+	}
+}
+#endif
+
+/******** oled_streamFill *********
+* Expands up to OLED_CHUNK output bytes into one ping-pong half. Rows are
+* back to back on the wire, so a chunk may span a row boundary.
+*/
+static void oled_streamFill( int half )
+{
+	int n = 0, k;
+
+	while ( ( n < OLED_CHUNK ) && ( oled_stream.rows > 0 ) )
+	{
+		k = oled_stream.row_bytes - oled_stream.col;
+
+		if ( k > ( OLED_CHUNK - n ) )
+		{
+			k = OLED_CHUNK - n;
+		}
+
+		if ( oled_stream.lut )
+		{
+			oled_expandLut( &oled_chunk[half][n], oled_stream.src,
+				oled_stream.nib + ( oled_stream.col >> oled_stream.nib_shift ), k );
+		}
+#ifndef OLED_SPI_4WIRE
+		else
+		{
+			Oled_expandData( &oled_chunk[half][n], 
+				oled_stream.src + oled_stream.col, k );
+		}
+#endif
+
+		n += k;
+		oled_stream.col += k;
+
+		if ( oled_stream.col == oled_stream.row_bytes )
+		{
+			oled_stream.col = 0;
+			oled_stream.src += oled_stream.stride;
+			oled_stream.rows--;
+		}
+	}
+
+	oled_stream.ready[half] = n;
+}
+
+/******** oled_chunkNext *********
+* SPI completion callback. Sends the staged half, then refills the half that
+* just went out while the DMA runs.
+*/
+static void oled_chunkNext(void)
+{
+	int half = oled_stream.send;
+
+	if ( oled_stream.ready[half] )
+	{
+		if ( !Spi_dmaTxStream( oled_chunk[half], oled_stream.ready[half], 1,
+			oled_chunkNext ) )
+		{
+			oled_streamFail();
+			return;
+		}
+		oled_stream.send = half ^ 1;
+		oled_streamFill( half ^ 1 );
+	}
+	else
+	{
+		oled_streamFinish();
+	}
+}
+
+/******** oled_streamBegin *********
+* Sends the first pixel transfer of the rows set up in oled_stream.
+*/
+static int oled_streamBegin(void)
+{
+#ifdef OLED_SPI_4WIRE
+	/* 4bpp rows are already in wire format. */
+	if ( !oled_stream.lut )
+	{
+		/* Contiguous rows go out as a single transfer. */
+		if ( oled_stream.row_bytes == oled_stream.stride )
+		{
+			oled_stream.row_bytes *= oled_stream.rows;
+			oled_stream.rows = 1;
+		}
+
+		return Spi_dmaTxStream( (volatile void *) oled_stream.src, 
+			oled_stream.row_bytes, 1, oled_streamNext );
+	}
+#endif
+	oled_stream.col = 0;
+
+	/* Stage both halves up front, the ISR keeps them topped up after. */
+	oled_streamFill(0);
+	oled_streamFill(1);
+	oled_stream.send = 1;
+
+	return Spi_dmaTxStream( oled_chunk[0], oled_stream.ready[0], 1, 
+		oled_chunkNext );
+}
+
+/******** oled_seqSend *********
+* Sends the next part of the command sequence set up in oled_stream, or
+* runs seq_then once it is out. The 4-wire transport sends one D/C run per
+* transfer, 3-wire sends the whole sequence at once.
+*/
+static int oled_seqSend(void)
+{
+	const volatile uint16_t *seq = oled_stream.seq;
+	int n = oled_stream.seq_len;
+
+	if ( n == 0 )
+	{
+		oled_stream.seq_then();
+		return 1;
+	}
+
+#ifdef OLED_SPI_4WIRE
+	for ( n = 1; n < oled_stream.seq_len; n++ )
+	{
+		if ( ( seq[n] ^ seq[0] ) & OLED_DATA )
+		{
+			break;
+		}
+	}
+#endif
+
+	if ( !Spi_dmaTxWords( seq, n, oled_seqNext ) )
+	{
+		return 0;
+	}
+
+	oled_stream.seq += n;
+	oled_stream.seq_len -= n;
+
+	return 1;
+}
+
+/******** oled_seqNext *********
+* SPI completion callback for command sequences.
+*/
+static void oled_seqNext(void)
+{
+	if ( !oled_seqSend() )
+	{
+		oled_streamFail();
+	}
+}
+
+/******** oled_rectData *********
+* Follows the window commands with the pixel rows.
+*/
+static void oled_rectData(void)
+{
+	if ( !oled_streamBegin() )
+	{
+		oled_streamFail();
+	}
+}
+
+/******** Oled_sendSeq *********
+* Sends a list of 9-bit command words (OLED_DATA set on parameters) by
+* reference, bypassing the SPI queue. The list must stay valid until the
+* callback runs, flash-resident const lists always do.
+*  Inputs: pointer to the command words, number of words, completion callback
+* Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_sendSeq( const volatile uint16_t *seq, int length, 
+	void(*done)(void) )
+{
+	if ( oled_stream.busy || ( length <= 0 ) )
+	{
+		return 0;
+	}
+
+	oled_stream.busy = 1;
+	oled_stream.failed = 0;
+	oled_stream.done = done;
+	oled_stream.seq = seq;
+	oled_stream.seq_len = length;
+	oled_stream.seq_then = oled_streamFinish;
+
+	if ( !oled_seqSend() )
+	{
+		oled_stream.busy = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+/******** oled_cmdList *********
+* Sends a fire-and-forget command list by reference. When the link is busy
+* a copy goes through the SPI queue instead, which drains after the transfer
+* in flight and before any later stream, so ordering is kept.
+*/
+static void oled_cmdList( const uint16_t *seq, int length )
+{
+	if ( !Oled_sendSeq( seq, length, NULL ) )
+	{
+		Spi_send( (volatile void *) seq, length );
+	}
+}
+
+/******** Oled_cmdReset *********
+* Empties a RAM command buffer.
+*  Inputs: pointer to an oled_cmdbuf_t
+* Outputs: none
+*/
+void Oled_cmdReset( oled_cmdbuf_t *b )
+{
+	b->length = 0;
+}
+
+/******** Oled_cmdAdd *********
+* Appends a command byte to a RAM command buffer.
+*  Inputs: pointer to an oled_cmdbuf_t, command byte
+* Outputs: none
+*/
+void Oled_cmdAdd( oled_cmdbuf_t *b, uint8_t cmd )
+{
+	if ( b->length < OLED_CMDBUF_SIZE )
+	{
+		b->words[b->length++] = cmd;
+	}
+}
+
+/******** Oled_cmdParam *********
+* Appends a parameter byte to a RAM command buffer.
+*  Inputs: pointer to an oled_cmdbuf_t, parameter byte
+* Outputs: none
+*/
+void Oled_cmdParam( oled_cmdbuf_t *b, uint8_t value )
+{
+	if ( b->length < OLED_CMDBUF_SIZE )
+	{
+		b->words[b->length++] = OLED_DATA | value;
+	}
+}
+
+/******** Oled_cmdSend *********
+* Sends the contents of a RAM command buffer by reference. The buffer must
+* not be modified until the callback runs.
+*  Inputs: pointer to an oled_cmdbuf_t, completion callback or NULL
+* Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_cmdSend( oled_cmdbuf_t *b, void(*done)(void) )
+{
+	return Oled_sendSeq( b->words, b->length, done );
+}
+
+/******** Oled_writeWindow *********
+* Streams rows of packed 4bpp pixel bytes into display RAM at the current
+* write pointer. 3-wire: rows are expanded in OLED_CHUNK byte pieces into a
+* ping-pong pair, one half is DMA'd while the other is refilled.
+* 4-wire: rows are DMA'd straight from the source.
+*  Inputs: pointer to the first byte, bytes per row, number of rows,
+*          bytes between rows in the source, completion callback or NULL
+* Outputs: 1 if the stream started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeWindow( const volatile uint8_t *src, int row_bytes, int rows,
+	int stride, void(*done)(void) )
+{
+	if ( oled_stream.busy || ( row_bytes <= 0 ) || ( rows <= 0 ) )
+	{
+		return 0;
+	}
+
+	/* Claim the streamer before the first transfer can complete. */
+	oled_stream.busy = 1;
+	oled_stream.failed = 0;
+	oled_stream.done = done;
+	oled_stream.lut = NULL;
+	oled_stream.src = src;
+	oled_stream.row_bytes = row_bytes;
+	oled_stream.stride = stride;
+	oled_stream.rows = rows;
+
+	if ( !oled_streamBegin() )
+	{
+		oled_stream.busy = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+/******** Oled_writeRect *********
+* Sets the display RAM address window and streams a rectangle of packed
+* 4bpp pixels into it. The controller addresses columns in groups of four
+* pixels, so x and width must be multiples of 4. y is a display RAM row.
+*  Inputs: x, y, width and height in pixels, pointer to the rectangle's
+*          first byte, bytes between rows in the source, completion callback
+* Outputs: 1 if the transfer started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeRect( int x, int y, int width, int height, 
+	const volatile uint8_t *src, int stride, void(*done)(void) )
+{
+	return oled_rectFrom( x, y, width, height, src, stride, NULL, 0, 0, done );
+}
+
+/******** oled_rectFrom *********
+* Oled_writeRect from a source in any frame format. With a table, source
+* nibbles from nib on in each row are expanded through it, two bytes out
+* per nibble when nib_shift is 1 (1bpp), one when 0 (2bpp).
+*/
+static int oled_rectFrom( int x, int y, int width, int height, 
+	const volatile uint8_t *src, int stride, const uint16_t *lut, int nib,
+	int nib_shift, void(*done)(void) )
+{
+	if ( oled_stream.busy || ( width < 4 ) || ( height <= 0 ) )
+	{
+		return 0;
+	}
+
+	oled_stream.busy = 1;
+	oled_stream.failed = 0;
+	oled_stream.done = done;
+	oled_stream.lut = lut;
+	oled_stream.nib = nib;
+	oled_stream.nib_shift = nib_shift;
+
+	Oled_cmdReset( &oled_windowCmds );
+	Oled_cmdAdd( &oled_windowCmds, OLED_COL_START_END );
+	Oled_cmdParam( &oled_windowCmds, OLED_COL_OFFSET + ( x >> 2 ) );
+	Oled_cmdParam( &oled_windowCmds, OLED_COL_OFFSET + ( ( x + width ) >> 2 ) - 1 );
+	Oled_cmdAdd( &oled_windowCmds, OLED_ROW_START_END );
+	Oled_cmdParam( &oled_windowCmds, y );
+	Oled_cmdParam( &oled_windowCmds, y + height - 1 );
+	Oled_cmdAdd( &oled_windowCmds, OLED_WRITE );
+
+	oled_stream.src = src;
+	oled_stream.row_bytes = width >> 1;
+	oled_stream.stride = stride;
+	oled_stream.rows = height;
+
+	oled_stream.seq = oled_windowCmds.words;
+	oled_stream.seq_len = oled_windowCmds.length;
+	oled_stream.seq_then = oled_rectData;
+
+	if ( !oled_seqSend() )
+	{
+		oled_stream.busy = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+/******** oled_flushRect *********
+* Writes one damaged region of the frame being flushed into the target page.
+* 1 and 2bpp frames are expanded through their palette on the way out.
+* Regions are 4 pixel aligned, so they start on a source nibble.
+*/
+static int oled_flushRect( frame_rect_t *r )
+{
+	frame_buffer_t *f = oled_flushFrame;
+	int bit = r->x0 * f->bpp;
+
+	return oled_rectFrom( r->x0, oled_flushBase + r->y0, r->x1 - r->x0, 
+		r->y1 - r->y0, &f->data[r->y0 * f->h_width + ( bit >> 3 )], 
+		f->h_width, ( f->bpp < FRAME_BPP_4 ) ? f->expand : NULL, 
+		( bit >> 2 ) & 1, ( f->bpp == FRAME_BPP_1 ), oled_flushNext );
+}
+
+/******** oled_flushDone *********
+* Signals the flushed frame buffer free for drawing again.
+*/
+static void oled_flushDone(void)
+{
+	if ( oled_flushFrame->readyFlag )
+	{
+		(*oled_flushFrame->readyFlag)++;
+	}
+
+	if ( oled_flushThen )
+	{
+		oled_flushThen();
+	}
+}
+
+/******** oled_prevAll *********
+* Forgets what the hidden page holds, so the next flipped flush sends the
+* whole frame.
+*/
+static void oled_prevAll(void)
+{
+	oled_prevRects[0].x0 = 0;
+	oled_prevRects[0].y0 = 0;
+	oled_prevRects[0].x1 = OLED_WIDTH;
+	oled_prevRects[0].y1 = OLED_HEIGHT;
+	oled_prevCount = 1;
+}
+
+/******** oled_flushAbort *********
+* Ends a flush cut short by a failed transfer. What reached the display is
+* unknown, so the whole frame is sent again next time, whichever frame that
+* is.
+*/
+static void oled_flushAbort(void)
+{
+	oled_resend = 1;
+	oled_prevAll();
+	frame_dirtyAll( oled_flushFrame );
+
+	oled_flushDone();
+}
+
+/******** oled_flushNext *********
+* Sends the next damaged region of the frame being flushed. After the last
+* one, flips the hidden page into view when page flipping is on, then
+* signals the frame free for drawing again.
+*/
+static void oled_flushNext(void)
+{
+	if ( oled_stream.failed )
+	{
+		oled_flushAbort();
+	}
+	else if ( oled_flushCount > 0 )
+	{
+		if ( !oled_flushRect( &oled_flushRects[--oled_flushCount] ) )
+		{
+			oled_flushAbort();
+		}
+	}
+	else if ( oled_flipping && ( oled_flushBase != oled_page * OLED_HEIGHT ) )
+	{
+		oled_page ^= 1;
+
+		Oled_cmdReset( &oled_flipCmds );
+		Oled_cmdAdd( &oled_flipCmds, OLED_START_LINE );
+		Oled_cmdParam( &oled_flipCmds, oled_page * OLED_HEIGHT );
+		if ( !Oled_cmdSend( &oled_flipCmds, oled_flushDone ) )
+		{
+			oled_page ^= 1;
+			oled_flushAbort();
+		}
+	}
+	else
+	{
+		oled_flushDone();
+	}
+}
+
+/******** Oled_damageScan *********
+* With damage detection on, replaces the frame's dirty regions with the runs
+* of rows whose CRC differs from the last frame scanned. The palette is
+* folded into every row's signature, so palette changes resend everything.
+* Rows must be whole words. Runs in main context, never from an interrupt:
+* it hashes the whole frame and the CRC unit is not reentrant.
+*  Inputs: pointer to a frame_buffer_t about to be flushed
+* Outputs: none
+*/
+void Oled_damageScan( frame_buffer_t *f )
+{
+	const volatile uint32_t *row = (const volatile uint32_t *) f->data;
+	int words = f->h_width >> 2;
+	int height = ( f->height < OLED_HEIGHT ) ? f->height : OLED_HEIGHT;
+	int y, start = -1;
+	uint32_t pal = 0, sig;
+
+	if ( !oled_detect || ( f->h_width & 3 ) || ( (uintptr_t) f->data & 3 ) )
+	{
+		return;
+	}
+
+	if ( f->bpp < FRAME_BPP_4 )
+	{
+		pal = Crc_words( (const uint32_t *) f->expand, sizeof( f->expand ) >> 2 );
+	}
+
+	if ( !oled_sigValid )
+	{
+		/* Display contents unknown, record the rows and send them all. */
+		for ( y = 0; y < height; y++, row += words )
+		{
+			oled_rowSig[y] = Crc_words( row, words ) ^ pal;
+		}
+		oled_sigValid = 1;
+		frame_dirtyAll(f);
+		return;
+	}
+
+	frame_dirtyClear(f);
+
+	for ( y = 0; y < height; y++, row += words )
+	{
+		sig = Crc_words( row, words ) ^ pal;
+
+		if ( sig != oled_rowSig[y] )
+		{
+			oled_rowSig[y] = sig;
+			if ( start < 0 )
+			{
+				start = y;
+			}
+		}
+		else if ( start >= 0 )
+		{
+			frame_dirtyAdd( f, 0, start, f->width, y );
+			start = -1;
+		}
+	}
+
+	if ( start >= 0 )
+	{
+		frame_dirtyAdd( f, 0, start, f->width, height );
+	}
+}
+
+/******** Oled_flush *********
+* Brings the display up to date with a frame buffer. Only the regions marked
+* dirty since the last flush are sent, each as a column/row window followed
+* by OLED_WRITE and the pixels streamed by DMA, bypassing the SPI queue.
+* With page flipping on, the regions go to the hidden page, which is then
+* brought into view. 1 and 2bpp frames are expanded to 4bpp through their
+* palette as they are sent. The frame's readyFlag is taken for the duration
+* and signalled once the last pixel is out. With damage detection on the
+* frame is scanned first, so call from main context.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: 1 if the flush started, 0 if the display link is busy
+*/
+int Oled_flush( frame_buffer_t *f )
+{
+	if ( oled_stream.busy )
+	{
+		return 0;
+	}
+
+	Oled_damageScan(f);
+
+	if ( !Oled_flushNotify( f, NULL ) )
+	{
+		/* Scanned but not sent, a second scan would find nothing. */
+		oled_resend = 1;
+		return 0;
+	}
+
+	return 1;
+}
+
+/******** Oled_flushNotify *********
+* Oled_flush with a completion callback, run from interrupt context after the
+* readyFlag is signalled. With nothing dirty it runs before returning. Only
+* starts the transfers, safe to call from an interrupt; with damage
+* detection on, the caller runs Oled_damageScan on the frame first.
+*  Inputs: pointer to a frame_buffer_t, completion callback or NULL
+* Outputs: 1 if the flush started, 0 if the display link is busy
+*/
+int Oled_flushNotify( frame_buffer_t *f, void(*done)(void) )
+{
+	frame_rect_t own[FRAME_DIRTY_MAX];
+	int own_count, j;
+
+	if ( oled_stream.busy )
+	{
+		return 0;
+	}
+
+	if ( oled_resend )
+	{
+		frame_dirtyAll(f);
+		oled_resend = 0;
+	}
+
+	own_count = f->dirtyCount;
+	for ( j = 0; j < own_count; j++ )
+	{
+		own[j] = f->dirty[j];
+	}
+
+	if ( oled_flipping )
+	{
+		/* The hidden page was last written two flushes ago, it also misses
+		*  what changed for the previous one. */
+		for ( j = 0; j < oled_prevCount; j++ )
+		{
+			frame_dirtyAdd( f, oled_prevRects[j].x0, oled_prevRects[j].y0,
+				oled_prevRects[j].x1, oled_prevRects[j].y1 );
+		}
+
+		oled_flushBase = ( oled_page ^ 1 ) * OLED_HEIGHT;
+	}
+	else
+	{
+		oled_flushBase = oled_page * OLED_HEIGHT;
+	}
+
+	if ( f->dirtyCount == 0 )
+	{
+		if ( done )
+		{
+			done();
+		}
+		return 1;
+	}
+
+	for ( j = 0; j < f->dirtyCount; j++ )
+	{
+		oled_flushRects[j] = f->dirty[j];
+	}
+	oled_flushCount = f->dirtyCount - 1;
+	oled_flushFrame = f;
+	oled_flushThen = done;
+
+	/* Settled before the first transfer, a failing chained one may mark
+	*  the frame dirty again from its interrupt. */
+	frame_dirtyClear(f);
+
+	for ( j = 0; j < own_count; j++ )
+	{
+		oled_prevRects[j] = own[j];
+	}
+	oled_prevCount = own_count;
+
+	if ( f->readyFlag )
+	{
+		(*f->readyFlag)--;
+	}
+
+	if ( !oled_flushRect( &oled_flushRects[oled_flushCount] ) )
+	{
+		if ( f->readyFlag )
+		{
+			(*f->readyFlag)++;
+		}
+		for ( j = 0; j <= oled_flushCount; j++ )
+		{
+			f->dirty[j] = oled_flushRects[j];
+		}
+		f->dirtyCount = oled_flushCount + 1;
+		/* The rows scanned were not sent after all. */
+		oled_resend = 1;
+		oled_prevAll();
+		return 0;
+	}
+
+	return 1;
+}
+
+/******** Oled_pageFlip *********
+* Switches double buffering in display RAM on or off. When on, flushes go to
+* the off-screen rows and OLED_START_LINE flips them into view, so a frame
+* never shows half drawn. The next flush sends the whole frame.
+*  Inputs: 1 to enable, 0 to write the visible page directly
+* Outputs: none
+*/
+void Oled_pageFlip( int enable )
+{
+	oled_flipping = enable;
+
+	/* Neither page is known to match the frame buffer any more. */
+	oled_prevAll();
+}
+
+/******** Oled_damageDetect *********
+* Switches automatic damage detection on or off. When on, Oled_damageScan
+* hashes each frame's rows with the CRC unit and sends only runs of rows
+* that changed since the last flush, in place of the regions drawing marked
+* dirty. Rows must be whole, aligned words. The first flush after switching
+* on sends the whole frame, switch on again after writing display RAM by
+* other means.
+*  Inputs: 1 to enable, 0 to send the dirty regions
+* Outputs: none
+*/
+void Oled_damageDetect( int enable )
+{
+	oled_detect = enable;
+	oled_sigValid = 0;
+}
+
+/******** Oled_writeData *********
+* Streams a contiguous block of packed 4bpp pixel bytes into display RAM at
+* the current write pointer.
+*  Inputs: pointer to pixel bytes, number of bytes, completion callback
+* Outputs: 1 if the stream started, 0 if the SPI or streamer is busy
+*/
+int Oled_writeData( const volatile uint8_t *data, int length, 
+	void(*done)(void) )
+{
+	return Oled_writeWindow( data, length, 1, length, done );
+}
+
+/******** oled_timedOut *********
+* Reports whether OLED_WAIT_TICKS have passed since start, bounding the
+* retry loops of the blocking helpers.
+*/
+static int oled_timedOut( uint32_t start )
+{
+	return Systick_timeDelta( start, Systick_timeGetCount() ) >=
+		OLED_WAIT_TICKS;
+}
+
+/******** Oled_busy *********
+* Reports whether a pixel stream is in flight.
+*  Inputs: none
+* Outputs: 1 while streaming, 0 when idle
+*/
+int Oled_busy(void)
+{
+	return oled_stream.busy;
+}
+
 /******** Oled_init *********
-* Initializes the display controller.
+* Initializes the display controller. Waits for the display link between
+* steps, the scheduler and SysTick must be running.
 *  Inputs: none
 * Outputs: none
 */
 void Oled_init(void)
 {
-
-	uint16_t init_seq[] = 
-	{
-		OLED_LOCK_STATUS, 0x112,
-		OLED_DISP_OFF,
-		OLED_CLOCK_DIV, 0x191,
-		OLED_MUX_RATIO, 0x13F,
-		//OLED_COL_START_END, 0x11C, 0x15B,
-		//OLED_ROW_START_END, 0x100, 0x13F,
-		OLED_SET_REMAP, 0x114, 0x111,
-
-		OLED_SET_VDD, 0x101,
-		//OLED_MAGIC_1, 0x1A0, 0x1FD,
-		OLED_CONTRAST_CURRENT, 0x1FF,
-		OLED_MASTER_CONTRAST, 0x10F,
-		//OLED_DEFAULT_GRAYTABLE,
-		//OLED_EN_GRAY,
-		//OLED_MAGIC_2, 0x182, 0x120,
-		OLED_SET_PRECHARGE_1, 0x11F,
-		OLED_SET_PRECHARGE_2, 0x108,
-		OLED_SET_VCOMH, 0x107,
-		OLED_NORMAL
-	};
+	uint32_t start;
 
 	Oled_reset();
 
-	Spi_send( &init_seq, (uint16_t)sizeof( init_seq ) / sizeof(uint16_t) );
+	start = Systick_timeGetCount();
+	while ( !Oled_sendSeq( oled_initSeq, OLED_SEQ_LEN(oled_initSeq), NULL ) )
+	{
+		if ( oled_timedOut( start ) )
+		{
+			return;
+		}
+	}
 
 	Oled_clear();
 
@@ -101,34 +1078,25 @@ void Oled_reset(void)
 }
 
 /******** Oled_clear *********
-* Clears the ssd1322 display memory.
+* Clears the ssd1322 display memory. Streams a blank row from flash over
+* both pages, retrying for up to OLED_WAIT_TICKS while the link is busy.
 *  Inputs: none
-* Outputs: none
+* Outputs: 1 if the clear started, 0 if the link stayed busy
 */
-void Oled_clear(void)
+int Oled_clear(void)
 {
-	volatile uint16_t x, y;
+	uint32_t start = Systick_timeGetCount();
 
-	uint16_t clear_seq[] =
+	while ( !Oled_writeRect( 0, 0, OLED_WIDTH, OLED_RAM_ROWS, oled_blankRow, 
+		0, NULL ) )
 	{
-		OLED_COL_START_END, 0x11C, 0x15B,
-		OLED_ROW_START_END, 0x100, 0x13F,
-		OLED_START_LINE, 0x100,
-		OLED_WRITE
-	};
-
-	uint16_t data_out = 0x100;
-
-	Spi_send( &clear_seq, (uint16_t)sizeof( clear_seq ) / sizeof(uint16_t) );
-
-	for ( y = 0; y < 64; y++ )
-	{
-		for ( x = 0; x < 128; x++ )
+		if ( oled_timedOut( start ) )
 		{
-	 		Spi_send( &data_out, 1 );
-	 		//Systick_delayTicks(12);
+			return 0;
 		}
 	}
+
+	return 1;
 }
 
 /******** Oled_on *********
@@ -138,12 +1106,7 @@ void Oled_clear(void)
 */
 void Oled_on(void)
 {
-	uint16_t cmd[] = 
-	{
-		OLED_DISP_ON
-	};
-
-	Spi_send( &cmd, (uint16_t)sizeof( cmd ) / sizeof(uint16_t) );
+	oled_cmdList( oled_onSeq, OLED_SEQ_LEN(oled_onSeq) );
 }
 
 /******** Oled_off *********
@@ -153,12 +1116,7 @@ void Oled_on(void)
 */
 void Oled_off(void)
 {
-	uint16_t cmd[] = 
-	{
-		OLED_DISP_OFF
-	};
-
-	Spi_send( &cmd, 1 );
+	oled_cmdList( oled_offSeq, OLED_SEQ_LEN(oled_offSeq) );
 }
 
 /******** Oled_invert *********
@@ -168,12 +1126,7 @@ void Oled_off(void)
 */
 void Oled_invert(void)
 {
-	uint16_t cmd[] = 
-	{
-		OLED_INVERSE
-	};
-
-	Spi_send( &cmd, (uint16_t)sizeof( cmd ) / sizeof(uint16_t) );
+	oled_cmdList( oled_invertSeq, OLED_SEQ_LEN(oled_invertSeq) );
 }
 
 /******** Oled_normal *********
@@ -183,78 +1136,27 @@ void Oled_invert(void)
 */
 void Oled_normal(void)
 {
-	uint16_t cmd[] = 
-	{
-		OLED_NORMAL
-	};
-
-	Spi_send( &cmd, (uint16_t)sizeof( cmd ) / sizeof(uint16_t) );
+	oled_cmdList( oled_normalSeq, OLED_SEQ_LEN(oled_normalSeq) );
 }
 
 /******** Oled_test *********
-* Test command sequence.
+* Test command sequence. Fills the panel with a grey level ramp, waiting
+* like Oled_clear.
 *  Inputs: none
-* Outputs: none
+* Outputs: 1 if the ramp started, 0 if the link stayed busy
 */
-void Oled_test(void)
+int Oled_test(void)
 {
-	volatile uint16_t x, y;
-	uint8_t p = 0;
-
-	uint16_t test_seq[] =
-	{
-		OLED_COL_START_END, 0x11C, 0x15B,
-		OLED_ROW_START_END, 0x100, 0x13F,
-		OLED_START_LINE, 0x100,
-		OLED_WRITE
-	};
+	uint32_t start = Systick_timeGetCount();
 
-	uint16_t data_1[] = { 0x112,0x134,0x156,0x178,0x19A,0x1BC,0x1DE,0x1F0 };
-	//uint16_t data_2 = 0x16D;
-	uint16_t data_t[128];
-	for ( x = 0; x < 128; x++ )
+	while ( !Oled_writeRect( 0, oled_page * OLED_HEIGHT, OLED_WIDTH, 
+		OLED_HEIGHT, oled_testRow, 0, NULL ) )
 	{
-		data_t[x] = 0x100;
-		
-	}
-
-	for ( x = 0; x < 128; x++ )
-	{
-
-		data_t[x] = data_1[p];
-		p++;
-		if ( p > 7 ) p = 0;
-	}
-
-	Spi_send( &test_seq, (uint16_t)sizeof( test_seq ) / sizeof(uint16_t) );
-
-	for ( y = 0; y < 64; y++ )
-	{
-
-		for ( x = 0; x < 128; x++ )
+		if ( oled_timedOut( start ) )
 		{
-
-			Spi_send( &data_t[x], 1 );
-
+			return 0;
 		}
 	}
 
-	// uint16_t cmd[] = 
-	// {
-	// 	OLED_VERT_SCROLL, 0x100
-	// };
-	// uint16_t delay = 10000;
-	
-	// for ( y = 0; y < 64; y++ )
-	// {
-		
-	// 	Spi_send( &cmd, 2 );
-	// 	if ( cmd[1] > 0x163 ) 
-	// 	{
-	// 		cmd[1] = 0x100;
-	// 	}
-	// 	cmd[1] += 1;
-	// 	Systick_delayTicks(delay);
-	// 	delay -= (delay / 16);
-	// }
+	return 1;
 }
\ No newline at end of file
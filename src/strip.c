@@ -0,0 +1,300 @@
+#include "strip.h"
+#include "console.h"
+
+/* Two band buffers, one rendering while the other is sent. */
+static uint8_t strip_data[2][STRIP_ROWS * ( OLED_WIDTH / 2 )] __attribute__((aligned(4)));
+static frame_buffer_t strip_band[2];
+
+static volatile int strip_row[2];   /* display RAM row waiting to go, or -1 */
+static volatile int strip_sending;  /* band buffer in flight, or -1         */
+static volatile int strip_next;     /* band buffer to send next             */
+
+static int strip_page;
+static oled_cmdbuf_t strip_cmds;
+
+static void strip_kick(void);
+
+/******** strip_sent *********
+* A band is out, free its buffer and start the other if it is ready.
+*/
+static void strip_sent(void)
+{
+	int j = strip_sending;
+
+	strip_row[j] = -1;
+	strip_sending = -1;
+	strip_next = j ^ 1;
+
+	strip_kick();
+}
+
+/******** strip_kick *********
+* Starts sending the next band if it is rendered and the link is idle.
+* Runs from the main loop and from the completion callback; only one of
+* them can find nothing in flight.
+*/
+static void strip_kick(void)
+{
+	int j = strip_next;
+
+	if ( ( strip_sending >= 0 ) || ( strip_row[j] < 0 ) )
+	{
+		return;
+	}
+
+	strip_sending = j;
+
+	if ( !Oled_writeRect( 0, strip_row[j], OLED_WIDTH, STRIP_ROWS, strip_data[j],
+		OLED_WIDTH / 2, strip_sent ) )
+	{
+		strip_sending = -1;
+	}
+}
+
+/******** strip_add *********
+* Appends an item to a display list.
+*/
+static int strip_add( strip_list_t *list, int type, int x, int y, int w,
+	int h, int value, const void *data )
+{
+	strip_item_t *it;
+
+	if ( list->count == STRIP_ITEMS_MAX )
+	{
+		return 0;
+	}
+
+	it = &list->items[list->count++];
+	it->type = type;
+	it->value = value;
+	it->x = x;
+	it->y = y;
+	it->w = w;
+	it->h = h;
+	it->data = data;
+
+	return 1;
+}
+
+/******** strip_text *********
+* Draws text into a band, y relative to the band's first row.
+*/
+static void strip_text( frame_buffer_t *b, const char *text, int x, int y,
+	int value )
+{
+	for ( ; *text && ( x < b->width ); text++, x += CONSOLE_CELL_W )
+	{
+		if ( x + CONSOLE_CELL_W > 0 )
+		{
+			Console_drawChar( b, x, y, *text, value );
+		}
+	}
+}
+
+/******** strip_render *********
+* Draws the parts of a display list falling in the band starting at row y.
+*/
+static void strip_render( frame_buffer_t *b, const strip_list_t *list, int y,
+	int background )
+{
+	const strip_item_t *it;
+	int j, top;
+
+	frame_clear( b, background );
+
+	for ( j = 0; j < list->count; j++ )
+	{
+		it = &list->items[j];
+		top = it->y - y;
+
+		if ( ( top >= STRIP_ROWS ) || ( top + it->h <= 0 ) )
+		{
+			continue;
+		}
+
+		switch ( it->type )
+		{
+			case STRIP_RECT:
+				frame_fillRect( b, it->x, top, it->w, it->h, it->value );
+				break;
+			case STRIP_SPRITE:
+				sprite_blit( b, it->data, it->x, top, it->value );
+				break;
+			case STRIP_TEXT:
+				strip_text( b, it->data, it->x, top, it->value );
+				break;
+		}
+	}
+}
+
+/******** strip_timedOut *********
+* Reports whether OLED_WAIT_TICKS have passed since start.
+*/
+static int strip_timedOut( uint32_t start )
+{
+	return Systick_timeDelta( start, Systick_timeGetCount() ) >=
+		OLED_WAIT_TICKS;
+}
+
+/******** strip_wait *********
+* Keeps the bands moving until the band buffers whose bits are set in mask
+* are free. On a timeout, bands not in flight are dropped; one in flight
+* still finishes and frees its buffer from the callback.
+*/
+static int strip_wait( int mask )
+{
+	uint32_t start = Systick_timeGetCount();
+	int j;
+
+	while ( ( ( mask & 1 ) && ( strip_row[0] >= 0 ) ) ||
+		( ( mask & 2 ) && ( strip_row[1] >= 0 ) ) )
+	{
+		strip_kick();
+
+		if ( strip_timedOut( start ) )
+		{
+			cm_disable_interrupts();
+			for ( j = 0; j < 2; j++ )
+			{
+				if ( j != strip_sending )
+				{
+					strip_row[j] = -1;
+				}
+			}
+			cm_enable_interrupts();
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/******** Strip_init *********
+* Prepares the band buffers. Strip rendering owns OLED_START_LINE while in
+* use, so display RAM page flipping and the console must be off.
+*  Inputs: none
+* Outputs: none
+*/
+void Strip_init(void)
+{
+	int j;
+
+	for ( j = 0; j < 2; j++ )
+	{
+		frame_bufferInit( &strip_band[j], OLED_WIDTH, STRIP_ROWS, strip_data[j],
+			sizeof( strip_data[j] ), NULL );
+		strip_row[j] = -1;
+	}
+
+	strip_sending = -1;
+	strip_next = 0;
+	strip_page = 0;
+}
+
+/******** Strip_listClear *********
+* Empties a display list.
+*  Inputs: pointer to a strip_list_t
+* Outputs: none
+*/
+void Strip_listClear( strip_list_t *list )
+{
+	list->count = 0;
+}
+
+/******** Strip_rect *********
+* Appends a filled rectangle to a display list.
+*  Inputs: pointer to a strip_list_t, x, y, width, height, grey level
+* Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_rect( strip_list_t *list, int x, int y, int width, int height,
+	int value )
+{
+	return strip_add( list, STRIP_RECT, x, y, width, height, value, NULL );
+}
+
+/******** Strip_sprite *********
+* Appends a sprite to a display list. The sprite must stay valid until
+* the list is drawn.
+*  Inputs: pointer to a strip_list_t, pointer to a sprite_obj_t, x, y,
+*  sprite_blit flags
+* Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_sprite( strip_list_t *list, const sprite_obj_t *s, int x, int y,
+	int flags )
+{
+	return strip_add( list, STRIP_SPRITE, x, y, s->width, s->height, flags, s );
+}
+
+/******** Strip_text *********
+* Appends a line of 5x7 console font text to a display list. The text
+* must stay valid until the list is drawn.
+*  Inputs: pointer to a strip_list_t, NUL terminated text, x, y, grey level
+* Outputs: 1 if added, 0 if the list is full
+*/
+int Strip_text( strip_list_t *list, const char *text, int x, int y,
+	int value )
+{
+	return strip_add( list, STRIP_TEXT, x, y, 0, CONSOLE_LINE_H - 1, value, 
+		text );
+}
+
+/******** Strip_draw *********
+* Renders a display list band by band into the hidden display RAM page and
+* flips it into view. Each band is sent by DMA while the next one renders
+* into the other band buffer; items are drawn in list order and skipped in
+* bands they do not touch. Returns once the last band is out. Each wait for
+* the link gives up after OLED_WAIT_TICKS; the bands not yet sent are then
+* dropped and the visible page is left as it was.
+*  Inputs: pointer to a strip_list_t, background grey level
+* Outputs: 1 if the page was flipped into view, 0 on a timeout
+*/
+int Strip_draw( const strip_list_t *list, int background )
+{
+	uint32_t start;
+	int band, base, j;
+
+	/* A band left in flight by a timed out draw has to land first. */
+	if ( !strip_wait( 3 ) )
+	{
+		return 0;
+	}
+
+	base = ( strip_page ^ 1 ) * OLED_HEIGHT;
+	strip_next = 0;
+
+	for ( band = 0; band < OLED_HEIGHT / STRIP_ROWS; band++ )
+	{
+		j = band & 1;
+
+		/* Wait for the buffer's previous band to go out. */
+		if ( !strip_wait( 1 << j ) )
+		{
+			return 0;
+		}
+
+		strip_render( &strip_band[j], list, band * STRIP_ROWS, background );
+		strip_row[j] = base + band * STRIP_ROWS;
+		strip_kick();
+	}
+
+	if ( !strip_wait( 3 ) )
+	{
+		return 0;
+	}
+
+	Oled_cmdReset( &strip_cmds );
+	Oled_cmdAdd( &strip_cmds, OLED_START_LINE );
+	Oled_cmdParam( &strip_cmds, base );
+
+	start = Systick_timeGetCount();
+	while ( !Oled_cmdSend( &strip_cmds, NULL ) )
+	{
+		if ( strip_timedOut( start ) )
+		{
+			return 0;
+		}
+	}
+
+	strip_page ^= 1;
+	return 1;
+}
@@ -88,4 +88,58 @@ void Test_calculate( volatile test_table_t *t )
 	s = sprintf( out_element_buf, " In: %u Out: %u Difference: %lli ", t->in, t->out,
 				 in_out_diff );
 	Uart_send( out_element_buf, s );
-}
\ No newline at end of file
+}
+
+/******** Test_frameBench *********
+* Times filling a frame buffer pixel by pixel, without damage tracking,
+* against the word kernels, and a 64x64 sprite_blitRotated on 4bpp
+* buffers. Reports the durations in SysTick ticks via serial terminal.
+* Overwrites the buffer's contents. tools/frame_bench checks the same
+* kernels for correctness on the build host.
+*  Inputs: pointer to a frame_buffer_t
+* Outputs: none
+*/
+void Test_frameBench( frame_buffer_t *f )
+{
+	char out_buf[120];
+	sprite_obj_t spr;
+	uint32_t start, pixel, clear, rect, rotated = 0;
+	int s, x, y;
+
+	start = Systick_timeGetCount();
+	for ( y = 0; y < f->height; y++ )
+	{
+		for ( x = 0; x < f->width; x++ )
+		{
+			frame_pixelPut( f, x, y, 0 );
+		}
+	}
+	pixel = Systick_timeDelta( start, Systick_timeGetCount() );
+
+	start = Systick_timeGetCount();
+	frame_clear( f, 0 );
+	clear = Systick_timeDelta( start, Systick_timeGetCount() );
+
+	/* Odd edges, so every row takes the nibble and byte paths too. */
+	start = Systick_timeGetCount();
+	frame_fillRect( f, 1, 0, f->width - 2, f->height, 0xF );
+	rect = Systick_timeDelta( start, Systick_timeGetCount() );
+
+	/* 64x64 sprite turned 30 degrees, the buffer's own first bytes serve
+	*  as its bitmap. */
+	if ( ( f->bpp == FRAME_BPP_4 ) && ( f->length >= 64 * SPRITE_STRIDE(64) ) )
+	{
+		sprite_init( &spr, 64, 64, (const uint8_t *) f->data,
+			64 * SPRITE_STRIDE(64), SPRITE_NO_KEY );
+		start = Systick_timeGetCount();
+		sprite_blitRotated( f, &spr, f->width / 2, f->height / 2, 0x1555,
+			Q16_ONE );
+		rotated = Systick_timeDelta( start, Systick_timeGetCount() );
+	}
+
+	s = sprintf( out_buf, " Per pixel: %lu Clear: %lu Odd rect: %lu "
+				 "Rotated 64x64: %lu ", (unsigned long) pixel,
+				 (unsigned long) clear, (unsigned long) rect,
+				 (unsigned long) rotated );
+	Uart_send( out_buf, s );
+}
@@ -0,0 +1,382 @@
+#include "tilemap.h"
+
+/******** tilemap_tile *********
+* First byte of a map tile's bitmap, tile 0 outside the map.
+*/
+static const uint8_t *tilemap_tile( const tilemap_t *map, int mx, int my )
+{
+	const tileset_t *t = map->tiles;
+	int n = 0;
+
+	if ( ( (unsigned) mx < map->width ) && ( (unsigned) my < map->height ) )
+	{
+		n = map->index[my * map->width + mx];
+	}
+	if ( n >= t->count )
+	{
+		n = 0;
+	}
+
+	return &t->data[n * ( ( t->size * t->size ) >> 1 )];
+}
+
+/******** tilemap_shift *********
+* log2 of the tile size.
+*/
+static int tilemap_shift( const tilemap_t *map )
+{
+	return ( map->tiles->size == 16 ) ? 4 : 3;
+}
+
+/******** tilemap_viewInit *********
+* Initializes a view of a map, drawn in full by the first tilemap_draw.
+*  Inputs: pointer to a tilemap_view_t, pointer to the map
+* Outputs: none
+*/
+void tilemap_viewInit( tilemap_view_t *v, const tilemap_t *map )
+{
+	v->map = map;
+	v->x = 0;
+	v->y = 0;
+	v->width = 0;
+	v->height = 0;
+	v->px = 0;
+	v->py = 0;
+	v->valid = 0;
+}
+
+/******** tilemap_invalidate *********
+* Has the next tilemap_draw render the view in full, for after the map's
+* index changes or when drawing into a frame that does not hold the view.
+*  Inputs: pointer to a tilemap_view_t
+* Outputs: none
+*/
+void tilemap_invalidate( tilemap_view_t *v )
+{
+	v->valid = 0;
+}
+
+/******** tilemap_render *********
+* Renders map pixels from px, py into a frame rectangle already clipped,
+* a tile row at a time.
+*/
+static void tilemap_render( const tilemap_t *map, frame_buffer_t *f, int x,
+	int y, int width, int height, int px, int py )
+{
+	int shift = tilemap_shift( map ), size = 1 << shift;
+	int half = size >> 1, mask = size - 1;
+	int j, mx, dx, sx, run, line;
+	volatile uint8_t *d;
+
+	for ( j = 0; j < height; j++ )
+	{
+		d = &f->data[( y + j ) * f->h_width];
+		line = ( ( py + j ) & mask ) * half;
+
+		/* Across the row a tile at a time, the first one entered part way. */
+		mx = px >> shift;
+		sx = px & mask;
+		for ( dx = x; dx < x + width; dx += run, mx++, sx = 0 )
+		{
+			run = size - sx;
+			if ( run > x + width - dx )
+			{
+				run = x + width - dx;
+			}
+
+			sprite_span( d, tilemap_tile( map, mx, ( py + j ) >> shift ) + line,
+				dx, dx + run, sx, 1, SPRITE_NO_KEY );
+		}
+	}
+}
+
+/******** tilemap_copy *********
+* Copies n bytes between places in the frame that may overlap, front to
+* back when moving down in memory and back to front otherwise, a word at a
+* time once both pointers are aligned.
+*/
+static void tilemap_copy( volatile uint8_t *d, volatile uint8_t *s, int n )
+{
+	volatile uint8_t *e;
+
+	if ( d < s )
+	{
+		e = d + n;
+		for ( ; ( d < e ) && ( (uintptr_t) d & 3 ); d++, s++ )
+		{
+			*d = *s;
+		}
+		if ( !( (uintptr_t) s & 3 ) )
+		{
+			for ( ; e - d >= 4; d += 4, s += 4 )
+			{
+				*(volatile uint32_t *) d = *(volatile uint32_t *) s;
+			}
+		}
+		for ( ; d < e; d++, s++ )
+		{
+			*d = *s;
+		}
+	}
+	else
+	{
+		e = d;
+		d += n;
+		s += n;
+		for ( ; ( d > e ) && ( (uintptr_t) d & 3 ); )
+		{
+			*--d = *--s;
+		}
+		if ( !( (uintptr_t) s & 3 ) )
+		{
+			for ( ; d - e >= 4; )
+			{
+				d -= 4;
+				s -= 4;
+				*(volatile uint32_t *) d = *(volatile uint32_t *) s;
+			}
+		}
+		for ( ; d > e; )
+		{
+			*--d = *--s;
+		}
+	}
+}
+
+/******** tilemap_move *********
+* Moves pixels x0 to x1 (exclusive) of frame row d from row s starting at
+* pixel sx, an even distance away. The rows may be the same one. Whole
+* bytes go through tilemap_copy, a half byte at either end is merged.
+*/
+static void tilemap_move( volatile uint8_t *d, volatile uint8_t *s, int x0,
+	int x1, int sx )
+{
+	uint8_t first = ( x0 & 1 ) ? 0xF0 : 0xFF;
+	uint8_t last = ( x1 & 1 ) ? 0x0F : 0xFF;
+	int n = ( ( x1 - 1 ) >> 1 ) - ( x0 >> 1 ) + 1;
+
+	d += x0 >> 1;
+	s += sx >> 1;
+
+	if ( n == 1 )
+	{
+		first &= last;
+		*d = ( *d & ~first ) | ( *s & first );
+		return;
+	}
+
+	/* The end bytes are read or written after all else they overlap. */
+	if ( d < s )
+	{
+		*d = ( *d & ~first ) | ( *s & first );
+		tilemap_copy( d + 1, s + 1, n - 2 );
+		d[n - 1] = ( d[n - 1] & ~last ) | ( s[n - 1] & last );
+	}
+	else
+	{
+		d[n - 1] = ( d[n - 1] & ~last ) | ( s[n - 1] & last );
+		tilemap_copy( d + 1, s + 1, n - 2 );
+		*d = ( *d & ~first ) | ( *s & first );
+	}
+}
+
+/******** tilemap_clip *********
+* Clips a frame rectangle and moves the map position with its corner.
+* Returns 0 if nothing is left.
+*/
+static int tilemap_clip( frame_buffer_t *f, int *x, int *y, int *width,
+	int *height, int *px, int *py )
+{
+	if ( *x < 0 )
+	{
+		*width += *x;
+		*px -= *x;
+		*x = 0;
+	}
+	if ( *y < 0 )
+	{
+		*height += *y;
+		*py -= *y;
+		*y = 0;
+	}
+	if ( *x + *width > f->width )
+	{
+		*width = f->width - *x;
+	}
+	if ( *y + *height > f->height )
+	{
+		*height = f->height - *y;
+	}
+
+	return ( *width > 0 ) && ( *height > 0 );
+}
+
+/******** tilemap_limit *********
+* Keeps a view's map position inside the map where the map is big enough.
+*/
+static void tilemap_limit( const tilemap_t *map, int width, int height,
+	int *px, int *py )
+{
+	int shift = tilemap_shift( map );
+	int mx = ( map->width << shift ) - width;
+	int my = ( map->height << shift ) - height;
+
+	if ( *px > mx ) *px = mx;
+	if ( *py > my ) *py = my;
+	if ( *px < 0 ) *px = 0;
+	if ( *py < 0 ) *py = 0;
+}
+
+/******** tilemap_draw *********
+* Draws the map pixels from px, py into a rectangle of a 4bpp frame and
+* marks what changed dirty. The frame must still hold the view as the
+* last call left it, as frames from Pipe_acquire do; anything drawn over
+* it since is put back with tilemap_restore first. When the rectangle is
+* the same and the view moved by an even number of pixels across, the
+* rows are scrolled in place, a word at a time where they line up, and
+* only the exposed strips are rendered; otherwise the view is rendered
+* in full. The view is kept inside the map. Other formats are left
+* untouched.
+*  Inputs: pointer to a tilemap_view_t, pointer to a frame_buffer_t,
+*  frame x, y, width, height, map pixel x, y of the view's top left
+* Outputs: number of pixels rendered from the tile set
+*/
+int tilemap_draw( tilemap_view_t *v, frame_buffer_t *f, int x, int y,
+	int width, int height, int px, int py )
+{
+	int dx, dy, adx, ady, ow, oh, tx, sx, ty, sy, j, k, n;
+
+	if ( f->bpp != FRAME_BPP_4 )
+	{
+		return 0;
+	}
+
+	tilemap_limit( v->map, width, height, &px, &py );
+
+	if ( !tilemap_clip( f, &x, &y, &width, &height, &px, &py ) )
+	{
+		return 0;
+	}
+
+	dx = px - v->px;
+	dy = py - v->py;
+	adx = ( dx < 0 ) ? -dx : dx;
+	ady = ( dy < 0 ) ? -dy : dy;
+	ow = width - adx;
+	oh = height - ady;
+
+	v->px = px;
+	v->py = py;
+
+	if ( !v->valid || ( x != v->x ) || ( y != v->y ) ||
+		( width != v->width ) || ( height != v->height ) || ( dx & 1 ) ||
+		( ow <= 0 ) || ( oh <= 0 ) )
+	{
+		v->x = x;
+		v->y = y;
+		v->width = width;
+		v->height = height;
+		v->valid = 1;
+
+		frame_dirtyAdd( f, x, y, x + width, y + height );
+		tilemap_render( v->map, f, x, y, width, height, px, py );
+		return width * height;
+	}
+
+	if ( !dx && !dy )
+	{
+		return 0;
+	}
+
+	frame_dirtyAdd( f, x, y, x + width, y + height );
+
+	/* The part both views show moves by -dx, -dy, rows taken in the order
+	*  that reads each one before it is written over. */
+	tx = x + ( ( dx < 0 ) ? adx : 0 );
+	sx = x + ( ( dx > 0 ) ? dx : 0 );
+	ty = y + ( ( dy < 0 ) ? ady : 0 );
+	sy = y + ( ( dy > 0 ) ? dy : 0 );
+
+	for ( j = 0; j < oh; j++ )
+	{
+		k = ( dy < 0 ) ? oh - 1 - j : j;
+		tilemap_move( &f->data[( ty + k ) * f->h_width],
+			&f->data[( sy + k ) * f->h_width], tx, tx + ow, sx );
+	}
+
+	/* The exposed columns over the whole height, then the exposed rows. */
+	n = 0;
+	if ( dx )
+	{
+		k = ( dx > 0 ) ? x + ow : x;
+		tilemap_render( v->map, f, k, y, adx, height, px + k - x, py );
+		n += adx * height;
+	}
+	if ( dy )
+	{
+		k = ( dy > 0 ) ? y + oh : y;
+		tilemap_render( v->map, f, tx, k, ow, ady, px + tx - x, py + k - y );
+		n += ow * ady;
+	}
+
+	return n;
+}
+
+/******** tilemap_restore *********
+* Renders part of the view again where it was last drawn, for under
+* sprites and text drawn over it, and marks it dirty.
+*  Inputs: pointer to a tilemap_view_t, pointer to a frame_buffer_t,
+*  frame x, y, width, height
+* Outputs: none
+*/
+void tilemap_restore( tilemap_view_t *v, frame_buffer_t *f, int x, int y,
+	int width, int height )
+{
+	int x1 = x + width, y1 = y + height;
+
+	if ( !v->valid || ( f->bpp != FRAME_BPP_4 ) )
+	{
+		return;
+	}
+
+	if ( x < v->x ) x = v->x;
+	if ( y < v->y ) y = v->y;
+	if ( x1 > v->x + v->width ) x1 = v->x + v->width;
+	if ( y1 > v->y + v->height ) y1 = v->y + v->height;
+
+	if ( ( x >= x1 ) || ( y >= y1 ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x, y, x1, y1 );
+	tilemap_render( v->map, f, x, y, x1 - x, y1 - y, v->px + x - v->x,
+		v->py + y - v->y );
+}
+
+/******** tilemap_drawDirect *********
+* Draws the map pixels from px, py into a rectangle of a 4bpp frame
+* straight from the tile set, every pixel each call. Other formats are
+* left untouched.
+*  Inputs: pointer to the map, pointer to a frame_buffer_t, frame x, y,
+*  width, height, map pixel x, y of the view's top left
+* Outputs: none
+*/
+void tilemap_drawDirect( const tilemap_t *map, frame_buffer_t *f, int x,
+	int y, int width, int height, int px, int py )
+{
+	if ( f->bpp != FRAME_BPP_4 )
+	{
+		return;
+	}
+
+	tilemap_limit( map, width, height, &px, &py );
+
+	if ( !tilemap_clip( f, &x, &y, &width, &height, &px, &py ) )
+	{
+		return;
+	}
+
+	frame_dirtyAdd( f, x, y, x + width, y + height );
+	tilemap_render( map, f, x, y, width, height, px, py );
+}
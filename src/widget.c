@@ -0,0 +1,399 @@
+#include "widget.h"
+
+#include <string.h>
+
+/******** widget_init *********
+* Initializes a widget, dirty so the first redraw paints it.
+*  Inputs: pointer to a widget_t, x, y relative to the parent, width,
+*  height, draw function or NULL, background level or WIDGET_NO_BACK
+* Outputs: none
+*/
+void widget_init( widget_t *w, int x, int y, int width, int height,
+	widget_draw_t draw, int back )
+{
+	w->x = x;
+	w->y = y;
+	w->width = width;
+	w->height = height;
+	w->draw = draw;
+	w->parent = NULL;
+	w->child = NULL;
+	w->next = NULL;
+	w->flags = WIDGET_DIRTY;
+	w->back = back;
+	w->fore = 0xF;
+	w->value = 0;
+	w->max = 100;
+	w->text = NULL;
+	w->textSum = 0;
+	w->font = NULL;
+}
+
+/******** widget_add *********
+* Appends a widget to a parent's children and invalidates it.
+*  Inputs: pointer to the parent, pointer to the child
+* Outputs: none
+*/
+void widget_add( widget_t *parent, widget_t *child )
+{
+	widget_t **pp;
+
+	for ( pp = &parent->child; *pp; pp = &(*pp)->next );
+
+	*pp = child;
+	child->next = NULL;
+	child->parent = parent;
+
+	widget_invalidate( child );
+}
+
+/******** widget_backdrop *********
+* Returns the nearest ancestor with a background level, the one whose
+* repaint covers the widget's rectangle, or NULL if there is none.
+*/
+static widget_t *widget_backdrop( widget_t *w )
+{
+	for ( w = w->parent; w && ( w->back == WIDGET_NO_BACK ); w = w->parent );
+
+	return w;
+}
+
+/******** widget_mark *********
+* Flags a widget dirty and its ancestors up to the first one already
+* flagged.
+*/
+static void widget_mark( widget_t *w )
+{
+	w->flags |= WIDGET_DIRTY;
+
+	for ( w = w->parent; w && !( w->flags & WIDGET_CHILD_DIRTY ); w = w->parent )
+	{
+		w->flags |= WIDGET_CHILD_DIRTY;
+	}
+}
+
+/******** widget_invalidate *********
+* Marks a widget's rectangle for repainting by the next widget_redraw.
+* A widget that draws without a background paints over what is behind
+* it, so the nearest ancestor with one is repainted in its place, or
+* without one the rectangle is blanked to level 0 first.
+*  Inputs: pointer to a widget_t
+* Outputs: none
+*/
+void widget_invalidate( widget_t *w )
+{
+	widget_t *a;
+
+	if ( ( w->back == WIDGET_NO_BACK ) && w->draw )
+	{
+		a = widget_backdrop( w );
+		if ( a )
+		{
+			widget_mark( a );
+			return;
+		}
+		w->flags |= WIDGET_ERASE;
+	}
+
+	widget_mark( w );
+}
+
+/******** widget_setValue *********
+* Sets a widget's value, invalidating it if it changed.
+*  Inputs: pointer to a widget_t, value
+* Outputs: none
+*/
+void widget_setValue( widget_t *w, int32_t value )
+{
+	if ( w->value != value )
+	{
+		w->value = value;
+		widget_invalidate( w );
+	}
+}
+
+/******** widget_textSum *********
+* Checksum of a text's contents, position dependent so swapped characters
+* count as a change.
+*/
+static uint16_t widget_textSum( const char *text )
+{
+	uint16_t sum = 0;
+
+	for ( ; text && *text; text++ )
+	{
+		sum = (uint16_t) ( ( sum << 3 ) | ( sum >> 13 ) ) ^ (uint8_t) *text;
+	}
+
+	return sum;
+}
+
+/******** widget_setText *********
+* Sets a widget's text, invalidating it if it changed. The text is held by
+* reference; a buffer rewritten in place and set again is caught by a
+* checksum of its contents, call widget_invalidate to be certain.
+*  Inputs: pointer to a widget_t, NUL terminated text
+* Outputs: none
+*/
+void widget_setText( widget_t *w, const char *text )
+{
+	uint16_t sum = widget_textSum( text );
+
+	if ( ( sum != w->textSum ) || ( ( w->text != text ) &&
+		( !w->text || !text || strcmp( w->text, text ) ) ) )
+	{
+		widget_invalidate( w );
+	}
+
+	w->text = text;
+	w->textSum = sum;
+}
+
+/******** widget_setHidden *********
+* Hides or shows a widget. Hiding it repaints the nearest ancestor with a
+* background level, plain containers in between leave nothing to paint
+* its rectangle over. Without one the rectangle is blanked to level 0.
+*  Inputs: pointer to a widget_t, 1 to hide, 0 to show
+* Outputs: none
+*/
+void widget_setHidden( widget_t *w, int hidden )
+{
+	widget_t *a;
+
+	if ( !hidden == !( w->flags & WIDGET_HIDDEN ) )
+	{
+		return;
+	}
+
+	if ( hidden )
+	{
+		w->flags |= WIDGET_HIDDEN;
+
+		a = widget_backdrop( w );
+		if ( a )
+		{
+			widget_mark( a );
+		}
+		else
+		{
+			w->flags |= WIDGET_ERASE;
+			widget_mark( w );
+		}
+	}
+	else
+	{
+		w->flags &= ~( WIDGET_HIDDEN | WIDGET_ERASE );
+		widget_invalidate( w );
+	}
+}
+
+/******** widget_paint *********
+* Paints a widget if it or an ancestor is invalidated, then descends into
+* children that are. Returns the number of widgets painted.
+*/
+static int widget_paint( widget_t *w, frame_buffer_t *f, int ox, int oy,
+	const frame_rect_t *clip, int force )
+{
+	frame_buffer_t view;
+	frame_rect_t r;
+	widget_t *c;
+	int x = ox + w->x, y = oy + w->y;
+	int flags = w->flags, n = 0, vx;
+
+	w->flags &= ~( WIDGET_DIRTY | WIDGET_CHILD_DIRTY | WIDGET_ERASE );
+
+	r.x0 = ( x > clip->x0 ) ? x : clip->x0;
+	r.y0 = ( y > clip->y0 ) ? y : clip->y0;
+	r.x1 = ( x + w->width < clip->x1 ) ? x + w->width : clip->x1;
+	r.y1 = ( y + w->height < clip->y1 ) ? y + w->height : clip->y1;
+
+	if ( ( r.x0 >= r.x1 ) || ( r.y0 >= r.y1 ) )
+	{
+		return 0;
+	}
+
+	if ( flags & WIDGET_HIDDEN )
+	{
+		/* Hidden with no background behind it to repaint. */
+		if ( flags & WIDGET_ERASE )
+		{
+			frame_fillRect( f, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, 0 );
+		}
+		return 0;
+	}
+
+	if ( force || ( flags & WIDGET_DIRTY ) )
+	{
+		if ( ( w->back != WIDGET_NO_BACK ) || w->draw ||
+			( flags & WIDGET_ERASE ) )
+		{
+			vx = frame_view( &view, f, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0 );
+
+			if ( w->back != WIDGET_NO_BACK )
+			{
+				frame_clear( &view, w->back );
+			}
+			else if ( flags & WIDGET_ERASE )
+			{
+				/* Nothing behind it was repainted. */
+				frame_clear( &view, 0 );
+			}
+			if ( w->draw )
+			{
+				w->draw( w, &view, x - vx, y - r.y0 );
+			}
+		}
+
+		frame_dirtyAdd( f, r.x0, r.y0, r.x1, r.y1 );
+		n++;
+
+		/* Children were painted over. */
+		force = 1;
+	}
+
+	for ( c = w->child; c; c = c->next )
+	{
+		if ( force || ( c->flags & ( WIDGET_DIRTY | WIDGET_CHILD_DIRTY ) ) )
+		{
+			n += widget_paint( c, f, x, y, &r, force );
+		}
+	}
+
+	return n;
+}
+
+/******** widget_redraw *********
+* Repaints the invalidated widgets of a tree, each through a view of its
+* rectangle clipped to its parent's, and marks their rectangles dirty for
+* a partial flush. Subtrees without invalidated widgets are skipped, a
+* static screen costs one flag test.
+*  Inputs: pointer to the root widget, pointer to a frame_buffer_t, the
+*  root's bounds being frame coordinates
+* Outputs: number of widgets painted
+*/
+int widget_redraw( widget_t *root, frame_buffer_t *f )
+{
+	frame_rect_t clip;
+
+	if ( !( root->flags & ( WIDGET_DIRTY | WIDGET_CHILD_DIRTY ) ) )
+	{
+		return 0;
+	}
+
+	clip.x0 = 0;
+	clip.y0 = 0;
+	clip.x1 = f->width;
+	clip.y1 = f->height;
+
+	return widget_paint( root, f, 0, 0, &clip, 0 );
+}
+
+/******** widget_bounds *********
+* Finds where a widget is on the frame, for widgets that draw between
+* redraws.
+*  Inputs: pointer to a widget_t, pointer to a frame_buffer_t, pointers
+*  to the frame x, y of its top left corner, pointer to a frame_rect_t to
+*  receive its rectangle clipped to its ancestors and the frame
+* Outputs: 1, or 0 when it or an ancestor is hidden or it is clipped away
+*/
+int widget_bounds( widget_t *w, frame_buffer_t *f, int *x, int *y,
+	frame_rect_t *clip )
+{
+	widget_t *a;
+	int ax, ay;
+
+	*x = 0;
+	*y = 0;
+	for ( a = w; a; a = a->parent )
+	{
+		if ( a->flags & WIDGET_HIDDEN )
+		{
+			return 0;
+		}
+		*x += a->x;
+		*y += a->y;
+	}
+
+	clip->x0 = 0;
+	clip->y0 = 0;
+	clip->x1 = f->width;
+	clip->y1 = f->height;
+
+	/* Walk up again, clipping to each rectangle at its frame position. */
+	ax = *x;
+	ay = *y;
+	for ( a = w; a; a = a->parent )
+	{
+		if ( ax > clip->x0 ) clip->x0 = ax;
+		if ( ay > clip->y0 ) clip->y0 = ay;
+		if ( ax + a->width < clip->x1 ) clip->x1 = ax + a->width;
+		if ( ay + a->height < clip->y1 ) clip->y1 = ay + a->height;
+
+		ax -= a->x;
+		ay -= a->y;
+	}
+
+	return ( clip->x0 < clip->x1 ) && ( clip->y0 < clip->y1 );
+}
+
+/******** widget_drawLabel *********
+* Draw function for text, the widget's font and text at its top left.
+*/
+void widget_drawLabel( widget_t *w, frame_buffer_t *f, int x, int y )
+{
+	if ( w->font && w->text )
+	{
+		font_drawString( f, w->font, x, y, w->text );
+	}
+}
+
+/******** widget_fraction *********
+* Scales value / max, clamped to 0 to 1, to 0 to range.
+*/
+static int widget_fraction( int32_t value, int32_t max, int range )
+{
+	if ( ( max <= 0 ) || ( value <= 0 ) )
+	{
+		return 0;
+	}
+	if ( value >= max )
+	{
+		return range;
+	}
+
+	/* Keep the product in 32 bits, range is at most 16 bits. */
+	while ( max > 0x7FFF )
+	{
+		max >>= 1;
+		value >>= 1;
+	}
+
+	return ( value * range ) / max;
+}
+
+/******** widget_drawBar *********
+* Draw function for a horizontal bar filled value / max of its width in
+* the foreground level, with an outline.
+*/
+void widget_drawBar( widget_t *w, frame_buffer_t *f, int x, int y )
+{
+	draw_rect( f, x, y, w->width, w->height, w->fore );
+	draw_rectFill( f, x + 1, y + 1, widget_fraction( w->value, w->max, w->width - 2 ),
+		w->height - 2, w->fore );
+}
+
+/******** widget_drawGauge *********
+* Draw function for a dial, a needle from the centre of the bottom edge
+* swept from left (0) to right (max) through the top.
+*/
+void widget_drawGauge( widget_t *w, frame_buffer_t *f, int x, int y )
+{
+	fixed_angle_t a = FIXED_ANGLE_180 - widget_fraction( w->value, w->max, FIXED_ANGLE_180 );
+	int cx = x + ( w->width >> 1 );
+	int cy = y + w->height - 1;
+	int r = ( ( w->width >> 1 ) < w->height ) ? ( w->width >> 1 ) - 1 : w->height - 1;
+
+	draw_line( f, cx, cy, cx + ( ( r * fixed_cos( a ) ) >> 15 ),
+		cy - ( ( r * fixed_sin( a ) ) >> 15 ), w->fore );
+	draw_circleFill( f, cx, cy, 2, w->fore );
+}
@@ -0,0 +1,228 @@
+/* bdf2font: converts a BDF bitmap font into the font_t flash format of
+*  inc/font.h. Runs on the build host.
+*
+*  Usage: bdf2font <font.bdf> <name> > src/font_<name>.c
+*
+*  Printable ASCII (0x20-0x7E) is converted. Set bits become grey level F,
+*  clear bits stay 0 (transparent). The result defines 'const font_t
+*  font_<name>', which code using it declares as
+*  'extern const font_t font_<name>;'. Sizes and offsets that do not fit
+*  the font_glyph_t and font_t fields are rejected.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define FIRST 0x20
+#define LAST  0x7E
+#define NUM   ( LAST - FIRST + 1 )
+
+#define MAX_W 64
+#define MAX_H 64
+
+struct glyph
+{
+	int present;
+	int width;
+	int height;
+	int advance;
+	int x_off;
+	int y_off;              /* BDF: bottom of the bitmap above the baseline */
+	int line;               /* of the glyph's BBX, for errors               */
+	uint8_t bits[MAX_H][MAX_W];
+};
+
+static struct glyph glyphs[NUM];
+
+/******** fail *********
+* Reports an error and exits.
+*/
+static void fail( const char *what, int line )
+{
+	fprintf( stderr, "bdf2font: %s (line %d)\n", what, line );
+	exit( 1 );
+}
+
+/******** parse *********
+* Reads the glyphs of interest and the font's ascent and descent.
+*/
+static void parse( FILE *in, int *ascent, int *descent )
+{
+	char buf[512];
+	struct glyph *g = NULL;
+	int line = 0, rows = -1, code, x, v;
+
+	while ( fgets( buf, sizeof( buf ), in ) )
+	{
+		line++;
+
+		if ( rows >= 0 )
+		{
+			if ( !strncmp( buf, "ENDCHAR", 7 ) )
+			{
+				rows = -1;
+				g = NULL;
+				continue;
+			}
+
+			if ( g && ( rows < g->height ) )
+			{
+				for ( x = 0; x < g->width; x++ )
+				{
+					if ( sscanf( &buf[( x >> 3 ) * 2], "%2x", &v ) != 1 )
+					{
+						fail( "bad bitmap row", line );
+					}
+					g->bits[rows][x] = ( v >> ( 7 - ( x & 7 ) ) ) & 1;
+				}
+			}
+			rows++;
+			continue;
+		}
+
+		if ( sscanf( buf, "FONT_ASCENT %d", ascent ) == 1 ) continue;
+		if ( sscanf( buf, "FONT_DESCENT %d", descent ) == 1 ) continue;
+
+		if ( sscanf( buf, "ENCODING %d", &code ) == 1 )
+		{
+			g = ( ( code >= FIRST ) && ( code <= LAST ) ) ? &glyphs[code - FIRST] : NULL;
+			if ( g )
+			{
+				g->present = 1;
+			}
+			continue;
+		}
+
+		if ( !g )
+		{
+			continue;
+		}
+
+		if ( sscanf( buf, "DWIDTH %d", &g->advance ) == 1 )
+		{
+			if ( ( g->advance < 0 ) || ( g->advance > UINT8_MAX ) )
+			{
+				fail( "DWIDTH out of range", line );
+			}
+			continue;
+		}
+
+		if ( sscanf( buf, "BBX %d %d %d %d", &g->width, &g->height, &g->x_off,
+			&g->y_off ) == 4 )
+		{
+			if ( ( g->width > MAX_W ) || ( g->height > MAX_H ) ||
+				( g->width < 0 ) || ( g->height < 0 ) )
+			{
+				fail( "glyph too large", line );
+			}
+			if ( ( g->x_off < INT8_MIN ) || ( g->x_off > INT8_MAX ) )
+			{
+				fail( "BBX x offset out of range", line );
+			}
+			g->line = line;
+			continue;
+		}
+
+		if ( !strncmp( buf, "BITMAP", 6 ) )
+		{
+			rows = 0;
+		}
+	}
+}
+
+int main( int argc, char **argv )
+{
+	FILE *in;
+	struct glyph *g;
+	int ascent = -1, descent = -1;
+	int j, x, y, offset, n, stride;
+	uint8_t b;
+
+	if ( argc != 3 )
+	{
+		fprintf( stderr, "usage: bdf2font <font.bdf> <name>\n" );
+		return 1;
+	}
+
+	in = fopen( argv[1], "r" );
+	if ( !in )
+	{
+		perror( argv[1] );
+		return 1;
+	}
+
+	parse( in, &ascent, &descent );
+	fclose( in );
+
+	if ( ( ascent < 0 ) || ( descent < 0 ) )
+	{
+		fail( "missing FONT_ASCENT or FONT_DESCENT", 0 );
+	}
+	if ( ascent + descent > UINT8_MAX )
+	{
+		fail( "FONT_ASCENT and FONT_DESCENT over 255 rows", 0 );
+	}
+
+	/* The glyph's top relative to the top of the line, as stored. */
+	for ( j = 0; j < NUM; j++ )
+	{
+		g = &glyphs[j];
+		g->y_off = ascent - ( g->y_off + g->height );
+
+		if ( g->present && ( ( g->y_off < INT8_MIN ) || ( g->y_off > INT8_MAX ) ) )
+		{
+			fail( "BBX y offset out of range", g->line );
+		}
+	}
+
+	printf( "/* Generated by tools/bdf2font from %s, do not edit. */\n", argv[1] );
+	printf( "#include \"font.h\"\n\n" );
+
+	printf( "static const uint8_t font_%s_atlas[] =\n{", argv[2] );
+	for ( j = 0, n = 0; j < NUM; j++ )
+	{
+		g = &glyphs[j];
+		stride = ( g->width + 1 ) >> 1;
+
+		for ( y = 0; g->present && ( y < g->height ); y++ )
+		{
+			for ( x = 0; x < stride; x++ )
+			{
+				/* Even x in the low nibble. */
+				b = ( g->bits[y][2 * x] ? 0x0F : 0 ) |
+					( ( ( 2 * x + 1 < g->width ) && g->bits[y][2 * x + 1] ) ? 0xF0 : 0 );
+				printf( "%s0x%02X,", ( n++ % 12 ) ? " " : "\n\t", b );
+			}
+		}
+	}
+	printf( "%s\n};\n\n", n ? "" : "\n\t0" );
+
+	printf( "static const font_glyph_t font_%s_glyphs[] =\n{\n", argv[2] );
+	for ( j = 0, offset = 0; j < NUM; j++ )
+	{
+		g = &glyphs[j];
+
+		if ( !g->present )
+		{
+			printf( "\t{ 0, 0, 0, 0, 0, 0 },\n" );
+			continue;
+		}
+
+		printf( "\t{ %d, %d, %d, %d, %d, %d },\n", offset, g->width, g->height,
+			g->advance, g->x_off, g->y_off );
+		offset += ( ( g->width + 1 ) >> 1 ) * g->height;
+	}
+	printf( "};\n\n" );
+
+	if ( offset > 0xFFFF )
+	{
+		fail( "atlas larger than 64 KB", 0 );
+	}
+
+	printf( "const font_t font_%s =\n{\n", argv[2] );
+	printf( "\t0x%02X, 0x%02X, %d, %d, font_%s_glyphs, font_%s_atlas\n};\n",
+		FIRST, LAST, ascent + descent, ascent, argv[2], argv[2] );
+
+	return 0;
+}
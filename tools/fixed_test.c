@@ -0,0 +1,287 @@
+/* fixed_test: checks the fixed point helpers of src/fixed.c against the C
+*  library in double precision and times both. Runs on the build host.
+*
+*  Usage: fixed_test
+*
+*  fixed_sin and fixed_cos are swept over every angle, fixed_recip and
+*  fixed_div over the Q16.16 range, the multiplies over random operands.
+*  Any error past the bounds below fails the run. Host timings only show
+*  the ratio to libm; the target has no FPU, where the gap is far wider.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "fixed.h"
+
+/* Error bounds: sine and cosine in Q15 steps, the reciprocal relative to
+*  the result plus one Q16.16 step for rounding the final shift. fixed_div
+*  adds the product's truncation, and the reciprocal's rounding step
+*  scaled by the dividend, its errors are given as a fraction of that. */
+#define SIN_MAX_LSB 2.0
+#define RECIP_MAX_REL ( 1.0 / 16384 )
+#define DIV_MAX 1.0
+#define MULQ15Q16_MAX_LSB 2.0
+
+/* Random operands per multiply check, calls per timing loop. */
+#define TRIALS 1000000
+#define RUNS 10000000
+
+static int failures;
+static volatile uint32_t sink;
+static volatile double dsink;
+
+/******** now *********
+* Monotonic time in nanoseconds.
+*/
+static double now( void )
+{
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/******** rnd32 *********
+* 32 random bits, rand() only promises 15.
+*/
+static uint32_t rnd32( void )
+{
+	return ( (uint32_t) rand() << 30 ) ^ ( (uint32_t) rand() << 15 ) ^
+		(uint32_t) rand();
+}
+
+/******** result *********
+* Prints a check's worst error against its bound, counting a failure.
+*/
+static void result( const char *what, double worst, double bound,
+	const char *unit )
+{
+	int ok = worst <= bound;
+
+	printf( "%-16s max error %10.3g %s (bound %g) %s\n", what, worst, unit,
+		bound, ok ? "ok" : "FAIL" );
+	if ( !ok )
+	{
+		failures++;
+	}
+}
+
+/******** check_sin *********
+* Every angle through fixed_sin and fixed_cos.
+*/
+static void check_sin( void )
+{
+	double ws = 0, wc = 0, e, r;
+	int a;
+
+	for ( a = 0; a < 0x10000; a++ )
+	{
+		r = 2 * M_PI * a / 65536.0;
+
+		e = fabs( fixed_sin( a ) - sin( r ) * 32768 );
+		ws = ( e > ws ) ? e : ws;
+		e = fabs( fixed_cos( a ) - cos( r ) * 32768 );
+		wc = ( e > wc ) ? e : wc;
+	}
+
+	/* 1.0 is held as 0x7FFF, one step short, inside the bound. */
+	result( "fixed_sin", ws, SIN_MAX_LSB, "LSB" );
+	result( "fixed_cos", wc, SIN_MAX_LSB, "LSB" );
+}
+
+/******** recip_error *********
+* Error of one fixed_recip result, relative to the true value with one
+* Q16.16 step of slack, or 0 where the result saturates as documented.
+*/
+static double recip_error( q16_t x )
+{
+	double want = 65536.0 / x;
+	q16_t got = fixed_recip( x );
+
+	if ( fabs( want ) * 65536 >= 2147483647.0 )
+	{
+		return ( ( want > 0 ) ? ( got == INT32_MAX ) : ( got == INT32_MIN ) ) ?
+			0 : INFINITY;
+	}
+
+	return ( fabs( got / 65536.0 - want ) - 1 / 65536.0 ) / fabs( want );
+}
+
+/******** check_recip *********
+* Every mantissa at every scale, then random operands for fixed_div.
+*/
+static void check_recip( void )
+{
+	double worst = 0, e, want, got, bound;
+	int64_t x;
+	int t;
+
+	for ( x = 1; x <= INT32_MAX; x += ( x >> 12 ) + 1 )
+	{
+		e = recip_error( (q16_t) x );
+		worst = ( e > worst ) ? e : worst;
+		e = recip_error( (q16_t) -x );
+		worst = ( e > worst ) ? e : worst;
+	}
+	result( "fixed_recip", worst, RECIP_MAX_REL, "rel" );
+
+	worst = 0;
+	for ( t = 0; t < TRIALS; t++ )
+	{
+		/* Quotients kept inside the range, away from the last step. */
+		q16_t a = (q16_t) ( rnd32() % 0x40000000 ) - 0x20000000;
+		q16_t b = (q16_t) ( rnd32() % 0x1000000 ) + 0x100;
+
+		b = ( t & 1 ) ? -b : b;
+		want = (double) a / b;
+		if ( ( fabs( want ) >= 32767 ) || ( fabs( want ) < 1 / 256.0 ) )
+		{
+			continue;
+		}
+		got = fixed_div( a, b ) / 65536.0;
+		bound = fabs( want ) * RECIP_MAX_REL +
+			fabs( a / 65536.0 ) * ( 1 / 65536.0 ) + 2 / 65536.0;
+		e = fabs( got - want ) / bound;
+		worst = ( e > worst ) ? e : worst;
+	}
+	result( "fixed_div", worst, DIV_MAX, "of bound" );
+}
+
+/******** check_mul *********
+* The multiplies against exact products.
+*/
+static void check_mul( void )
+{
+	double worst = 0, e;
+	int64_t want;
+	int t, bad = 0;
+
+	for ( t = 0; t < TRIALS; t++ )
+	{
+		/* Products inside the Q16.16 range. */
+		q16_t a = (q16_t) rnd32() >> ( rand() % 16 );
+		q16_t b = (q16_t) rnd32() >> ( 16 - ( rand() % 16 ) );
+
+		/* Truncated toward minus infinity. */
+		want = ( (int64_t) a * b ) >> 16;
+		if ( ( want > INT32_MAX ) || ( want < INT32_MIN ) )
+		{
+			continue;
+		}
+		bad += fixed_mul( a, b ) != want;
+	}
+	result( "fixed_mul", bad, 0, "wrong" );
+
+	bad = 0;
+	for ( t = 0; t < 0x10000; t++ )
+	{
+		q15_t a = (q15_t) t, b = (q15_t) rnd32();
+
+		want = ( (int64_t) a * b + 0x4000 ) >> 15;
+		want = ( want > Q15_ONE ) ? Q15_ONE : want;
+		bad += fixed_mulQ15( a, b ) != want;
+	}
+	result( "fixed_mulQ15", bad, 0, "wrong" );
+
+	for ( t = 0; t < TRIALS; t++ )
+	{
+		q16_t a = (q16_t) rnd32() >> 1;
+		q15_t b = (q15_t) rnd32();
+
+		e = fabs( fixed_mulQ15Q16( a, b ) - (double) a * b / 32768 );
+		worst = ( e > worst ) ? e : worst;
+	}
+	result( "fixed_mulQ15Q16", worst, MULQ15Q16_MAX_LSB, "LSB" );
+}
+
+/******** bench *********
+* Times each helper beside its libm or floating point counterpart.
+*/
+static void bench( void )
+{
+	double t0, t1, t2;
+	uint32_t acc = 0;
+	double dacc = 0;
+	int r;
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		acc += fixed_sin( (fixed_angle_t) ( r * 40503 ) );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		dacc += sin( (fixed_angle_t) ( r * 40503 ) * ( 2 * M_PI / 65536 ) );
+	}
+	t2 = now();
+	printf( "fixed_sin     %6.2f ns  sin     %6.2f ns\n", ( t1 - t0 ) / RUNS,
+		( t2 - t1 ) / RUNS );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		acc += fixed_cos( (fixed_angle_t) ( r * 40503 ) );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		dacc += cos( (fixed_angle_t) ( r * 40503 ) * ( 2 * M_PI / 65536 ) );
+	}
+	t2 = now();
+	printf( "fixed_cos     %6.2f ns  cos     %6.2f ns\n", ( t1 - t0 ) / RUNS,
+		( t2 - t1 ) / RUNS );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		acc += fixed_recip( ( r & 0xFFFFFF ) + 0x100 );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		dacc += 1.0 / ( ( ( r & 0xFFFFFF ) + 0x100 ) / 65536.0 );
+	}
+	t2 = now();
+	printf( "fixed_recip   %6.2f ns  1.0/x   %6.2f ns\n", ( t1 - t0 ) / RUNS,
+		( t2 - t1 ) / RUNS );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		acc = fixed_mul( acc & 0xFFFFFF, 0xFFF0 ) + r;
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		dacc = dacc * ( 0xFFF0 / 65536.0 ) + r;
+	}
+	t2 = now();
+	printf( "fixed_mul     %6.2f ns  x*y     %6.2f ns\n", ( t1 - t0 ) / RUNS,
+		( t2 - t1 ) / RUNS );
+
+	sink = acc;
+	dsink = dacc;
+}
+
+int main( void )
+{
+	srand( 1 );
+
+	check_sin();
+	check_recip();
+	check_mul();
+	bench();
+
+	if ( failures )
+	{
+		printf( "fixed_test: %d failures\n", failures );
+		return 1;
+	}
+
+	printf( "fixed_test: all within bounds\n" );
+	return 0;
+}
@@ -0,0 +1,464 @@
+/* frame_bench: checks the frame buffer span and area kernels of src/frame.c,
+*  sprite_blitAffine of src/sprite.c and draw_line of src/draw.c against
+*  plain per-pixel loops, and times both. Runs on the build host.
+*
+*  Usage: frame_bench [trials]
+*
+*  Every format is put through random fills, XORs and spans, clipped and
+*  unclipped, on a kernel buffer and a reference buffer, which must stay
+*  byte for byte equal. Random transforms of a keyed sprite must match
+*  mapping every frame pixel back through the inverse transform. Lines
+*  running off the frame must light exactly the visible pixels of the
+*  whole line, stepped without clipping. Host
+*  timings only show the ratio between the two, Test_frameBench gives the
+*  figures on the target.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "frame.h"
+#include "sprite.h"
+#include "draw.h"
+
+#define WIDTH 256
+#define HEIGHT 64
+#define BYTES ( WIDTH * HEIGHT / 2 )
+
+/* Repeats of each timed operation. */
+#define RUNS 2000
+
+/* Sprite put through sprite_blitAffine. */
+#define SPRITE_SIZE 64
+
+static uint8_t kernel_data[BYTES], ref_data[BYTES];
+static uint8_t sprite_data[SPRITE_SIZE * SPRITE_STRIDE( SPRITE_SIZE )];
+static frame_buffer_t kernel, ref;
+static int failures;
+
+/******** now *********
+* Monotonic time in nanoseconds.
+*/
+static double now( void )
+{
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/******** ref_get *********
+* Reads a pixel of the reference buffer.
+*/
+static int ref_get( frame_buffer_t *f, int x, int y )
+{
+	int bit = x * f->bpp;
+
+	return get_bits( f->data[y * f->h_width + ( bit >> 3 )], bit & 7, f->bpp );
+}
+
+/******** ref_rect *********
+* Per-pixel fill, or XOR, of a rectangle clipped to the buffer.
+*/
+static void ref_rect( frame_buffer_t *f, int x, int y, int width, int height,
+	int value, int xor )
+{
+	int x1 = ( x + width < f->width ) ? x + width : f->width;
+	int y1 = ( y + height < f->height ) ? y + height : f->height;
+	int i, j;
+
+	x = ( x < 0 ) ? 0 : x;
+	y = ( y < 0 ) ? 0 : y;
+
+	for ( j = y; j < y1; j++ )
+	{
+		for ( i = x; i < x1; i++ )
+		{
+			frame_pixelPut( f, i, j,
+				xor ? ( ref_get( f, i, j ) ^ value ) : value );
+		}
+	}
+}
+
+/******** compare *********
+* Reports the first pixel where the kernel and reference buffers differ.
+*/
+static void compare( const char *what, int bpp, int x, int y, int w, int h )
+{
+	int i, j;
+
+	if ( !memcmp( kernel_data, ref_data, BYTES ) )
+	{
+		return;
+	}
+
+	for ( j = 0; j < HEIGHT; j++ )
+	{
+		for ( i = 0; i < WIDTH; i++ )
+		{
+			if ( ref_get( &kernel, i, j ) != ref_get( &ref, i, j ) )
+			{
+				printf( "FAIL %dbpp %s(%d, %d, %d, %d): pixel %d,%d is %d, "
+					"expected %d\n", bpp, what, x, y, w, h, i, j,
+					ref_get( &kernel, i, j ), ref_get( &ref, i, j ) );
+				failures++;
+				memcpy( kernel_data, ref_data, BYTES );
+				return;
+			}
+		}
+	}
+}
+
+/******** check *********
+* Random operations on both buffers of one format.
+*/
+static void check( int bpp, int trials )
+{
+	int t, op, x, y, w, h, v;
+	int top = ( 1 << bpp ) - 1;
+
+	frame_bufferInitBpp( &kernel, WIDTH, HEIGHT, bpp, kernel_data, BYTES,
+		NULL );
+	frame_bufferInitBpp( &ref, WIDTH, HEIGHT, bpp, ref_data, BYTES, NULL );
+	memset( kernel_data, 0, BYTES );
+	memset( ref_data, 0, BYTES );
+
+	for ( t = 0; t < trials; t++ )
+	{
+		op = rand() % 6;
+		v = rand() & top;
+		x = rand() % ( WIDTH + 40 ) - 20;
+		y = rand() % ( HEIGHT + 20 ) - 10;
+		w = rand() % ( WIDTH + 20 );
+		h = rand() % ( HEIGHT + 10 );
+
+		switch ( op )
+		{
+		case 0:
+			frame_fillRect( &kernel, x, y, w, h, v );
+			ref_rect( &ref, x, y, w, h, v, 0 );
+			compare( "frame_fillRect", bpp, x, y, w, h );
+			break;
+		case 1:
+			frame_xorRect( &kernel, x, y, w, h, v );
+			ref_rect( &ref, x, y, w, h, v, 1 );
+			compare( "frame_xorRect", bpp, x, y, w, h );
+			break;
+		case 2:
+			frame_spanH( &kernel, x, y, w, v );
+			ref_rect( &ref, x, y, w, 1, v, 0 );
+			compare( "frame_spanH", bpp, x, y, w, 1 );
+			break;
+		case 3:
+			frame_spanV( &kernel, x, y, h, v );
+			ref_rect( &ref, x, y, 1, h, v, 0 );
+			compare( "frame_spanV", bpp, x, y, 1, h );
+			break;
+		case 4:
+			/* Unclipped, stays inside the row. */
+			x = rand() % WIDTH;
+			w = rand() % ( WIDTH - x + 1 );
+			y = rand() % HEIGHT;
+			frame_rowFill( &kernel, y, x, x + w, v );
+			ref_rect( &ref, x, y, w, 1, v, 0 );
+			compare( "frame_rowFill", bpp, x, y, w, 1 );
+			break;
+		default:
+			if ( t % 50 == 0 )
+			{
+				frame_clear( &kernel, v );
+				ref_rect( &ref, 0, 0, WIDTH, HEIGHT, v, 0 );
+				compare( "frame_clear", bpp, 0, 0, WIDTH, HEIGHT );
+			}
+			break;
+		}
+		frame_dirtyClear( &kernel );
+	}
+}
+
+/******** ref_affine *********
+* Per-pixel sprite_blitAffine: every frame pixel centre mapped back into
+* the sprite through the inverse transform, one multiply per term.
+*/
+static void ref_affine( frame_buffer_t *f, const sprite_obj_t *s,
+	const fixed_affine_t *m )
+{
+	fixed_affine_t inv;
+	q16_t u, v;
+	int x, y, p;
+
+	if ( !fixed_affineInvert( &inv, m ) )
+	{
+		return;
+	}
+
+	for ( y = 0; y < f->height; y++ )
+	{
+		for ( x = 0; x < f->width; x++ )
+		{
+			fixed_affineApply( &inv, Q16_INT( x ) + Q16_HALF,
+				Q16_INT( y ) + Q16_HALF, &u, &v );
+			if ( ( u < 0 ) || ( v < 0 ) || ( u >= Q16_INT( s->width ) ) ||
+				( v >= Q16_INT( s->height ) ) )
+			{
+				continue;
+			}
+
+			p = ( s->bmp_data[( v >> 16 ) * SPRITE_STRIDE( s->width ) +
+				( u >> 17 )] >> ( ( ( u >> 16 ) & 1 ) << 2 ) ) & 0x0F;
+			if ( p != s->key )
+			{
+				frame_pixelPut( f, x, y, p );
+			}
+		}
+	}
+}
+
+/******** check_affine *********
+* Random rotations, scales and positions of a keyed sprite, some partly
+* or wholly off the frame.
+*/
+static void check_affine( int trials )
+{
+	sprite_obj_t s;
+	fixed_affine_t m;
+	int t, j;
+
+	for ( j = 0; j < (int) sizeof( sprite_data ); j++ )
+	{
+		sprite_data[j] = rand();
+	}
+	sprite_init( &s, SPRITE_SIZE - 3, SPRITE_SIZE, sprite_data,
+		sizeof( sprite_data ), 5 );
+
+	frame_bufferInitBpp( &kernel, WIDTH, HEIGHT, FRAME_BPP_4, kernel_data,
+		BYTES, NULL );
+	frame_bufferInitBpp( &ref, WIDTH, HEIGHT, FRAME_BPP_4, ref_data, BYTES,
+		NULL );
+	memset( kernel_data, 0x11, BYTES );
+	memset( ref_data, 0x11, BYTES );
+
+	for ( t = 0; t < trials; t++ )
+	{
+		fixed_affineRotScale( &m, rand(), Q16_HALF + rand() % ( 3 * Q16_HALF ),
+			Q16_INT( rand() % ( WIDTH + 128 ) - 64 ),
+			Q16_INT( rand() % ( HEIGHT + 128 ) - 64 ) + rand() % Q16_ONE );
+
+		sprite_blitAffine( &kernel, &s, &m );
+		ref_affine( &ref, &s, &m );
+		compare( "sprite_blitAffine", FRAME_BPP_4, m.tx >> 16, m.ty >> 16,
+			s.width, s.height );
+		frame_dirtyClear( &kernel );
+	}
+}
+
+/******** ref_line *********
+* Steps the whole line, one pixel per step along its longer axis, and sets
+* the pixels that fall inside the buffer.
+*/
+static void ref_line( frame_buffer_t *f, int x0, int y0, int x1, int y1,
+	int value )
+{
+	int dx = abs( x1 - x0 ), dy = abs( y1 - y0 );
+	int sx = ( x1 < x0 ) ? -1 : 1, sy = ( y1 < y0 ) ? -1 : 1;
+	int64_t t, n = ( dx > dy ) ? dx : dy, m = ( dx > dy ) ? dy : dx;
+	int x, y;
+
+	for ( t = 0; t <= n; t++ )
+	{
+		/* Minor axis rounded to nearest, halves up. */
+		int k = ( n == 0 ) ? 0 : (int) ( ( 2 * m * t + n ) / ( 2 * n ) );
+
+		x = x0 + sx * (int) ( ( dx > dy ) ? t : k );
+		y = y0 + sy * (int) ( ( dx > dy ) ? k : t );
+		if ( ( x >= 0 ) && ( y >= 0 ) && ( x < f->width ) &&
+			( y < f->height ) )
+		{
+			frame_pixelPut( f, x, y, value );
+		}
+	}
+}
+
+/******** check_line *********
+* Lines with end points well off the frame, and one that only clips its
+* last few pixels into view.
+*/
+static void check_line( int trials )
+{
+	int t, lit = 0, x0, y0, x1, y1;
+
+	frame_bufferInitBpp( &kernel, WIDTH, HEIGHT, FRAME_BPP_4, kernel_data,
+		BYTES, NULL );
+	frame_bufferInitBpp( &ref, WIDTH, HEIGHT, FRAME_BPP_4, ref_data, BYTES,
+		NULL );
+	memset( kernel_data, 0, BYTES );
+	memset( ref_data, 0, BYTES );
+
+	/* Seven pixels of this one are on the frame. */
+	draw_line( &kernel, -28, -18, 398, 9, 1 );
+	ref_line( &ref, -28, -18, 398, 9, 1 );
+	for ( t = 0; t < BYTES; t++ )
+	{
+		lit += ( kernel_data[t] & 0x0F ) + ( kernel_data[t] >> 4 );
+	}
+	if ( lit != 7 )
+	{
+		printf( "FAIL draw_line(-28, -18, 398, 9): %d pixels, expected 7\n",
+			lit );
+		failures++;
+	}
+	compare( "draw_line", FRAME_BPP_4, -28, -18, 398, 9 );
+
+	for ( t = 0; t < trials; t++ )
+	{
+		x0 = rand() % ( 3 * WIDTH ) - WIDTH;
+		y0 = rand() % ( 5 * HEIGHT ) - 2 * HEIGHT;
+		x1 = rand() % ( 3 * WIDTH ) - WIDTH;
+		y1 = rand() % ( 5 * HEIGHT ) - 2 * HEIGHT;
+
+		draw_line( &kernel, x0, y0, x1, y1, t & 15 );
+		ref_line( &ref, x0, y0, x1, y1, t & 15 );
+		compare( "draw_line", FRAME_BPP_4, x0, y0, x1, y1 );
+		frame_dirtyClear( &kernel );
+	}
+}
+
+/******** report *********
+* Prints the time per call of a kernel beside its per-pixel baseline.
+*/
+static void report( const char *what, int bpp, double kernel_ns,
+	double pixel_ns )
+{
+	printf( "%dbpp %-22s %9.0f ns  per pixel %9.0f ns  x%.1f\n", bpp, what,
+		kernel_ns / RUNS, pixel_ns / RUNS, pixel_ns / kernel_ns );
+}
+
+/******** bench *********
+* Times the kernels of one format against the per-pixel loop.
+*/
+static void bench( int bpp )
+{
+	double t0, t1, t2;
+	int r;
+
+	frame_bufferInitBpp( &kernel, WIDTH, HEIGHT, bpp, kernel_data, BYTES,
+		NULL );
+	frame_bufferInitBpp( &ref, WIDTH, HEIGHT, bpp, ref_data, BYTES, NULL );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		frame_clear( &kernel, r & 1 );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		ref_rect( &ref, 0, 0, WIDTH, HEIGHT, r & 1, 0 );
+	}
+	t2 = now();
+	report( "frame_clear", bpp, t1 - t0, t2 - t1 );
+
+	/* Odd edges, so every row takes the partial byte paths too. */
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		frame_fillRect( &kernel, 1, 0, WIDTH - 2, HEIGHT, r & 1 );
+		frame_dirtyClear( &kernel );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		ref_rect( &ref, 1, 0, WIDTH - 2, HEIGHT, r & 1, 0 );
+	}
+	t2 = now();
+	report( "frame_fillRect odd", bpp, t1 - t0, t2 - t1 );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		frame_xorRect( &kernel, 3, 5, 123, 40, 1 );
+		frame_dirtyClear( &kernel );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		ref_rect( &ref, 3, 5, 123, 40, 1, 1 );
+	}
+	t2 = now();
+	report( "frame_xorRect", bpp, t1 - t0, t2 - t1 );
+}
+
+/******** bench_affine *********
+* Times a 64x64 sprite rotated about the middle of a 4bpp frame against the
+* per-pixel inverse mapping, which walks the whole frame.
+*/
+static void bench_affine( void )
+{
+	sprite_obj_t s;
+	double t0, t1, t2;
+	int r;
+
+	sprite_init( &s, SPRITE_SIZE, SPRITE_SIZE, sprite_data,
+		sizeof( sprite_data ), SPRITE_NO_KEY );
+	frame_bufferInitBpp( &kernel, WIDTH, HEIGHT, FRAME_BPP_4, kernel_data,
+		BYTES, NULL );
+	frame_bufferInitBpp( &ref, WIDTH, HEIGHT, FRAME_BPP_4, ref_data, BYTES,
+		NULL );
+
+	t0 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		sprite_blitRotated( &kernel, &s, WIDTH / 2, HEIGHT / 2, r * 97,
+			Q16_ONE );
+		frame_dirtyClear( &kernel );
+	}
+	t1 = now();
+	for ( r = 0; r < RUNS; r++ )
+	{
+		fixed_affine_t m;
+		q16_t hx, hy;
+
+		/* As sprite_blitRotated builds it. */
+		fixed_affineRotScale( &m, r * 97, Q16_ONE, 0, 0 );
+		fixed_affineApply( &m, Q16_INT( SPRITE_SIZE ) / 2,
+			Q16_INT( SPRITE_SIZE ) / 2, &hx, &hy );
+		m.tx = Q16_INT( WIDTH / 2 ) - hx;
+		m.ty = Q16_INT( HEIGHT / 2 ) - hy;
+		ref_affine( &ref, &s, &m );
+	}
+	t2 = now();
+	report( "sprite_blitRotated 64", FRAME_BPP_4, t1 - t0, t2 - t1 );
+}
+
+int main( int argc, char **argv )
+{
+	static const int bpps[] = { FRAME_BPP_1, FRAME_BPP_2, FRAME_BPP_4 };
+	int trials = ( argc > 1 ) ? atoi( argv[1] ) : 20000;
+	int j;
+
+	srand( 1 );
+
+	for ( j = 0; j < 3; j++ )
+	{
+		check( bpps[j], trials );
+	}
+	check_affine( trials / 20 );
+	check_line( trials );
+
+	for ( j = 0; j < 3; j++ )
+	{
+		bench( bpps[j] );
+	}
+	bench_affine();
+
+	if ( failures )
+	{
+		printf( "frame_bench: %d failures\n", failures );
+		return 1;
+	}
+
+	printf( "frame_bench: kernels match the per-pixel reference\n" );
+	return 0;
+}
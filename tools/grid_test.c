@@ -0,0 +1,285 @@
+/* grid_test: checks the uniform grid of src/grid.c against a search of
+*  every object. Runs on the build host.
+*
+*  Usage: grid_test [steps]
+*
+*  Objects of up to several cells, some beyond the grid's edges, are
+*  inserted, moved and removed at random until the grid runs out of
+*  entries and drops some. Every query and collision test must report
+*  each overlapping object in the grid exactly once, however many cells
+*  it covers, and leave out the dropped ones. The dropped count and the
+*  free entries must agree with the objects after every step.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "scene.h"
+
+/* Objects, enough for the grid to run out of entries. */
+#define OBJECTS 120
+
+/* World covered by the grid, and past which objects are placed. */
+#define WORLD_W ( GRID_COLS * GRID_CELL )
+#define WORLD_H ( GRID_ROWS * GRID_CELL )
+#define MARGIN 80
+
+static sprite_obj_t sprites[OBJECTS];
+static scene_obj_t objs[OBJECTS];
+static int failures;
+
+/******** expect *********
+* Counts a failure when a condition does not hold.
+*/
+static void expect( int ok, const char *what, int step )
+{
+	if ( !ok )
+	{
+		printf( "FAIL %s, step %d\n", what, step );
+		failures++;
+	}
+}
+
+/******** place *********
+* Gives an object a random size and position, off the grid at times.
+*/
+static void place( scene_obj_t *o )
+{
+	/* Mostly within a cell, now and then several cells across. */
+	int big = ( rand() % 8 ) == 0;
+
+	o->sprite->width = 1 + rand() % ( big ? 3 * GRID_CELL : GRID_CELL );
+	o->sprite->height = 1 + rand() % ( big ? 2 * GRID_CELL : GRID_CELL );
+	o->x = rand() % ( WORLD_W + 2 * MARGIN ) - MARGIN;
+	o->y = rand() % ( WORLD_H + 2 * MARGIN ) - MARGIN;
+}
+
+/******** inGrid *********
+* Whether an object is held by the grid, neither out nor dropped.
+*/
+static int inGrid( const scene_obj_t *o )
+{
+	return ( o->gx0 != GRID_OUT ) && ( o->gx0 != GRID_DROPPED );
+}
+
+/******** overlaps *********
+* Whether an object's bounding box overlaps a rectangle.
+*/
+static int overlaps( const scene_obj_t *o, int x0, int y0, int x1, int y1 )
+{
+	return ( o->x < x1 ) && ( o->y < y1 ) && ( o->x + o->sprite->width > x0 ) &&
+		( o->y + o->sprite->height > y0 );
+}
+
+/******** matches *********
+* Whether a grid answer names every object in the grid overlapping the
+* rectangle, other than skip, exactly once and nothing else.
+*/
+static int matches( scene_obj_t **found, int n, int x0, int y0, int x1,
+	int y1, const scene_obj_t *skip )
+{
+	int seen[OBJECTS];
+	int j, k, expected = 0;
+
+	memset( seen, 0, sizeof( seen ) );
+
+	for ( j = 0; j < n; j++ )
+	{
+		k = found[j] - objs;
+		if ( ( k < 0 ) || ( k >= OBJECTS ) || seen[k]++ ||
+			!inGrid( found[j] ) || ( found[j] == skip ) ||
+			!overlaps( found[j], x0, y0, x1, y1 ) )
+		{
+			return 0;
+		}
+	}
+
+	for ( j = 0; j < OBJECTS; j++ )
+	{
+		expected += inGrid( &objs[j] ) && ( &objs[j] != skip ) &&
+			overlaps( &objs[j], x0, y0, x1, y1 );
+	}
+
+	return n == expected;
+}
+
+/******** bookkept *********
+* Whether the dropped count and the free entries agree with the objects.
+*/
+static int bookkept( grid_t *g )
+{
+	int j, cells = 0, dropped = 0, free = 0;
+	uint16_t e;
+
+	for ( j = 0; j < OBJECTS; j++ )
+	{
+		if ( objs[j].gx0 == GRID_DROPPED )
+		{
+			dropped++;
+		}
+		else if ( objs[j].gx0 != GRID_OUT )
+		{
+			cells += ( objs[j].gx1 - objs[j].gx0 + 1 ) *
+				( objs[j].gy1 - objs[j].gy0 + 1 );
+		}
+	}
+
+	for ( e = g->free; ( e != GRID_NONE ) && ( free <= GRID_ENTRIES );
+		e = g->entry[e].next )
+	{
+		free++;
+	}
+
+	return ( g->dropped == dropped ) && ( g->freeCount == free ) &&
+		( cells + free == GRID_ENTRIES );
+}
+
+/******** check_drop *********
+* Objects left out when the entries run out are counted, missed by
+* queries, and taken back once there is room.
+*/
+static void check_drop( void )
+{
+	static grid_t g;
+	scene_obj_t *found[OBJECTS];
+	int j, n, fit;
+
+	grid_init( &g );
+
+	/* Each object straddles four cells. */
+	for ( j = 0; j < OBJECTS; j++ )
+	{
+		sprites[j].width = 8;
+		sprites[j].height = 8;
+		objs[j].sprite = &sprites[j];
+		objs[j].gx0 = GRID_OUT;
+		objs[j].x = GRID_CELL - 4;
+		objs[j].y = GRID_CELL - 4;
+	}
+
+	fit = GRID_ENTRIES / 4;
+	for ( j = 0; j < fit + 2; j++ )
+	{
+		expect( grid_insert( &g, &objs[j] ) == ( j < fit ), "insert", 0 );
+	}
+	expect( ( g.dropped == 2 ) && ( g.freeCount == 0 ), "two dropped", 0 );
+
+	n = grid_query( &g, 0, 0, WORLD_W, WORLD_H, found, OBJECTS );
+	expect( matches( found, n, 0, 0, WORLD_W, WORLD_H, NULL ) && ( n == fit ),
+		"dropped objects missed", 0 );
+
+	/* Removing a dropped object only uncounts it. */
+	grid_remove( &g, &objs[fit] );
+	expect( ( g.dropped == 1 ) && ( objs[fit].gx0 == GRID_OUT ) &&
+		bookkept( &g ), "dropped object removed", 0 );
+
+	/* Moving within a cell keeps a dropped object dropped while full. */
+	expect( !grid_move( &g, &objs[fit + 1] ) && ( g.dropped == 1 ),
+		"still dropped", 0 );
+
+	/* Room again, the next move takes it back. */
+	grid_remove( &g, &objs[0] );
+	expect( grid_move( &g, &objs[fit + 1] ) && ( g.dropped == 0 ) &&
+		bookkept( &g ), "dropped object taken back", 0 );
+
+	n = grid_collide( &g, &objs[fit + 1], found, OBJECTS );
+	expect( matches( found, n, objs[fit + 1].x, objs[fit + 1].y,
+		objs[fit + 1].x + 8, objs[fit + 1].y + 8, &objs[fit + 1] ) &&
+		( n == fit - 1 ), "collisions of the object taken back", 0 );
+
+	/* A full answer array stops the search. */
+	n = grid_query( &g, 0, 0, WORLD_W, WORLD_H, found, 3 );
+	expect( n == 3, "answer cut at its size", 0 );
+}
+
+/******** check_random *********
+* Random inserts, moves and removes, each followed by queries.
+*/
+static void check_random( int steps )
+{
+	static grid_t g;
+	scene_obj_t *found[OBJECTS];
+	scene_obj_t *o;
+	int step, j, n, x0, y0, x1, y1, drops = 0;
+
+	grid_init( &g );
+
+	for ( j = 0; j < OBJECTS; j++ )
+	{
+		objs[j].sprite = &sprites[j];
+		objs[j].gx0 = GRID_OUT;
+		place( &objs[j] );
+	}
+
+	for ( step = 0; step < steps; step++ )
+	{
+		o = &objs[rand() % OBJECTS];
+
+		switch ( rand() % 4 )
+		{
+			case 0:
+				if ( o->gx0 == GRID_OUT )
+				{
+					drops += !grid_insert( &g, o );
+				}
+				break;
+			case 1:
+				grid_remove( &g, o );
+				break;
+			default:
+				/* A nudge, or somewhere new. */
+				if ( rand() & 1 )
+				{
+					o->x += rand() % 17 - 8;
+					o->y += rand() % 17 - 8;
+				}
+				else
+				{
+					place( o );
+				}
+				if ( o->gx0 != GRID_OUT )
+				{
+					drops += !grid_move( &g, o );
+				}
+				break;
+		}
+
+		expect( bookkept( &g ), "dropped count and free entries", step );
+
+		x0 = rand() % ( WORLD_W + 2 * MARGIN ) - MARGIN;
+		y0 = rand() % ( WORLD_H + 2 * MARGIN ) - MARGIN;
+		x1 = x0 + 1 + rand() % ( 3 * GRID_CELL );
+		y1 = y0 + 1 + rand() % ( 3 * GRID_CELL );
+		n = grid_query( &g, x0, y0, x1, y1, found, OBJECTS );
+		expect( matches( found, n, x0, y0, x1, y1, NULL ), "query", step );
+
+		if ( inGrid( o ) )
+		{
+			n = grid_collide( &g, o, found, OBJECTS );
+			expect( matches( found, n, o->x, o->y, o->x + o->sprite->width,
+				o->y + o->sprite->height, o ), "collide", step );
+		}
+	}
+
+	expect( drops > 0, "the grid ran out of entries", steps );
+}
+
+int main( int argc, char **argv )
+{
+	int steps = ( argc > 1 ) ? atoi( argv[1] ) : 50000;
+
+	srand( 1 );
+
+	check_drop();
+	check_random( steps );
+
+	if ( failures )
+	{
+		printf( "grid_test: %d failures\n", failures );
+		return 1;
+	}
+
+	printf( "grid_test: every answer matches a search of all objects\n" );
+	return 0;
+}
@@ -0,0 +1,287 @@
+/* pgm2rle: converts a greyscale PGM image into the run-length coded
+*  rle_image_t flash format of inc/rle.h. Runs on the build host.
+*
+*  Usage: pgm2rle [-k level] <image.pgm> <name> > src/rle_<name>.c
+*
+*  Grey values are scaled to levels 0-F. With -k, pixels of that level,
+*  decimal or 0x hex, become transparent runs. The result defines 'const rle_image_t
+*  rle_<name>'.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define RLE_SKIP 0x00
+#define RLE_FILL 0x40
+#define RLE_LIT  0x80
+#define RLE_RUN_MAX 64
+
+/* Shortest run of one level coded as a fill rather than inside a literal. */
+#define FILL_MIN 3
+
+static uint8_t *out;
+static int out_len, out_size;
+
+/******** fail *********
+* Reports an error and exits.
+*/
+static void fail( const char *what )
+{
+	fprintf( stderr, "pgm2rle: %s\n", what );
+	exit( 1 );
+}
+
+/******** emit *********
+* Appends a byte to the coded data.
+*/
+static void emit( int b )
+{
+	if ( out_len == out_size )
+	{
+		out_size = out_size ? out_size * 2 : 4096;
+		out = realloc( out, out_size );
+		if ( !out )
+		{
+			fail( "out of memory" );
+		}
+	}
+
+	out[out_len++] = (uint8_t) b;
+}
+
+/******** token *********
+* Reads the next header number, skipping white space and comments.
+*/
+static int token( FILE *in )
+{
+	int c, v = 0;
+
+	do
+	{
+		c = fgetc( in );
+		if ( c == '#' )
+		{
+			while ( ( c != '\n' ) && ( c != EOF ) )
+			{
+				c = fgetc( in );
+			}
+		}
+	} while ( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\n' ) );
+
+	if ( ( c < '0' ) || ( c > '9' ) )
+	{
+		fail( "bad PGM header" );
+	}
+
+	while ( ( c >= '0' ) && ( c <= '9' ) )
+	{
+		v = v * 10 + ( c - '0' );
+		c = fgetc( in );
+	}
+
+	return v;
+}
+
+/******** load *********
+* Reads a P2 or P5 PGM image as 4-bit levels.
+*/
+static uint8_t *load( const char *path, int *width, int *height )
+{
+	FILE *in = fopen( path, "rb" );
+	uint8_t *px;
+	int binary, maxval, j, v;
+
+	if ( !in )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	if ( ( fgetc( in ) != 'P' ) )
+	{
+		fail( "not a PGM file" );
+	}
+	binary = fgetc( in );
+	if ( ( binary != '2' ) && ( binary != '5' ) )
+	{
+		fail( "only P2 and P5 PGM are supported" );
+	}
+	binary = ( binary == '5' );
+
+	*width = token( in );
+	*height = token( in );
+	maxval = token( in );
+
+	if ( ( *width <= 0 ) || ( *height <= 0 ) || ( maxval <= 0 ) || ( maxval > 65535 ) )
+	{
+		fail( "bad PGM size" );
+	}
+
+	px = malloc( *width * *height );
+	if ( !px )
+	{
+		fail( "out of memory" );
+	}
+
+	for ( j = 0; j < *width * *height; j++ )
+	{
+		if ( !binary )
+		{
+			v = token( in );
+		}
+		else if ( maxval < 256 )
+		{
+			v = fgetc( in );
+		}
+		else
+		{
+			v = fgetc( in ) << 8;
+			v |= fgetc( in );
+		}
+
+		if ( v < 0 )
+		{
+			fail( "PGM data ends early" );
+		}
+
+		px[j] = (uint8_t) ( ( v * 15 + maxval / 2 ) / maxval );
+	}
+
+	fclose( in );
+	return px;
+}
+
+/******** same *********
+* Length of the run of one level starting at x, up to RLE_RUN_MAX.
+*/
+static int same( const uint8_t *row, int x, int width )
+{
+	int n = 1;
+
+	while ( ( x + n < width ) && ( n < RLE_RUN_MAX ) && ( row[x + n] == row[x] ) )
+	{
+		n++;
+	}
+
+	return n;
+}
+
+/******** encode *********
+* Codes one row as skip, fill and literal runs.
+*/
+static void encode( const uint8_t *row, int width, int key )
+{
+	int x = 0, n, j;
+
+	while ( x < width )
+	{
+		n = same( row, x, width );
+
+		if ( row[x] == key )
+		{
+			emit( RLE_SKIP | ( n - 1 ) );
+			x += n;
+			continue;
+		}
+
+		if ( n >= FILL_MIN )
+		{
+			emit( RLE_FILL | ( n - 1 ) );
+			emit( row[x] );
+			x += n;
+			continue;
+		}
+
+		/* Literal up to the next key pixel or run worth a fill. */
+		n = 0;
+		while ( ( x + n < width ) && ( n < RLE_RUN_MAX ) && ( row[x + n] != key ) &&
+			( ( n == 0 ) || ( same( row, x + n, width ) < FILL_MIN ) ) )
+		{
+			n++;
+		}
+
+		emit( RLE_LIT | ( n - 1 ) );
+		for ( j = 0; j < n; j += 2 )
+		{
+			emit( row[x + j] | ( ( j + 1 < n ) ? ( row[x + j + 1] << 4 ) : 0 ) );
+		}
+		x += n;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	uint8_t *px;
+	uint16_t *rows;
+	int key = -1, width, height, y, j;
+	const char *path, *name;
+	char *end;
+
+	if ( ( argc == 5 ) && !strcmp( argv[1], "-k" ) )
+	{
+		long level = strtol( argv[2], &end, 0 );
+
+		if ( ( end == argv[2] ) || *end || ( level < 0 ) || ( level > 15 ) )
+		{
+			fail( "-k takes a level from 0 to 15" );
+		}
+		key = (int) level;
+		argv += 2;
+		argc -= 2;
+	}
+
+	if ( argc != 3 )
+	{
+		fprintf( stderr, "usage: pgm2rle [-k level] <image.pgm> <name>\n" );
+		return 1;
+	}
+
+	path = argv[1];
+	name = argv[2];
+	px = load( path, &width, &height );
+
+	if ( ( width > 0xFFFF ) || ( height > 0xFFFF ) )
+	{
+		fail( "image too large" );
+	}
+
+	rows = malloc( height * sizeof( *rows ) );
+	if ( !rows )
+	{
+		fail( "out of memory" );
+	}
+
+	for ( y = 0; y < height; y++ )
+	{
+		if ( out_len > 0xFFFF )
+		{
+			fail( "coded image larger than 64 KB" );
+		}
+		rows[y] = out_len;
+		encode( &px[y * width], width, key );
+	}
+
+	printf( "/* Generated by tools/pgm2rle from %s, do not edit.\n", path );
+	printf( "*  %d bytes coded, %d raw. */\n", out_len, ( ( width + 1 ) / 2 ) * height );
+	printf( "#include \"rle.h\"\n\n" );
+
+	printf( "static const uint8_t rle_%s_data[] =\n{", name );
+	for ( j = 0; j < out_len; j++ )
+	{
+		printf( "%s0x%02X,", ( j % 12 ) ? " " : "\n\t", out[j] );
+	}
+	printf( "\n};\n\n" );
+
+	printf( "static const uint16_t rle_%s_rows[] =\n{", name );
+	for ( y = 0; y < height; y++ )
+	{
+		printf( "%s%d,", ( y % 12 ) ? " " : "\n\t", rows[y] );
+	}
+	printf( "\n};\n\n" );
+
+	printf( "const rle_image_t rle_%s =\n{\n", name );
+	printf( "\t%d, %d, rle_%s_rows, rle_%s_data\n};\n", width, height, name, name );
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/* tilemap_test: checks tilemap_draw of src/tilemap.c, which scrolls the
+*  view already in the frame, against tilemap_drawDirect, which renders
+*  every pixel. Runs on the build host.
+*
+*  Usage: tilemap_test [steps]
+*
+*  Both tile sizes are put through whole tile scrolls, smaller moves odd
+*  and even, jumps, views partly off the frame and past the map's edges,
+*  and boxes drawn over the view and put back. After every step the
+*  frame must be byte for byte equal to a reference frame drawn directly.
+*  A whole tile scroll must render only the exposed strip.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "tilemap.h"
+
+#define WIDTH 256
+#define HEIGHT 64
+#define BYTES ( WIDTH * HEIGHT / 2 )
+
+/* Map size in tiles, and tiles in each set. */
+#define MAP_W 48
+#define MAP_H 20
+#define TILES 24
+
+static uint8_t frame_data[BYTES] __attribute__((aligned(4)));
+static uint8_t ref_data[BYTES] __attribute__((aligned(4)));
+static uint8_t tile_data[TILES * 16 * 16 / 2];
+static uint8_t index_data[MAP_W * MAP_H];
+static frame_buffer_t frame, ref;
+static int failures;
+
+/* View rectangles: the screen, word aligned, odd, and partly off it. */
+static const int views[][4] =
+{
+	{ 0, 0, WIDTH, HEIGHT },
+	{ 8, 8, 200, 48 },
+	{ 3, 5, 101, 37 },
+	{ -5, -3, 100, 40 },
+	{ 180, 20, 120, 60 },
+};
+
+#define VIEWS ( sizeof( views ) / sizeof( views[0] ) )
+
+/******** expect *********
+* Counts a failure when a condition does not hold.
+*/
+static void expect( int ok, const char *what, int size, int step )
+{
+	if ( !ok )
+	{
+		printf( "FAIL %s, %dx%d tiles, step %d\n", what, size, size, step );
+		failures++;
+	}
+}
+
+/******** check_size *********
+* Random steps over a map of random tiles of one size.
+*/
+static void check_size( int size, int steps )
+{
+	tileset_t set = { size, TILES, tile_data };
+	tilemap_t map = { &set, MAP_W, MAP_H, index_data };
+	tilemap_view_t view, old;
+	const int *r;
+	int step, px = 0, py = 0, v = 0, n, x, y, w, h;
+	long rendered = 0, shown = 0;
+
+	tilemap_viewInit( &view, &map );
+	memset( frame_data, 0, BYTES );
+	memset( ref_data, 0, BYTES );
+
+	for ( step = 0; step < steps; step++ )
+	{
+		r = views[v];
+
+		switch ( rand() % 8 )
+		{
+			case 0:
+			case 1:
+				/* A tile across. */
+				px += ( rand() & 1 ) ? size : -size;
+				break;
+			case 2:
+				/* A tile up or down. */
+				py += ( rand() & 1 ) ? size : -size;
+				break;
+			case 3:
+				/* A few pixels either way. */
+				px += rand() % 7 - 3;
+				py += rand() % 7 - 3;
+				break;
+			case 4:
+				/* Anywhere, past the map's edges too. */
+				px = rand() % ( MAP_W * size + 64 ) - 32;
+				py = rand() % ( MAP_H * size + 64 ) - 32;
+				break;
+			case 5:
+				/* Another rectangle, the old one's pixels left behind. */
+				v = rand() % VIEWS;
+				r = views[v];
+				break;
+			case 6:
+				/* A box over the view, put back. */
+				x = rand() % WIDTH - 8;
+				y = rand() % HEIGHT - 8;
+				w = rand() % 40 + 1;
+				h = rand() % 20 + 1;
+				frame_fillRect( &frame, x, y, w, h, 0x0F );
+				frame_fillRect( &ref, x, y, w, h, 0x0F );
+				tilemap_restore( &view, &frame, x, y, w, h );
+				tilemap_drawDirect( &map, &ref, view.x, view.y, view.width,
+					view.height, view.px, view.py );
+				expect( !memcmp( frame_data, ref_data, BYTES ),
+					"restored view", size, step );
+				break;
+			case 7:
+				/* Nothing moves. */
+				break;
+		}
+
+		if ( px < -32 ) px = -32;
+		if ( py < -32 ) py = -32;
+		if ( px > MAP_W * size ) px = MAP_W * size;
+		if ( py > MAP_H * size ) py = MAP_H * size;
+
+		old = view;
+		n = tilemap_draw( &view, &frame, r[0], r[1], r[2], r[3], px, py );
+		tilemap_drawDirect( &map, &ref, r[0], r[1], r[2], r[3], px, py );
+		if ( old.valid && ( old.x == view.x ) && ( old.y == view.y ) &&
+			( old.width == view.width ) && ( old.height == view.height ) &&
+			( old.py == view.py ) )
+		{
+			x = view.px - old.px;
+			if ( ( x == size ) || ( x == -size ) )
+			{
+				expect( n == size * view.height, "tile column scrolled in",
+					size, step );
+			}
+			else if ( !x )
+			{
+				expect( n == 0, "still view renders nothing", size, step );
+			}
+		}
+		rendered += n;
+		shown += view.width * view.height;
+
+		if ( memcmp( frame_data, ref_data, BYTES ) )
+		{
+			expect( 0, "view matches tilemap_drawDirect", size, step );
+			memcpy( frame_data, ref_data, BYTES );
+		}
+	}
+
+	printf( "tilemap_test: %dx%d tiles, %ld%% of view pixels rendered\n",
+		size, size, rendered * 100 / shown );
+}
+
+/******** check_strip *********
+* A whole tile scroll of the full screen renders only the exposed column
+* or row, and a view that did not move nothing.
+*/
+static void check_strip( int size )
+{
+	tileset_t set = { size, TILES, tile_data };
+	tilemap_t map = { &set, MAP_W, MAP_H, index_data };
+	tilemap_view_t view;
+	int n;
+
+	tilemap_viewInit( &view, &map );
+
+	n = tilemap_draw( &view, &frame, 0, 0, WIDTH, HEIGHT, size, size );
+	expect( n == WIDTH * HEIGHT, "first draw in full", size, 0 );
+
+	frame_dirtyClear( &frame );
+	n = tilemap_draw( &view, &frame, 0, 0, WIDTH, HEIGHT, size, size );
+	expect( ( n == 0 ) && ( frame.dirtyCount == 0 ), "still view", size, 0 );
+
+	n = tilemap_draw( &view, &frame, 0, 0, WIDTH, HEIGHT, 2 * size, size );
+	expect( n == size * HEIGHT, "column scrolled in", size, 0 );
+	n = tilemap_draw( &view, &frame, 0, 0, WIDTH, HEIGHT, 2 * size, 0 );
+	expect( n == size * WIDTH, "row scrolled in", size, 0 );
+
+	tilemap_drawDirect( &map, &ref, 0, 0, WIDTH, HEIGHT, 2 * size, 0 );
+	expect( !memcmp( frame_data, ref_data, BYTES ), "scrolled screen", size,
+		0 );
+
+	tilemap_invalidate( &view );
+	n = tilemap_draw( &view, &frame, 0, 0, WIDTH, HEIGHT, 2 * size, 0 );
+	expect( n == WIDTH * HEIGHT, "invalidated view in full", size, 0 );
+}
+
+int main( int argc, char **argv )
+{
+	int steps = ( argc > 1 ) ? atoi( argv[1] ) : 20000;
+	unsigned k;
+
+	srand( 1 );
+
+	for ( k = 0; k < sizeof( tile_data ); k++ )
+	{
+		tile_data[k] = rand();
+	}
+	/* Some numbers past the set, shown as tile 0. */
+	for ( k = 0; k < sizeof( index_data ); k++ )
+	{
+		index_data[k] = rand() % ( TILES + 4 );
+	}
+
+	frame_bufferInit( &frame, WIDTH, HEIGHT, frame_data, BYTES, NULL );
+	frame_bufferInit( &ref, WIDTH, HEIGHT, ref_data, BYTES, NULL );
+
+	check_strip( 8 );
+	check_strip( 16 );
+	check_size( 8, steps );
+	check_size( 16, steps );
+
+	if ( failures )
+	{
+		printf( "tilemap_test: %d failures\n", failures );
+		return 1;
+	}
+
+	printf( "tilemap_test: every step matches tilemap_drawDirect\n" );
+	return 0;
+}
@@ -0,0 +1,263 @@
+/* widget_test: checks the widget tree of src/widget.c against what a full
+*  repaint of the same tree shows. Runs on the build host.
+*
+*  Usage: widget_test
+*
+*  Trees are redrawn after value, text and visibility changes, and the
+*  frame must then match a frame the same tree was painted into from
+*  scratch. Widgets without a background, bars and gauges among them,
+*  must leave nothing of their old drawing behind. Painting counts and the
+*  dirty regions reported for a partial flush are checked as well.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "widget.h"
+
+#define WIDTH 256
+#define HEIGHT 64
+#define BYTES ( WIDTH * HEIGHT / 2 )
+
+static uint8_t frame_data[BYTES] __attribute__((aligned(4)));
+static uint8_t fresh_data[BYTES] __attribute__((aligned(4)));
+static frame_buffer_t frame, fresh;
+static int failures;
+static int painted;
+
+/******** expect *********
+* Counts a failure when a condition does not hold.
+*/
+static void expect( int ok, const char *what )
+{
+	if ( !ok )
+	{
+		printf( "FAIL %s\n", what );
+		failures++;
+	}
+}
+
+/******** pixel *********
+* Reads a pixel of a 4bpp frame.
+*/
+static int pixel( frame_buffer_t *f, int x, int y )
+{
+	return ( f->data[y * f->h_width + ( x >> 1 )] >> ( ( x & 1 ) << 2 ) ) &
+		0x0F;
+}
+
+/******** lit *********
+* Counts the pixels of a rectangle at a grey level.
+*/
+static int lit( frame_buffer_t *f, int x, int y, int width, int height,
+	int value )
+{
+	int i, j, n = 0;
+
+	for ( j = y; j < y + height; j++ )
+	{
+		for ( i = x; i < x + width; i++ )
+		{
+			n += pixel( f, i, j ) == value;
+		}
+	}
+
+	return n;
+}
+
+/******** invalidateAll *********
+* Invalidates every widget of a tree, as a fresh tree is.
+*/
+static void invalidateAll( widget_t *w )
+{
+	widget_t *c;
+
+	w->flags |= WIDGET_DIRTY;
+	for ( c = w->child; c; c = c->next )
+	{
+		invalidateAll( c );
+	}
+}
+
+/******** matchesFresh *********
+* Paints the whole tree into a cleared frame and compares it with the
+* frame the tree was redrawn into.
+*/
+static void matchesFresh( widget_t *root, int clear, const char *what )
+{
+	memset( fresh_data, clear, BYTES );
+	invalidateAll( root );
+	widget_redraw( root, &fresh );
+
+	expect( !memcmp( frame_data, fresh_data, BYTES ), what );
+}
+
+/******** paintRect *********
+* Draw function filling the widget in its foreground level, counting calls.
+*/
+static void paintRect( widget_t *w, frame_buffer_t *f, int x, int y )
+{
+	painted++;
+	draw_rectFill( f, x, y, w->width, w->height, w->fore );
+}
+
+/******** check_backed *********
+* Widgets over a panel with a background.
+*/
+static void check_backed( void )
+{
+	widget_t root, panel, a, b, bar, gauge;
+	int n;
+
+	memset( frame_data, 0, BYTES );
+	widget_init( &root, 0, 0, WIDTH, HEIGHT, NULL, 0 );
+	widget_init( &panel, 100, 10, 60, 40, NULL, 3 );
+	widget_add( &root, &panel );
+	widget_init( &a, 4, 4, 10, 10, paintRect, WIDGET_NO_BACK );
+	a.fore = 7;
+	widget_add( &panel, &a );
+	widget_init( &b, 50, 30, 30, 30, paintRect, WIDGET_NO_BACK );
+	b.fore = 9;
+	widget_add( &panel, &b );
+	widget_init( &bar, 0, 50, 100, 10, widget_drawBar, WIDGET_NO_BACK );
+	bar.value = 100;
+	widget_add( &root, &bar );
+	widget_init( &gauge, 200, 0, 40, 30, widget_drawGauge, 0 );
+	gauge.value = 30;
+	widget_add( &root, &gauge );
+
+	n = widget_redraw( &root, &frame );
+	expect( n == 6, "first redraw paints every widget" );
+	expect( widget_redraw( &root, &frame ) == 0, "static tree paints nothing" );
+	expect( ( pixel( &frame, 104, 14 ) == 7 ) &&
+		( pixel( &frame, 114, 24 ) == 3 ), "child over panel" );
+	/* b reaches past the panel, clipped to it. */
+	expect( ( pixel( &frame, 159, 49 ) == 9 ) &&
+		( pixel( &frame, 160, 49 ) == 0 ), "child clipped to its parent" );
+
+	/* Only the panel's subtree repaints for a child without a background. */
+	frame_dirtyClear( &frame );
+	painted = 0;
+	widget_setValue( &a, 5 );
+	n = widget_redraw( &root, &frame );
+	expect( ( n == 3 ) && ( painted == 2 ), "child repaints its panel" );
+	expect( ( frame.dirtyCount == 1 ) && ( frame.dirty[0].x0 == 100 ) &&
+		( frame.dirty[0].y0 == 10 ) && ( frame.dirty[0].x1 == 160 ) &&
+		( frame.dirty[0].y1 == 50 ), "dirty region is the panel" );
+
+	/* A bar without a background, emptied, over the root's level 0. */
+	widget_setValue( &bar, 10 );
+	widget_redraw( &root, &frame );
+	expect( lit( &frame, 1, 51, 98, 8, 0xF ) == 9 * 8, "bar shrinks" );
+	matchesFresh( &root, 0, "bar leaves its old fill behind" );
+
+	/* The gauge's old needle is painted over by its background. */
+	widget_setValue( &gauge, 90 );
+	widget_redraw( &root, &frame );
+	matchesFresh( &root, 0, "gauge leaves its old needle behind" );
+	gauge.back = WIDGET_NO_BACK;
+	widget_setValue( &gauge, 10 );
+	widget_redraw( &root, &frame );
+	matchesFresh( &root, 0, "gauge without a background leaves its needle" );
+
+	/* Hidden, the panel shows through; shown again, the child is back. */
+	widget_setHidden( &a, 1 );
+	widget_redraw( &root, &frame );
+	expect( pixel( &frame, 104, 14 ) == 3, "hidden child" );
+	matchesFresh( &root, 0, "hidden child over its panel" );
+	widget_setHidden( &a, 0 );
+	widget_redraw( &root, &frame );
+	expect( pixel( &frame, 104, 14 ) == 7, "shown child" );
+}
+
+/******** check_plain *********
+* Widgets under plain containers, nothing with a background above them.
+*/
+static void check_plain( void )
+{
+	widget_t root, box, a, bar;
+
+	memset( frame_data, 0x22, BYTES );
+	widget_init( &root, 0, 0, WIDTH, HEIGHT, NULL, WIDGET_NO_BACK );
+	widget_init( &box, 10, 10, 100, 40, NULL, WIDGET_NO_BACK );
+	widget_add( &root, &box );
+	widget_init( &a, 4, 4, 10, 10, paintRect, WIDGET_NO_BACK );
+	a.fore = 7;
+	widget_add( &box, &a );
+	widget_init( &bar, 20, 20, 50, 8, widget_drawBar, WIDGET_NO_BACK );
+	bar.value = 100;
+	widget_add( &box, &bar );
+
+	widget_redraw( &root, &frame );
+	expect( ( pixel( &frame, 15, 15 ) == 7 ) &&
+		( pixel( &frame, 13, 13 ) == 2 ), "plain containers paint nothing" );
+
+	/* Hidden with nothing to repaint behind it, blanked to level 0. */
+	frame_dirtyClear( &frame );
+	widget_setHidden( &a, 1 );
+	widget_redraw( &root, &frame );
+	expect( ( lit( &frame, 14, 14, 10, 10, 0 ) == 100 ) &&
+		( pixel( &frame, 13, 13 ) == 2 ) && ( frame.dirtyCount == 1 ),
+		"hidden child blanked" );
+	widget_setHidden( &a, 0 );
+	widget_redraw( &root, &frame );
+	expect( pixel( &frame, 15, 15 ) == 7, "shown child" );
+
+	/* Redrawn smaller, the bar's rectangle is blanked first. */
+	widget_setValue( &bar, 10 );
+	widget_redraw( &root, &frame );
+	expect( lit( &frame, 31, 31, 48, 6, 0xF ) == 4 * 6, "plain bar shrinks" );
+	expect( lit( &frame, 31, 31, 48, 6, 0 ) == 44 * 6, "plain bar blanked" );
+}
+
+/******** check_text *********
+* Labels repaint when their text changes, also rewritten in place.
+*/
+static void check_text( void )
+{
+	widget_t root, label;
+	char buf[8];
+
+	widget_init( &root, 0, 0, WIDTH, HEIGHT, NULL, 0 );
+	widget_init( &label, 0, 0, 40, 10, widget_drawLabel, 0 );
+	widget_add( &root, &label );
+	widget_redraw( &root, &frame );
+
+	strcpy( buf, "ab" );
+	widget_setText( &label, buf );
+	expect( label.flags & WIDGET_DIRTY, "new text" );
+	widget_redraw( &root, &frame );
+	widget_setText( &label, buf );
+	expect( !( label.flags & WIDGET_DIRTY ), "same text" );
+	strcpy( buf, "ba" );
+	widget_setText( &label, buf );
+	expect( label.flags & WIDGET_DIRTY, "text rewritten in place" );
+	widget_redraw( &root, &frame );
+	widget_setText( &label, "ba" );
+	expect( !( label.flags & WIDGET_DIRTY ), "equal text elsewhere" );
+	widget_setText( &label, "bb" );
+	expect( label.flags & WIDGET_DIRTY, "different text elsewhere" );
+	widget_redraw( &root, &frame );
+	widget_setText( &label, NULL );
+	expect( label.flags & WIDGET_DIRTY, "text removed" );
+}
+
+int main( void )
+{
+	frame_bufferInit( &frame, WIDTH, HEIGHT, frame_data, BYTES, NULL );
+	frame_bufferInit( &fresh, WIDTH, HEIGHT, fresh_data, BYTES, NULL );
+
+	check_backed();
+	check_plain();
+	check_text();
+
+	if ( failures )
+	{
+		printf( "widget_test: %d failures\n", failures );
+		return 1;
+	}
+
+	printf( "widget_test: redraws match a full repaint\n" );
+	return 0;
+}